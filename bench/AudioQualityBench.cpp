@@ -0,0 +1,58 @@
+// AudioQualityBench.cpp
+// Cost of the per-frame audio quality analysis as a share of one core in real time
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/raw-stream/AudioQuality.h"
+
+using namespace std;
+
+int main() {
+    mt19937 rng(42);
+    normal_distribution<double> noise(0, 4000);
+
+    struct Case { int rate, channels; };
+    const Case cases[] = {
+        {16000, 1},
+        {32000, 1},
+        {48000, 2},
+    };
+
+    cout << setw(8) << "rate" << setw(10) << "channels" << setw(12) << "ns/frame" << setw(14) << "core share" << endl;
+
+    for (const auto& c : cases) {
+        // the SDK delivers 10 ms frames
+        size_t count = static_cast<size_t>(c.rate / 100 * c.channels);
+        vector<int16_t> frame(count);
+        for (auto& s : frame)
+            s = static_cast<int16_t>(max(-32768.0, min(32767.0, noise(rng))));
+
+        AudioQuality quality;
+        const uint64_t frameNs = 10000000;
+        uint64_t captureNs = frameNs;
+        size_t frames = 0;
+
+        auto start = chrono::steady_clock::now();
+        chrono::duration<double> elapsed{};
+
+        while (elapsed.count() < 0.5) {
+            for (int i = 0; i < 256; ++i) {
+                quality.onFrame(frame.data(), count, c.rate, c.channels, captureNs);
+                captureNs += frameNs;
+            }
+            frames += 256;
+            elapsed = chrono::steady_clock::now() - start;
+        }
+
+        double ns = elapsed.count() * 1e9 / frames;
+        cout << setw(8) << c.rate << setw(10) << c.channels << setw(12) << fixed << setprecision(0) << ns
+             << setw(13) << setprecision(4) << ns / frameNs * 100 << "%" << endl;
+    }
+
+    return 0;
+}
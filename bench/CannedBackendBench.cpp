@@ -0,0 +1,66 @@
+// CannedBackendBench.cpp
+// Cost of the transcription pipeline behind the backend, with the canned engine standing in for the network
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../src/raw-stream/CannedBackend.h"
+#include "../src/raw-stream/LatencyTracker.h"
+
+using namespace std;
+
+int main() {
+    struct Case { int rate, channels; };
+    const Case cases[] = {
+        {16000, 1},
+        {32000, 1},
+        {48000, 2},
+    };
+
+    cout << setw(8) << "rate" << setw(10) << "channels" << setw(12) << "ns/frame" << setw(12) << "us/result" << setw(14) << "core share" << endl;
+
+    for (const auto& c : cases) {
+        // the SDK delivers 10 ms frames
+        vector<char> frame(static_cast<size_t>(c.rate / 100 * c.channels) * sizeof(int16_t));
+
+        // what the audio delegate does with every result
+        LatencyTracker latency;
+        latency.setFormat(c.rate, c.channels);
+        size_t results = 0;
+
+        CannedBackend backend{TranscriptionBackend::Options()};
+        backend.setOnResult([&](DeepgramResults& r) {
+            latency.onResult(r);
+            r.captureNs = latency.captureTimeAt(r.start);
+            ++results;
+        });
+        backend.open(c.rate, c.channels);
+
+        const uint64_t frameNs = 10000000;
+        uint64_t captureNs = frameNs;
+        size_t frames = 0;
+
+        auto start = chrono::steady_clock::now();
+        chrono::duration<double> elapsed{};
+
+        while (elapsed.count() < 0.5) {
+            for (int i = 0; i < 256; ++i) {
+                backend.push(frame.data(), frame.size());
+                latency.onSent(frame.size(), captureNs);
+                captureNs += frameNs;
+            }
+            frames += 256;
+            elapsed = chrono::steady_clock::now() - start;
+        }
+
+        double ns = elapsed.count() * 1e9 / frames;
+        cout << setw(8) << c.rate << setw(10) << c.channels << setw(12) << fixed << setprecision(0) << ns
+             << setw(12) << setprecision(1) << elapsed.count() * 1e6 / max<size_t>(results, 1)
+             << setw(13) << setprecision(4) << ns / frameNs * 100 << "%" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+// KeywordMatcherBench.cpp
+// Matches per second of the keyword automaton against the size of the term list
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+#include "../src/transcript/KeywordMatcher.h"
+
+using namespace std;
+
+static string randomWord(mt19937& rng) {
+    uniform_int_distribution<int> length(3, 9);
+    uniform_int_distribution<int> letter('a', 'z');
+
+    string word(length(rng), ' ');
+    for (auto& c : word)
+        c = static_cast<char>(letter(rng));
+
+    return word;
+}
+
+int main(int argc, char** argv) {
+    mt19937 rng(42);
+
+    vector<string> vocabulary(5000);
+    for (auto& word : vocabulary)
+        word = randomWord(rng);
+
+    uniform_int_distribution<size_t> pick(0, vocabulary.size() - 1);
+
+    // a batch of finalized results of ~25 words each, roughly a 10 second utterance
+    vector<Alternative> transcripts(2000);
+    for (auto& alt : transcripts) {
+        double t = 0;
+        for (int i = 0; i < 25; ++i) {
+            Word w;
+            w.word = vocabulary[pick(rng)];
+            w.punctuated_word = w.word;
+            w.start = t;
+            w.end = t + 0.3;
+            w.confidence = 0.9;
+            w.speaker = i / 10;
+            t += 0.4;
+
+            alt.transcript += (i ? " " : "") + w.word;
+            alt.words.push_back(w);
+        }
+    }
+
+    cout << setw(8) << "terms" << setw(12) << "build ms" << setw(16) << "results/s" << setw(16) << "matches/s" << setw(14) << "MB/s" << endl;
+
+    for (size_t termCount : {100, 1000, 5000, 20000}) {
+        KeywordMatcher matcher;
+        uniform_int_distribution<int> phrase(1, 3);
+        for (size_t i = 0; i < termCount; ++i) {
+            string term;
+            for (int n = phrase(rng); n > 0; --n)
+                term += (term.empty() ? "" : " ") + vocabulary[pick(rng)];
+            matcher.add(term);
+        }
+
+        auto buildStart = chrono::steady_clock::now();
+        matcher.build();
+        auto buildTime = chrono::duration<double, milli>(chrono::steady_clock::now() - buildStart).count();
+
+        size_t matches = 0, bytes = 0, results = 0;
+        auto start = chrono::steady_clock::now();
+        chrono::duration<double> elapsed{};
+
+        while (elapsed.count() < 1.0) {
+            for (const auto& alt : transcripts) {
+                for (const auto& search : matcher.match(alt))
+                    matches += search.hits.size();
+                bytes += alt.transcript.size();
+            }
+            results += transcripts.size();
+            elapsed = chrono::steady_clock::now() - start;
+        }
+
+        auto seconds = elapsed.count();
+        cout << setw(8) << termCount
+             << setw(12) << fixed << setprecision(2) << buildTime
+             << setw(16) << setprecision(0) << results / seconds
+             << setw(16) << matches / seconds
+             << setw(14) << setprecision(1) << bytes / seconds / 1e6 << endl;
+    }
+
+    return 0;
+}
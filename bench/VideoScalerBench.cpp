@@ -0,0 +1,88 @@
+// VideoScalerBench.cpp
+// Frames per second of the I420 downscaler for the sizes the renderer delivers
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/raw-stream/VideoScaler.h"
+
+using namespace std;
+
+using Scale = void (*)(const uint8_t*, int, int, int, uint8_t*, int, int);
+
+static void halveScalar(const uint8_t* src, int sw, int sh, int stride, uint8_t* dst, int, int) {
+    VideoScaler::halveScalar(src, sw, sh, stride, dst);
+}
+
+static double framesPerSecond(Scale scale, const vector<uint8_t>& frame, int sw, int sh, int dw, int dh) {
+    vector<uint8_t> out(static_cast<size_t>(dw) * dh * 3 / 2);
+    const uint8_t* y = frame.data();
+    const uint8_t* u = y + static_cast<size_t>(sw) * sh;
+    const uint8_t* v = u + static_cast<size_t>(sw / 2) * (sh / 2);
+
+    size_t frames = 0;
+    auto start = chrono::steady_clock::now();
+    chrono::duration<double> elapsed{};
+
+    while (elapsed.count() < 0.5) {
+        for (int i = 0; i < 16; ++i) {
+            scale(y, sw, sh, sw, out.data(), dw, dh);
+            scale(u, sw / 2, sh / 2, sw / 2, out.data() + dw * dh, dw / 2, dh / 2);
+            scale(v, sw / 2, sh / 2, sw / 2, out.data() + dw * dh * 5 / 4, dw / 2, dh / 2);
+        }
+        frames += 16;
+        elapsed = chrono::steady_clock::now() - start;
+    }
+
+    // keep the output alive
+    volatile uint8_t sink = out[out.size() / 2];
+    (void) sink;
+
+    return frames / elapsed.count();
+}
+
+int main() {
+    mt19937 rng(42);
+    uniform_int_distribution<int> byte(0, 255);
+
+    struct Case { int sw, sh, dw, dh; };
+    const Case cases[] = {
+        {1280, 720, 640, 360},
+        {1280, 720, 320, 180},
+        {1920, 1080, 960, 540},
+        {1280, 720, 480, 270},
+    };
+
+    cout << setw(12) << "source" << setw(12) << "target" << setw(14) << "scalar fps" << setw(14) << "scale fps" << setw(10) << "speedup" << endl;
+
+    for (const auto& c : cases) {
+        vector<uint8_t> frame(static_cast<size_t>(c.sw) * c.sh * 3 / 2);
+        for (auto& b : frame)
+            b = static_cast<uint8_t>(byte(rng));
+
+        // the scalar baseline is only comparable for a single halving
+        bool half = c.dw * 2 == c.sw && c.dh * 2 == c.sh;
+        double scalar = half ? framesPerSecond(halveScalar, frame, c.sw, c.sh, c.dw, c.dh) : 0;
+        double simd = framesPerSecond(VideoScaler::scale, frame, c.sw, c.sh, c.dw, c.dh);
+
+        cout << setw(12) << to_string(c.sw) + "x" + to_string(c.sh)
+             << setw(12) << to_string(c.dw) + "x" + to_string(c.dh)
+             << setw(14) << fixed << setprecision(0);
+        if (half)
+            cout << scalar;
+        else
+            cout << "-";
+        cout << setw(14) << simd << setw(10) << setprecision(2);
+        if (half)
+            cout << simd / scalar << "x";
+        else
+            cout << "-";
+        cout << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+// WebSocketMaskBench.cpp
+// Client frame cost of the pooled, vector-masked writer against a per-frame copy, byte-wise mask and write
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/raw-stream/WebSocketFrame.h"
+
+using namespace std;
+
+/**
+ * What WebSocketImpl::sendBytes does per frame: a fresh buffer, the payload
+ * masked a byte at a time into it, and one write
+ */
+static void pocoStyle(int fd, const uint8_t* payload, size_t length, mt19937& rng) {
+    unique_ptr<uint8_t[]> frame(new uint8_t[length + WebSocketFrame::c_maxHeader]);
+    auto key = static_cast<uint32_t>(rng());
+    auto header = WebSocketFrame::writeHeader(frame.get(), WebSocketFrame::BINARY, length, key);
+
+    uint8_t k[4];
+    memcpy(k, &key, sizeof(k));
+    for (size_t i = 0; i < length; ++i)
+        frame[header + i] = payload[i] ^ k[i % 4];
+
+    (void) !write(fd, frame.get(), header + length);
+}
+
+template <typename F>
+static double framesPerSecond(F&& send) {
+    size_t frames = 0;
+    auto start = chrono::steady_clock::now();
+    chrono::duration<double> elapsed{};
+
+    while (elapsed.count() < 0.5) {
+        frames += send();
+        elapsed = chrono::steady_clock::now() - start;
+    }
+
+    return frames / elapsed.count();
+}
+
+int main() {
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0)
+        return 1;
+
+    mt19937 rng(42);
+
+    // 10 ms and 100 ms of 16 kHz mono, and 100 ms of 48 kHz stereo
+    const size_t sizes[] = {320, 3200, 19200};
+    const size_t batches[] = {1, 8};
+
+    cout << setw(8) << "bytes" << setw(8) << "batch" << setw(14) << "poco fps" << setw(14) << "writer fps" << setw(10) << "speedup" << endl;
+
+    for (auto size : sizes) {
+        vector<uint8_t> payload(size);
+        for (auto& b : payload)
+            b = static_cast<uint8_t>(rng());
+
+        for (auto batch : batches) {
+            double poco = framesPerSecond([&]() {
+                for (size_t i = 0; i < batch; ++i)
+                    pocoStyle(fd, payload.data(), size, rng);
+                return batch;
+            });
+
+            WebSocketFrameWriter writer(1 << 20);
+            auto sink = [fd](const uint8_t* data, size_t length) { return static_cast<int>(write(fd, data, length)); };
+            double pooled = framesPerSecond([&]() {
+                for (size_t i = 0; i < batch; ++i)
+                    writer.queue(WebSocketFrame::BINARY, payload.data(), size);
+                return writer.flush(sink);
+            });
+
+            cout << setw(8) << size << setw(8) << batch << setw(14) << fixed << setprecision(0) << poco
+                 << setw(14) << pooled << setw(9) << setprecision(2) << pooled / poco << "x" << endl;
+        }
+    }
+
+    close(fd);
+    return 0;
+}
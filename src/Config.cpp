@@ -1,87 +1,5 @@
-#include <iostream>
-#include <fstream>
-#include <iterator>
-
-#include <codecvt>
-#include <algorithm>
-#include <locale>
-#include <string>
-
-#include <ada.h>
-
-#include <CLI/CLI.hpp>
-
-using namespace std;
-using namespace ada;
-
-class Config {
-
-    const string& m_version = "1.0.2";
-    const string& m_name = "Zoom Meeting SDK for Linux Sample v" + m_version;
-
-    CLI::App m_app;
-
-    CLI::App* m_rawRecordAudioCmd;
-    string m_audioDir="out";
-    string m_audioFile;
-    bool m_separateParticipantAudio;
-
-    CLI::App* m_rawRecordVideoCmd;
-    string m_videoDir="out";
-    string m_videoFile;
-
-    string m_joinUrl;
-    string m_meetingId;
-    string m_password;
-    string m_displayName = "Zoom Meeting Bot";
-
-    string m_deepgramApiKey;
-
-    string m_clientId;
-    string m_clientSecret;
-
-    string m_zoomHost = "https://zoom.us";
-    string m_joinToken;
-
-    bool m_isMeetingStart;
-
-public:
-    Config();
-
-    int read(int ac, char **av);
-
-    bool parseUrl(const string& join_url);
-
-    const string& meetingId() const;
-    const string& password() const;
-    const string& displayName() const;
-
-    const string& joinToken() const;
-    const string& joinUrl() const;
-
-    const string& clientId() const;
-    const string& clientSecret() const;
-
-    const string& zoomHost() const;
-
-    // Add this method to get deepgram-api-key
-    const string& deepgramApiKey() const;
-
-    bool isMeetingStart() const;
-
-    bool useRawRecording() const;
-
-    bool useRawAudio() const;
-    bool useRawVideo() const;
-
-    const string& audioFile() const;
-    const string& videoFile() const;
-
-    const string& audioDir() const;
-    const string& videoDir() const;
-
-    bool separateParticipantAudio() const;
-};
+#include "Config.h"
+#include "util/Log.h"
 
 Config::Config() :
     m_app(m_name, "zoomsdk"),
@@ -95,6 +13,27 @@ Config::Config() :
     m_app.add_option("-n, --display-name", m_displayName, "Display Name for the meeting")->capture_default_str();
 
      m_app.add_option("--deepgram-api-key", m_deepgramApiKey, "Enter Deepgram Api Key");
+    m_app.add_option("--keyword-file", m_keywordFile, "Watch-list of terms to alert on, one per line");
+    m_app.add_option("--transcript-log", m_transcriptLog, "Append final transcripts to a binary log file");
+    m_app.add_option("--captions", m_captions, "Write live SRT and WebVTT captions to <path>.srt and <path>.vtt");
+
+    m_app.add_option("--log-level", m_logLevel, "Minimum log level")->check(CLI::IsMember({"debug", "info", "warn", "error", "off"}))->capture_default_str();
+    m_app.add_option("--log-format", m_logFormat, "Log output format")->check(CLI::IsMember({"text", "json"}))->capture_default_str();
+
+    m_app.add_option("--metrics-port", m_metricsPort, "Serve Prometheus metrics on 127.0.0.1:<port>, 0 to disable")->capture_default_str();
+    m_app.add_flag("--trace", m_trace, "Record per-stage spans, served as Chrome trace JSON at /trace on the metrics port");
+
+    m_app.add_option("--drain-timeout", m_drainTimeout, "On SIGINT or SIGTERM, wait this many ms for the last transcripts before exiting")->capture_default_str();
+
+    m_app.add_option("--thread-cpus", m_threadCpus, "CPUs each thread role may run on, e.g. \"sdk-audio=2 io=3 log=0-1\"");
+    m_app.add_option("--thread-priority", m_threadPriority, "SCHED_FIFO priority or nice level per thread role, e.g. \"sdk-audio=fifo:20 video-writer=nice:10\"");
+    m_app.add_option("--thread-stack", m_threadStack, "Stack size per thread role, e.g. \"gateway-connect=256k\"");
+
+    m_app.add_option("--meetings", m_meetings, "Supervise one worker process per meeting listed in this file and transcribe them all here");
+    m_app.add_option("--workers", m_workers, "Worker processes to start ahead of time, 0 for one per meeting")->capture_default_str()->check(CLI::Range(0, 256));
+    // set by the supervisor on the workers it starts
+    m_app.add_option("--worker-fd", m_workerFd, "Socket to the supervisor")->group("");
+    m_app.add_option("--worker-socket", m_workerSocket, "Unix socket the worker shares its audio ring on")->group("");
 
     m_app.add_option("--host", m_zoomHost, "Host Domain for the Zoom Meeting")->capture_default_str();
     m_app.add_option("-u, --join-url", m_joinUrl, "Join or Start a Meeting URL");
@@ -108,9 +47,28 @@ Config::Config() :
     m_rawRecordAudioCmd->add_option("-f, --file", m_audioFile, "Output PCM audio file");
     m_rawRecordAudioCmd->add_option("-d, --dir", m_audioDir, "Audio Output Directory");
     m_rawRecordAudioCmd->add_flag("-s, --separate-participants", m_separateParticipantAudio, "Output to separate PCM files for each participant");
+    m_rawRecordAudioCmd->add_option("--sessions", m_sessions, "Transcribe the loudest separate participants with this many Deepgram sessions")->check(CLI::Range(0, 32));
+    m_rawRecordAudioCmd->add_flag("--mixdown", m_mixdown, "Transcribe a local mix of the separate participant streams on one session");
+    m_rawRecordAudioCmd->add_option("--shm-socket", m_audioShm, "Share live PCM with local processes through a shared memory ring attached on this unix socket");
+    m_rawRecordAudioCmd->add_option("--gap-threshold", m_gapThreshold, "Send silence once transcribed audio falls this many ms behind capture time, 0 to disable")->capture_default_str()->check(CLI::Range(0, 10000));
+    m_rawRecordAudioCmd->add_option("--engine", m_engine, "Transcription engine; canned plays back fixed results without any network")->check(CLI::IsMember({"deepgram", "canned"}))->capture_default_str();
+    m_rawRecordAudioCmd->add_option("--endpoint", m_endpoint, "Streaming endpoint of the transcription engine")->capture_default_str();
+    m_rawRecordAudioCmd->add_option("--model", m_model, "Transcription model")->capture_default_str();
+    m_rawRecordAudioCmd->add_option("--params", m_params, "Extra query parameters for the transcription stream")->capture_default_str();
+    m_rawRecordAudioCmd->add_option("--script", m_script, "Text the canned engine plays back, one utterance per line");
+    m_rawRecordAudioCmd->add_flag("--uplink-adapt", m_uplinkAdapt, "Step the transcription stream down to 16 kHz, 8 kHz mu-law and speech only while the uplink is congested");
+    m_rawRecordAudioCmd->add_flag("--hedge", m_hedge, "Also send the transcribed audio to a second Deepgram session and keep whichever result arrives first");
+    m_rawRecordAudioCmd->add_option("--hedge-url", m_hedgeUrl, "Endpoint for the second session, the primary endpoint when empty");
+    m_rawRecordAudioCmd->add_option("--hedge-key", m_hedgeKey, "Deepgram API key for the second session, the primary key when empty");
+    m_rawRecordAudioCmd->add_option("--hedge-model", m_hedgeModel, "Model for the second session, the primary model when empty");
 
     m_rawRecordVideoCmd->add_option("-f, --file", m_videoFile, "Output YUV video file");
     m_rawRecordVideoCmd->add_option("-d, --dir", m_videoDir, "Video Output Directory");
+    m_rawRecordVideoCmd->add_option("--fps", m_videoFps, "Maximum frame rate to write, 0 for every frame")->check(CLI::NonNegativeNumber);
+    m_rawRecordVideoCmd->add_option("--width", m_videoWidth, "Downscale to this width, 0 to follow the height")->check(CLI::NonNegativeNumber);
+    m_rawRecordVideoCmd->add_option("--height", m_videoHeight, "Downscale to this height, 0 to follow the width")->check(CLI::NonNegativeNumber);
+    m_rawRecordVideoCmd->add_flag("--keyframes", m_videoKeyframes, "Only write frames where the picture changed, e.g. shared slides");
+    m_rawRecordVideoCmd->add_option("--renderers", m_videoRenderers, "Most participants to decode video from at once, following the active speakers")->check(CLI::Range(1, 16));
 }
 
 int Config::read(int ac, char **av) {
@@ -134,7 +92,7 @@ bool Config::parseUrl(const string& join_url) {
     auto url = ada::parse<ada::url>(join_url);
 
     if (!url) {
-        cerr << "unable to parse join URL" << endl;
+        Log::error("unable to parse join URL");
         return false;
     }
 
@@ -167,6 +125,73 @@ const string& Config::deepgramApiKey() const {
     return m_deepgramApiKey;
 }
 
+const string& Config::keywordFile() const {
+    return m_keywordFile;
+}
+
+const string& Config::transcriptLog() const {
+    return m_transcriptLog;
+}
+
+const string& Config::captions() const {
+    return m_captions;
+}
+
+const string& Config::logLevel() const {
+    return m_logLevel;
+}
+
+const string& Config::logFormat() const {
+    return m_logFormat;
+}
+
+unsigned short Config::metricsPort() const {
+    return m_metricsPort;
+}
+
+bool Config::trace() const {
+    return m_trace;
+}
+
+unsigned int Config::drainTimeout() const {
+    return m_drainTimeout;
+}
+
+const string& Config::threadCpus() const {
+    return m_threadCpus;
+}
+
+const string& Config::threadPriority() const {
+    return m_threadPriority;
+}
+
+const string& Config::threadStack() const {
+    return m_threadStack;
+}
+
+const string& Config::meetings() const {
+    return m_meetings;
+}
+
+unsigned int Config::workers() const {
+    return m_workers;
+}
+
+int Config::workerFd() const {
+    return m_workerFd;
+}
+
+const string& Config::workerSocket() const {
+    return m_workerSocket;
+}
+
+void Config::setMeeting(const string& meetingId, const string& password, const string& displayName) {
+    m_meetingId = meetingId;
+    m_password = password;
+    if (!displayName.empty())
+        m_displayName = displayName;
+}
+
 const string& Config::meetingId() const {
     return m_meetingId;
 }
@@ -232,6 +257,82 @@ const string& Config::videoDir() const {
     return m_videoDir;
 }
 
+double Config::videoFps() const {
+    return m_videoFps;
+}
+
+int Config::videoWidth() const {
+    return m_videoWidth;
+}
+
+int Config::videoHeight() const {
+    return m_videoHeight;
+}
+
+bool Config::videoKeyframes() const {
+    return m_videoKeyframes;
+}
+
+unsigned int Config::videoRenderers() const {
+    return m_videoRenderers;
+}
+
 bool Config::separateParticipantAudio() const {
     return m_separateParticipantAudio;
 }
+
+unsigned int Config::sessions() const {
+    return m_sessions;
+}
+
+bool Config::mixdown() const {
+    return m_mixdown;
+}
+
+const string& Config::audioShm() const {
+    return m_audioShm;
+}
+
+unsigned int Config::gapThreshold() const {
+    return m_gapThreshold;
+}
+
+const string& Config::engine() const {
+    return m_engine;
+}
+
+const string& Config::endpoint() const {
+    return m_endpoint;
+}
+
+const string& Config::model() const {
+    return m_model;
+}
+
+const string& Config::params() const {
+    return m_params;
+}
+
+const string& Config::script() const {
+    return m_script;
+}
+
+bool Config::uplinkAdapt() const {
+    return m_uplinkAdapt;
+}
+
+bool Config::hedge() const {
+    return m_hedge;
+}
+
+const string& Config::hedgeUrl() const {
+    return m_hedgeUrl;
+}
+
+const string& Config::hedgeKey() const {
+    return m_hedgeKey;
+}
+
+const string& Config::hedgeModel() const {
+    return m_hedgeModel;
+}
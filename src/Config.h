@@ -25,10 +25,29 @@ class Config {
     string m_audioDir = "out";
     string m_audioFile;
     bool m_separateParticipantAudio;
+    unsigned int m_sessions = 0;
+    bool m_mixdown = false;
+    string m_audioShm;
+    unsigned int m_gapThreshold = 100;
+    string m_engine = "deepgram";
+    string m_endpoint = "wss://api.deepgram.com/v1/listen";
+    string m_model = "nova-2";
+    string m_params = "endpointing=10&smart_format=true&diarize=true&utterances=true";
+    string m_script;
+    bool m_uplinkAdapt = false;
+    bool m_hedge = false;
+    string m_hedgeUrl;
+    string m_hedgeKey;
+    string m_hedgeModel;
 
     CLI::App* m_rawRecordVideoCmd;
     string m_videoDir = "out";
     string m_videoFile;
+    double m_videoFps = 0;
+    int m_videoWidth = 0;
+    int m_videoHeight = 0;
+    bool m_videoKeyframes = false;
+    unsigned int m_videoRenderers = 1;
 
     string m_joinUrl;
     string m_meetingId;
@@ -44,6 +63,27 @@ class Config {
     // Addition of deepgram-api-key
     string m_deepgramApiKey;
 
+    string m_keywordFile;
+    string m_transcriptLog;
+    string m_captions;
+
+    string m_logLevel = "info";
+    string m_logFormat = "text";
+
+    unsigned short m_metricsPort = 0;
+    bool m_trace = false;
+
+    unsigned int m_drainTimeout = 5000;
+
+    string m_threadCpus;
+    string m_threadPriority;
+    string m_threadStack;
+
+    string m_meetings;
+    unsigned int m_workers = 0;
+    int m_workerFd = -1;
+    string m_workerSocket;
+
     bool m_isMeetingStart;
 
 public:
@@ -68,6 +108,40 @@ public:
     // Getter for deepgram-api-key
     const string& deepgramApiKey() const;
 
+    const string& keywordFile() const;
+    const string& transcriptLog() const;
+    const string& captions() const;
+
+    const string& logLevel() const;
+    const string& logFormat() const;
+
+    unsigned short metricsPort() const;
+    bool trace() const;
+
+    unsigned int drainTimeout() const;
+
+    /**
+     * Thread placement by role, as "<role>=<value>" entries separated by spaces; see Threads::configure
+     */
+    const string& threadCpus() const;
+    const string& threadPriority() const;
+    const string& threadStack() const;
+
+    const string& meetings() const;
+    unsigned int workers() const;
+
+    /**
+     * @return the socket to the supervisor when running as one of its workers, -1 otherwise
+     */
+    int workerFd() const;
+    const string& workerSocket() const;
+
+    /**
+     * Join this meeting instead of the configured one, as assigned by the supervisor
+     * @param displayName empty to keep the configured name
+     */
+    void setMeeting(const string& meetingId, const string& password, const string& displayName);
+
     bool isMeetingStart() const;
 
     bool useRawRecording() const;
@@ -81,7 +155,27 @@ public:
     const string& audioDir() const;
     const string& videoDir() const;
 
+    double videoFps() const;
+    int videoWidth() const;
+    int videoHeight() const;
+    bool videoKeyframes() const;
+    unsigned int videoRenderers() const;
+
     bool separateParticipantAudio() const;
+    unsigned int sessions() const;
+    bool mixdown() const;
+    const string& audioShm() const;
+    unsigned int gapThreshold() const;
+    const string& engine() const;
+    const string& endpoint() const;
+    const string& model() const;
+    const string& params() const;
+    const string& script() const;
+    bool uplinkAdapt() const;
+    bool hedge() const;
+    const string& hedgeUrl() const;
+    const string& hedgeKey() const;
+    const string& hedgeModel() const;
 };
 
 #endif //MEETING_SDK_LINUX_SAMPLE_CONFIG_H
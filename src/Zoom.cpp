@@ -1,12 +1,86 @@
 #include "Zoom.h"
 
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <glib-unix.h>
+
+#include "raw-stream/TlsSessions.h"
+
+namespace {
+    // a token this close to expiring is not handed to the SDK
+    constexpr chrono::minutes c_jwtRenew{5};
+}
+
 SDKError Zoom::config(int ac, char** av) {
     auto status = m_config.read(ac, av);
     if (status) {
-        cerr << "failed to read configuration" << endl;
+        Log::error("failed to read configuration");
         return SDKERR_INTERNAL_ERROR;
     }
 
+    Log::setLevel(m_config.logLevel());
+    Log::setFormat(m_config.logFormat());
+
+    if (!Threads::configure(m_config.threadCpus(), m_config.threadPriority(), m_config.threadStack()))
+        return SDKERR_INVALID_PARAMETER;
+
+    return SDKERR_SUCCESS;
+}
+
+SDKError Zoom::prepare() {
+    // a worker's transcripts are written by the supervisor
+    if (!isWorker()) {
+        m_sinks = async(launch::async, [this]() {
+            StartupTimeline::Scope phase("sinks");
+            return startSinks();
+        });
+    }
+
+    if (!m_config.clientId().empty() && !m_config.clientSecret().empty()) {
+        m_signing = async(launch::async, [this]() {
+            StartupTimeline::Scope phase("jwt");
+            jwt();
+        });
+    }
+
+    // the first transcription stream then resumes this session instead of a full handshake
+    if (m_config.useRawAudio() && m_config.engine() == "deepgram" && !isWorker()) {
+        m_warmup = async(launch::async, [this]() {
+            StartupTimeline::Scope phase("tls_warmup");
+            return TlsSessions::getInstance().warm(m_config.endpoint());
+        });
+    }
+
+    return SDKERR_SUCCESS;
+}
+
+SDKError Zoom::startSinks() {
+    if (!m_transcripts.open(m_config.keywordFile(), m_config.transcriptLog(), m_config.captions()))
+        return SDKERR_INVALID_PARAMETER;
+
+    if (m_config.metricsPort()) {
+        auto& registry = MetricsRegistry::getInstance();
+        registry.gauge("zoomsdk_transcript_log_pending_bytes", "Bytes waiting for the next transcript log commit",
+                       [&]() { return static_cast<double>(m_transcripts.log().pendingBytes()); });
+        registry.counter("zoomsdk_transcript_log_commits_total", "Group commits written to the transcript log",
+                         [&]() { return static_cast<double>(m_transcripts.log().commits()); });
+        registry.gauge("zoomsdk_log_dropped", "Log messages dropped because a thread's ring was full",
+                       []() { return static_cast<double>(Log::dropped()); });
+        ProcessStats::expose();
+
+        if (m_config.trace()) {
+            Trace::enable();
+            m_metricsServer.addRoute("/trace", "application/json", []() { return Trace::dump(); });
+        }
+
+        if (!m_metricsServer.start(m_config.metricsPort()))
+            return SDKERR_INVALID_PARAMETER;
+    }
+
     return SDKERR_SUCCESS;
 }
 
@@ -41,6 +115,8 @@ SDKError Zoom::createServices() {
     if (hasError(err)) return err;
 
     function<void()> onJoin = [&]() {
+        StartupTimeline::getInstance().mark("joined");
+
         auto* reminderController = m_meetingService->GetMeetingReminderController();
         reminderController->SetEvent(new MeetingReminderEvent());
 
@@ -58,6 +134,12 @@ SDKError Zoom::createServices() {
             auto recordingEvent = new MeetingRecordingCtrlEvent(onRecordingPrivilegeChanged);
             recordingCtrl->SetEvent(recordingEvent);
 
+            if (m_config.useRawVideo()) {
+                auto* audioCtrl = m_meetingService->GetMeetingAudioController();
+                if (audioCtrl)
+                    audioCtrl->SetEvent(new MeetingAudioCtrlEvent([&](const vector<unsigned int>& userIds) { onActiveSpeakers(userIds); }));
+            }
+
             startRawRecording();
         }
     };
@@ -65,6 +147,14 @@ SDKError Zoom::createServices() {
     auto meetingServiceEvent = new MeetingServiceEvent();
     meetingServiceEvent->setOnMeetingJoin(onJoin);
 
+    // the supervisor does not restart a worker whose meeting is over
+    if (isWorker()) {
+        meetingServiceEvent->setOnMeetingEnd([&]() {
+            tellSupervisor("ended");
+            raise(SIGTERM);
+        });
+    }
+
     err = m_meetingService->SetEvent(meetingServiceEvent);
     return err;
 }
@@ -90,6 +180,7 @@ SDKError Zoom::auth() {
     if (hasError(err)) return err;
 
     function<void()> onAuth = [&]() {
+        StartupTimeline::getInstance().mark("authorized");
         auto e = isMeetingStart() ? start() : join();
         string action = isMeetingStart() ? "start" : "join";
         
@@ -99,14 +190,108 @@ SDKError Zoom::auth() {
     err = m_authService->SetEvent(new AuthServiceEvent(onAuth));
     if (hasError(err)) return err;
 
-    generateJWT(m_config.clientId(), m_config.clientSecret());
+    // both were started by prepare() and should be done by now
+    if (m_sinks.valid()) {
+        StartupTimeline::Scope wait("sinks_wait");
+        err = m_sinks.get();
+        if (hasError(err, "start transcript sinks"))
+            return err;
+    }
+
+    if (m_signing.valid()) {
+        StartupTimeline::Scope wait("jwt_wait");
+        m_signing.get();
+    }
 
     AuthContext ctx;
-    ctx.jwt_token =  m_jwt.c_str();
+    ctx.jwt_token = jwt().c_str();
 
     return m_authService->SDKAuth(ctx);
 }
 
+SDKError Zoom::awaitMeeting() {
+    g_unix_fd_add(m_config.workerFd(), static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR), onSupervisor, this);
+
+    if (!tellSupervisor("ready"))
+        return SDKERR_INTERNAL_ERROR;
+
+    return SDKERR_SUCCESS;
+}
+
+gboolean Zoom::onSupervisor(gint fd, GIOCondition condition, gpointer data) {
+    auto* zoom = static_cast<Zoom*>(data);
+
+    char buf[1024];
+    auto n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n < 0 && errno == EAGAIN)
+        return G_SOURCE_CONTINUE;
+
+    // the supervisor is gone, and with it whoever would read our audio
+    if (n <= 0) {
+        Log::warn("supervisor went away, leaving");
+        raise(SIGTERM);
+        return G_SOURCE_REMOVE;
+    }
+
+    // join\t<meeting id>\t<password>\t<display name>
+    vector<string> fields;
+    stringstream message(string(buf, static_cast<size_t>(n)));
+    for (string field; getline(message, field, '\t');)
+        fields.push_back(field);
+
+    if (fields.size() < 3 || fields[0] != "join") {
+        Log::warn("unexpected message from the supervisor: " + fields[0]);
+        return G_SOURCE_CONTINUE;
+    }
+
+    zoom->m_config.setMeeting(fields[1], fields[2], fields.size() > 3 ? fields[3] : "");
+    Log::info("assigned meeting " + fields[1]);
+
+    auto err = zoom->auth();
+    if (hasError(err, "authorize"))
+        exit(err);
+
+    return G_SOURCE_CONTINUE;
+}
+
+bool Zoom::tellSupervisor(const string& message) {
+    if (!isWorker())
+        return false;
+
+    return send(m_config.workerFd(), message.data(), message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size());
+}
+
+string Zoom::outputDir(const string& dir) const {
+    if (!isWorker())
+        return dir;
+
+    // workers run side by side, so each writes its video and per-node audio under its own meeting
+    auto path = dir + "/" + m_config.meetingId();
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+        Log::error("unable to create " + path + ": " + string(strerror(errno)));
+
+    return path;
+}
+
+bool Zoom::isWorker() const {
+    return m_config.workerFd() >= 0;
+}
+
+bool Zoom::supervising() const {
+    return !m_config.meetings().empty() && !isWorker();
+}
+
+const Config& Zoom::settings() const {
+    return m_config;
+}
+
+const string& Zoom::jwt() {
+    if (m_jwt.empty() || chrono::system_clock::now() + c_jwtRenew >= m_exp)
+        generateJWT(m_config.clientId(), m_config.clientSecret());
+
+    return m_jwt;
+}
+
 void Zoom::generateJWT(const string& key, const string& secret) {
 
     m_iat = std::chrono::system_clock::now();
@@ -204,6 +389,49 @@ SDKError Zoom::leave() {
     return  m_meetingService->Leave(LEAVE_MEETING);
 }
 
+void Zoom::drain() {
+    string report;
+    auto phase = [&](const char* name, const function<void()>& work) {
+        auto start = Metrics::now();
+        work();
+        auto elapsed = Metrics::now() - start;
+
+        MetricsRegistry::getInstance().histogram("zoomsdk_shutdown_phase_seconds", "Time spent in each phase of a graceful shutdown",
+                                                 string("phase=\"") + name + "\"").record(elapsed);
+        Trace::record(name, "shutdown", start, elapsed);
+        report += (report.empty() ? "" : ", ") + string(name) + " " + to_string(elapsed / 1000000) + "ms";
+    };
+
+    phase("capture", [&]() {
+        if (m_audioHelper)
+            m_audioHelper->unSubscribe();
+    });
+
+    // Deepgram answers CloseStream with the results for audio it still holds, then closes
+    phase("close_stream", [&]() {
+        if (m_audioSource)
+            m_audioSource->drain();
+    });
+
+    size_t open = 0;
+    phase("results", [&]() {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(m_config.drainTimeout());
+        while (m_audioSource && (open = m_audioSource->openStreams()) && chrono::steady_clock::now() < deadline)
+            this_thread::sleep_for(chrono::milliseconds(10));
+    });
+
+    phase("flush", [&]() {
+        m_transcripts.close();
+        m_renderers.close();
+    });
+
+    if (open)
+        report += ", " + to_string(open) + " streams still open at the deadline";
+
+    Log::info("drained: " + report);
+    Log::flush();
+}
+
 SDKError Zoom::clean() {
     if (m_meetingService)
         DestroyMeetingService(m_meetingService);
@@ -217,8 +445,10 @@ SDKError Zoom::clean() {
     if (m_audioHelper)
         m_audioHelper->unSubscribe();
 
-    if (m_videoHelper)
-        m_videoHelper->unSubscribe();
+    m_renderers.close();
+
+    m_transcripts.close();
+    m_metricsServer.stop();
 
     return CleanUPSDK();
 }
@@ -238,17 +468,37 @@ SDKError Zoom::startRawRecording() {
     if (hasError(err, "start raw recording"))
         return err;
 
-    if (m_config.useRawVideo()) {
-        if (!m_videoSource) {
-            err = createRenderer(&m_videoHelper, m_videoSource);
-            if (hasError(err, "create raw video renderer"))
-                return err;
+    StartupTimeline::getInstance().mark("recording");
 
+    if (m_config.useRawVideo()) {
+        if (!m_renderers.active()) {
+            m_renderers.setCapacity(m_config.videoRenderers());
+            m_renderers.setResolution(ZoomSDKResolution_720P);
+            m_renderers.setDir(outputDir(m_config.videoDir()));
+            m_renderers.setFilename(m_config.videoFile());
+            m_renderers.setOnCreate([&](ZoomSDKRendererDelegate& source) {
+                source.setFps(m_config.videoFps());
+                source.setSize(m_config.videoWidth(), m_config.videoHeight());
+                source.setKeyframesOnly(m_config.videoKeyframes());
+                source.setStreamClock([&](uint64_t captureNs) {
+                    return m_audioSource ? m_audioSource->streamTimeAt(captureNs) : -1.0;
+                });
+                source.setOnSlideChange([&](const ZoomSDKRendererDelegate::SlideChange& slide) { onSlideChange(slide); });
+            });
+
+            // start with the first participants and follow whoever speaks from then on
             auto participantCtl = m_meetingService->GetMeetingParticipantsController();
-            int uid = participantCtl->GetParticipantsList()->GetItem(1);
+            auto* participants = participantCtl->GetParticipantsList();
+            auto* self = participantCtl->GetMySelfUser();
+
+            vector<unsigned int> userIds;
+            for (int i = 0; participants && i < participants->GetCount(); ++i) {
+                auto uid = participants->GetItem(i);
+                if (!self || uid != self->GetUserID())
+                    userIds.push_back(uid);
+            }
 
-            m_videoHelper->setRawDataResolution(ZoomSDKResolution_720P);
-            err = m_videoHelper->subscribe(uid, RAW_DATA_TYPE_VIDEO);
+            err = m_renderers.subscribe(userIds);
             if (hasError(err, "subscribe to raw video"))
                 return err;
         }
@@ -261,11 +511,30 @@ SDKError Zoom::startRawRecording() {
 
         if (!m_audioSource) {
             m_audioSource = new ZoomSDKAudioRawDataDelegate(!m_config.separateParticipantAudio());
-            m_audioSource->setDir(m_config.audioDir());
+            m_audioSource->setDir(outputDir(m_config.audioDir()));
             m_audioSource->setFilename(m_config.audioFile());
 
-            // Read and set deepgram-api-key from the config
-            m_audioSource->setDeepgramApiKey(m_config.deepgramApiKey());
+            // a worker only shares its audio; the supervisor's gateway transcribes it
+            auto backend = TranscriptionBackend::fromConfig(m_config);
+            if (isWorker())
+                backend.engine.clear();
+            m_audioSource->setBackend(backend);
+            m_audioSource->setOnResult([&](DeepgramResults& results) { onTranscript(results); });
+            m_audioSource->setGapThreshold(chrono::milliseconds(m_config.gapThreshold()));
+
+            if (isWorker()) {
+                // the gateway transcribes node 0, so separate participants are mixed down to it
+                m_audioSource->setMixdown(true);
+                if (!m_audioSource->setSharedMemory(m_config.workerSocket()))
+                    return SDKERR_INTERNAL_ERROR;
+                tellSupervisor("recording");
+            } else {
+                m_audioSource->setSessions(m_config.sessions());
+                m_audioSource->setMixdown(m_config.mixdown());
+                m_audioSource->setSharedMemory(m_config.audioShm());
+                if (m_config.hedge())
+                    m_audioSource->setHedge(m_config.hedgeUrl(), m_config.hedgeKey(), m_config.hedgeModel());
+            }
         }
 
         err = m_audioHelper->subscribe(m_audioSource);
@@ -284,6 +553,35 @@ SDKError Zoom::stopRawRecording() {
     return err;
 }
 
+void Zoom::onTranscript(DeepgramResults& results) {
+    if (results.is_final && !results.channel.alternatives.empty() && !results.channel.alternatives[0].transcript.empty())
+        StartupTimeline::getInstance().finish("first_transcript");
+
+    m_transcripts.onResult(results);
+}
+
+void Zoom::onActiveSpeakers(const vector<unsigned int>& userIds) {
+    auto* self = m_meetingService->GetMeetingParticipantsController()->GetMySelfUser();
+
+    vector<unsigned int> speakers;
+    for (auto uid : userIds)
+        if (!self || uid != self->GetUserID())
+            speakers.push_back(uid);
+
+    if (!speakers.empty())
+        m_renderers.onActiveSpeakers(speakers);
+}
+
+void Zoom::onSlideChange(const ZoomSDKRendererDelegate::SlideChange& slide) {
+    stringstream ss;
+    ss << "slide " << slide.index + 1 << " changed";
+    if (slide.streamSeconds >= 0)
+        ss << " at " << TranscriptExport::timecode(static_cast<uint64_t>(llround(slide.streamSeconds * 1000)), '.');
+    ss << " (" << llround(slide.score * 100) << "% of the picture)";
+
+    Log::info(ss.str());
+}
+
 bool Zoom::isMeetingStart() {
     return m_config.isMeetingStart();
 }
@@ -3,14 +3,24 @@
 
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <future>
+#include <thread>
 #include <string>
 #include <sstream>
 
 #include <jwt-cpp/jwt.h>
+#include <glib.h>
 
 #include "Config.h"
 #include "util/Singleton.h"
 #include "util/Log.h"
+#include "util/Metrics.h"
+#include "util/MetricsServer.h"
+#include "util/ProcessStats.h"
+#include "util/StartupTimeline.h"
+#include "util/Threads.h"
+#include "util/Trace.h"
 
 #include "zoom_sdk.h"
 #include "rawdata/zoom_rawdata_api.h"
@@ -24,10 +34,15 @@
 #include "events/MeetingServiceEvent.h"
 #include "events/MeetingReminderEvent.h"
 #include "events/MeetingRecordingCtrlEvent.h"
+#include "events/MeetingAudioCtrlEvent.h"
 
 #include "raw-stream/ZoomSDKRendererDelegate.h"
+#include "raw-stream/RendererManager.h"
 #include "raw-stream/ZoomSDKAudioRawDataDelegate.h"
 
+#include "transcript/TranscriptExport.h"
+#include "transcript/TranscriptSinks.h"
+
 using namespace std;
 using namespace jwt;
 using namespace ZOOMSDK;
@@ -49,24 +64,73 @@ class Zoom : public Singleton<Zoom> {
     ISettingService* m_settingService;
     IAuthService* m_authService;
 
-    IZoomSDKRenderer* m_videoHelper;
-    ZoomSDKRendererDelegate* m_videoSource;
+    RendererManager m_renderers;
 
     IZoomSDKAudioRawDataHelper* m_audioHelper;
     ZoomSDKAudioRawDataDelegate* m_audioSource;
 
+    TranscriptSinks m_transcripts;
+
+    MetricsServer m_metricsServer;
+
+    future<SDKError> m_sinks;
+    future<void> m_signing;
+    future<bool> m_warmup;
+
     SDKError createServices();
+    SDKError startSinks();
+    void onTranscript(DeepgramResults& results);
+    void onActiveSpeakers(const vector<unsigned int>& userIds);
+    void onSlideChange(const ZoomSDKRendererDelegate::SlideChange& slide);
     void generateJWT(const string& key, const string& secret);
 
+    /**
+     * @return the signed JWT, signed again once it is close to expiring
+     */
+    const string& jwt();
+
+    /**
+     * Join the meeting a message from the supervisor assigns, or leave once the supervisor is gone
+     */
+    static gboolean onSupervisor(gint fd, GIOCondition condition, gpointer data);
+    bool tellSupervisor(const string& message);
+
+    /**
+     * @return dir itself, or for a worker its meeting's subdirectory of dir, created if missing
+     */
+    string outputDir(const string& dir) const;
+
 public:
+    /**
+     * Start the work that does not need the SDK in the background, to overlap with init():
+     * transcript sinks and the metrics server, JWT signing and a TLS connection to the transcription endpoint
+     */
+    SDKError prepare();
     SDKError init();
     SDKError auth();
     SDKError config(int ac, char** av);
 
+    /**
+     * As a supervisor's worker: report ready and authorize once a meeting is assigned
+     */
+    SDKError awaitMeeting();
+    bool isWorker() const;
+
+    /**
+     * @return true if the config lists meetings for worker processes and this is not one of them
+     */
+    bool supervising() const;
+    const Config& settings() const;
+
     SDKError join();
     SDKError start();
     SDKError leave();
 
+    /**
+     * Stop capture, wait up to the drain timeout for the transcription streams' last results, then flush every sink
+     */
+    void drain();
+
     SDKError clean();
 
     SDKError startRawRecording();
@@ -0,0 +1,25 @@
+#include "MeetingAudioCtrlEvent.h"
+
+MeetingAudioCtrlEvent::MeetingAudioCtrlEvent(function<void(const vector<unsigned int>&)> onActiveSpeakerChange) : m_onActiveSpeakerChange(onActiveSpeakerChange) {
+}
+
+MeetingAudioCtrlEvent::~MeetingAudioCtrlEvent() {}
+
+void MeetingAudioCtrlEvent::onUserActiveAudioChange(IList<unsigned int>* plstActiveAudio) {
+    if (!m_onActiveSpeakerChange || !plstActiveAudio)
+        return;
+
+    vector<unsigned int> userIds;
+    for (int i = 0; i < plstActiveAudio->GetCount(); ++i)
+        userIds.push_back(plstActiveAudio->GetItem(i));
+
+    m_onActiveSpeakerChange(userIds);
+}
+
+void MeetingAudioCtrlEvent::onUserAudioStatusChange(IList<IUserAudioStatus*>* lstAudioStatusChange, const zchar_t* strAudioStatusList) {}
+
+void MeetingAudioCtrlEvent::onHostRequestStartAudio(IRequestStartAudioHandler* handler) {}
+
+void MeetingAudioCtrlEvent::onJoin3rdPartyTelephonyAudio(const zchar_t* audioInfo) {}
+
+void MeetingAudioCtrlEvent::onMuteOnEntryStatusChange(bool bEnabled) {}
@@ -0,0 +1,53 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_MEETINGAUDIOCTRLEVENT_H
+#define MEETING_SDK_LINUX_SAMPLE_MEETINGAUDIOCTRLEVENT_H
+
+#include <iostream>
+#include <functional>
+#include <vector>
+#include "meeting_service_components/meeting_audio_interface.h"
+
+using namespace std;
+using namespace ZOOMSDK;
+
+class MeetingAudioCtrlEvent : public IMeetingAudioCtrlEvent {
+
+    function<void(const vector<unsigned int>&)> m_onActiveSpeakerChange;
+
+public:
+    MeetingAudioCtrlEvent(function<void(const vector<unsigned int>&)> onActiveSpeakerChange);
+    ~MeetingAudioCtrlEvent();
+
+    /**
+     * Fires when the audio status of users changes
+     * @param lstAudioStatusChange users whose audio status changed
+     * @param strAudioStatusList the same list as a json string
+     */
+    void onUserAudioStatusChange(IList<IUserAudioStatus*>* lstAudioStatusChange, const zchar_t* strAudioStatusList = nullptr) override;
+
+    /**
+     * Fires when the users who are currently speaking change
+     * @param plstActiveAudio user IDs of the active speakers
+     */
+    void onUserActiveAudioChange(IList<unsigned int>* plstActiveAudio) override;
+
+    /**
+     * Fires when the host asks to unmute this user
+     * @param handler accepts or declines the request
+     */
+    void onHostRequestStartAudio(IRequestStartAudioHandler* handler) override;
+
+    /**
+     * Fires when this user joins third party telephony audio
+     * @param audioInfo telephony audio information
+     */
+    void onJoin3rdPartyTelephonyAudio(const zchar_t* audioInfo) override;
+
+    /**
+     * Fires when mute on entry is turned on or off
+     * @param bEnabled true if users are muted when they join
+     */
+    void onMuteOnEntryStatusChange(bool bEnabled) override;
+};
+
+
+#endif //MEETING_SDK_LINUX_SAMPLE_MEETINGAUDIOCTRLEVENT_H
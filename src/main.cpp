@@ -1,18 +1,34 @@
+#include <atomic>
 #include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include "Config.h"
 #include "Zoom.h"
+#include "supervisor/Supervisor.h"
 
+namespace {
+    // the signal handler only writes the signal number here; the event loop does the rest
+    int g_signalPipe[2] = {-1, -1};
+    atomic<int> g_signals{0};
+    int g_exitCode = 0;
+}
 
 /**
  *  Callback fired atexit()
  */
 void onExit() {
     auto* zoom = &Zoom::getInstance();
-    zoom->leave();
-    zoom->clean();
 
-    cout << "exiting..." << endl;
+    // the supervisor never initializes the SDK
+    if (!zoom->supervising()) {
+        zoom->leave();
+        zoom->clean();
+    }
+
+    Log::info("exiting...");
+    Log::flush();
 }
 
 /**
@@ -20,18 +36,37 @@ void onExit() {
  * @param signal type of signal
  */
 void onSignal(int signal) {
-    onExit();
-    _Exit(signal);
-}
+    // a second signal does not wait for the drain
+    if (g_signals.fetch_add(1))
+        _Exit(signal);
 
+    auto byte = static_cast<unsigned char>(signal);
+    if (write(g_signalPipe[1], &byte, 1) != 1)
+        _Exit(signal);
+}
 
 /**
- * Callback for glib event loop
- * @param data event data
- * @return always TRUE
+ * Callback for glib event loop when a signal has been trapped: drain, then leave the loop
+ * @param fd read end of the signal pipe
+ * @param condition ready condition
+ * @param data event loop
+ * @return always FALSE, the watch is done
  */
-gboolean onTimeout (gpointer data) {
-    return TRUE;
+gboolean onSignalPipe(gint fd, GIOCondition condition, gpointer data) {
+    unsigned char signal = 0;
+    if (read(fd, &signal, 1) != 1)
+        return G_SOURCE_CONTINUE;
+
+    Log::info("caught signal " + to_string(signal) + ", draining");
+    auto* zoom = &Zoom::getInstance();
+    if (zoom->supervising())
+        Supervisor::getInstance().drain();
+    else
+        zoom->drain();
+
+    g_exitCode = signal;
+    g_main_loop_quit(static_cast<GMainLoop*>(data));
+    return G_SOURCE_REMOVE;
 }
 
 /**
@@ -44,23 +79,54 @@ SDKError run(int argc, char** argv) {
     SDKError err{SDKERR_SUCCESS};
     auto* zoom = &Zoom::getInstance();
 
+    // signals that arrive before the event loop runs wait in the pipe
+    if (pipe2(g_signalPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        Log::error("failed to create the signal pipe");
+        return SDKERR_INTERNAL_ERROR;
+    }
+
     signal(SIGINT, onSignal);
     signal(SIGTERM, onSignal);
 
     atexit(onExit);
 
     // read the CLI and config.ini file
-    err = zoom->config(argc, argv);
+    {
+        StartupTimeline::Scope phase("config");
+        err = zoom->config(argc, argv);
+    }
     if (Zoom::hasError(err, "configure"))
         return err;
 
+    // one worker process per meeting does the rest
+    if (zoom->supervising())
+        return Supervisor::getInstance().start(zoom->settings(), argc, argv);
+
+    // sinks, JWT signing and TLS warm-up run while the SDK initializes
+    err = zoom->prepare();
+    if (Zoom::hasError(err, "prepare"))
+        return err;
+
     // initialize the Zoom SDK
-    err = zoom->init();
+    {
+        StartupTimeline::Scope phase("sdk_init");
+        err = zoom->init();
+    }
     if(Zoom::hasError(err, "initialize"))
         return err;
 
+    // a worker authorizes once the supervisor assigns it a meeting
+    if (zoom->isWorker()) {
+        err = zoom->awaitMeeting();
+        Zoom::hasError(err, "reach the supervisor");
+        return err;
+    }
+
     // authorize with the Zoom SDK
-    err = zoom->auth();
+    {
+        StartupTimeline::Scope phase("auth_request");
+        err = zoom->auth();
+    }
     if (Zoom::hasError(err, "authorize"))
         return err;
 
@@ -68,6 +134,9 @@ SDKError run(int argc, char** argv) {
 }
 
 int main(int argc, char **argv) {
+    // startup times are measured from here
+    StartupTimeline::getInstance();
+
     // Run the Meeting Bot
     SDKError err = run(argc, argv);
 
@@ -77,10 +146,15 @@ int main(int argc, char **argv) {
     // Use an event loop to receive callbacks
     GMainLoop* eventLoop;
     eventLoop = g_main_loop_new(NULL, FALSE);
-    g_timeout_add(100, onTimeout, eventLoop);
+    // the SDK and the signal pipe wake the loop; nothing needs it on a timer
+    g_unix_fd_add(g_signalPipe[0], G_IO_IN, onSignalPipe, eventLoop);
+
+    if (Zoom::getInstance().supervising())
+        Supervisor::getInstance().setOnFinished([eventLoop]() { g_main_loop_quit(eventLoop); });
+
     g_main_loop_run(eventLoop);
 
-    return err;
+    return g_exitCode;
 }
 
 
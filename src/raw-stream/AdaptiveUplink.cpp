@@ -0,0 +1,469 @@
+#include "AdaptiveUplink.h"
+
+#include <algorithm>
+
+#include "AudioDsp.h"
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+namespace {
+    // decisions need fresh numbers, not a syscall per 10 ms frame
+    constexpr uint64_t c_sampleNs = 100000000;
+    // marks kept per stream, far more than results ever reach back
+    constexpr size_t c_maxMarks = 4096;
+
+    struct UplinkMetrics {
+        Counter& down;
+        Counter& up;
+        Counter& skipped;
+        Histogram& switchTime;
+        Gauge* streams[AdaptiveUplink::TIERS];
+        Counter* milliseconds[AdaptiveUplink::TIERS];
+    };
+
+    UplinkMetrics& uplinkMetrics() {
+        static UplinkMetrics* metrics = [] {
+            auto& registry = MetricsRegistry::getInstance();
+            auto* m = new UplinkMetrics{
+                registry.counter("zoomsdk_uplink_tier_changes_total", "Times the transcription uplink changed tier", "direction=\"down\""),
+                registry.counter("zoomsdk_uplink_tier_changes_total", "Times the transcription uplink changed tier", "direction=\"up\""),
+                registry.counter("zoomsdk_uplink_skipped_bytes_total", "Audio bytes not sent because the uplink only carries speech"),
+                registry.histogram("zoomsdk_uplink_switch_seconds", "Time to connect the stream for a new tier"),
+                {},
+                {}
+            };
+
+            for (int tier = 0; tier < AdaptiveUplink::TIERS; ++tier) {
+                string labels = string("tier=\"") + AdaptiveUplink::name(static_cast<AdaptiveUplink::Tier>(tier)) + "\"";
+                m->streams[tier] = &registry.gauge("zoomsdk_uplink_streams", "Transcription streams currently sending at each tier", labels);
+                m->milliseconds[tier] = &registry.counter("zoomsdk_uplink_tier_milliseconds_total", "Time transcription streams spent sending at each tier", labels);
+            }
+
+            return m;
+        }();
+
+        return *metrics;
+    }
+
+    uint64_t toNs(chrono::milliseconds ms) {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(ms).count());
+    }
+}
+
+const char* AdaptiveUplink::name(Tier tier) {
+    switch (tier) {
+        case FULL: return "full";
+        case WIDEBAND: return "wideband";
+        case NARROWBAND: return "narrowband";
+        case VOICE: return "voice";
+        default: return "unknown";
+    }
+}
+
+AdaptiveUplink::AdaptiveUplink(const TranscriptionBackend::Options& engine, const Options& options)
+    : m_engine(engine), m_options(options), m_upAfterNs(toNs(options.upAfter)) {
+    // the streams underneath are plain engines
+    m_engine.adaptive = false;
+    uplinkMetrics();
+}
+
+AdaptiveUplink::~AdaptiveUplink() {
+    close();
+}
+
+void AdaptiveUplink::formatOf(Tier tier, int& sampleRate, string& encoding) const {
+    sampleRate = m_sampleRate;
+    encoding = "linear16";
+
+    // rates that are not a whole multiple stay as they are
+    if (tier >= WIDEBAND && m_sampleRate > 16000 && m_sampleRate % 16000 == 0)
+        sampleRate = 16000;
+    if (tier >= NARROWBAND && m_sampleRate % 8000 == 0) {
+        sampleRate = 8000;
+        encoding = "mulaw";
+    }
+}
+
+unique_ptr<AdaptiveUplink::Stream> AdaptiveUplink::makeStream(Tier tier) {
+    auto stream = make_unique<Stream>();
+    stream->tier = tier;
+    formatOf(tier, stream->sampleRate, stream->encoding);
+
+    stream->backend = TranscriptionBackend::create(m_engine);
+    if (stream->backend) {
+        auto* raw = stream.get();
+        stream->backend->setOnResult([this, raw](DeepgramResults& results) { onResult(*raw, results); });
+    }
+
+    return stream;
+}
+
+bool AdaptiveUplink::open(int sampleRate, int channels, const string& encoding) {
+    close();
+
+    if (encoding != "linear16") {
+        Log::error("adaptive uplink needs linear16 input, not " + encoding);
+        return false;
+    }
+
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    m_inputSeconds = 0;
+    m_tier = FULL;
+    m_highSinceNs = m_lowSinceNs = m_upNs = 0;
+    m_upAfterNs = toNs(m_options.upAfter);
+    m_lastPushNs = 0;
+
+    auto stream = makeStream(FULL);
+    if (!stream->backend || !stream->backend->open(stream->sampleRate, m_channels, stream->encoding))
+        return false;
+
+    promote(std::move(stream), Metrics::now());
+    return true;
+}
+
+void AdaptiveUplink::connect(Tier tier, uint64_t now) {
+    if (m_connector.joinable())
+        m_connector.join();
+
+    m_next = makeStream(tier);
+    if (!m_next->backend) {
+        m_next.reset();
+        return;
+    }
+
+    // the audio thread leaves m_next alone until this is cleared
+    m_connecting.store(true, memory_order_release);
+    m_connectNs = now;
+
+    auto* next = m_next.get();
+    m_connector = Thread("uplink-connect", [this, next]() {
+        next->backend->open(next->sampleRate, m_channels, next->encoding);
+        m_connecting.store(false, memory_order_release);
+    });
+}
+
+void AdaptiveUplink::promote(unique_ptr<Stream> next, uint64_t now) {
+    auto& metrics = uplinkMetrics();
+    metrics.streams[next->tier]->add(1);
+
+    unique_ptr<Stream> previous;
+    {
+        lock_guard<mutex> lock(m_lock);
+        // the new stream's first second is the input's next
+        next->marks.push_back({0, m_inputSeconds});
+        previous = std::move(m_current);
+        m_current = std::move(next);
+    }
+
+    if (!previous)
+        return;
+
+    metrics.streams[previous->tier]->add(-1);
+    // ask for the last finals; the stream is closed once they have had time to arrive
+    previous->backend->flush();
+    previous->closeNs = now + toNs(m_options.drain);
+
+    lock_guard<mutex> lock(m_lock);
+    m_draining.push_back(std::move(previous));
+}
+
+void AdaptiveUplink::settle(uint64_t now) {
+    if (m_next && !m_connecting.load(memory_order_acquire)) {
+        m_connector.join();
+
+        if (m_next->backend->isOpen()) {
+            uplinkMetrics().switchTime.record(now - m_connectNs);
+            Log::info(string("transcription uplink now sending at ") + name(m_next->tier) + ", " +
+                      to_string(m_next->sampleRate) + " Hz " + m_next->encoding);
+            promote(std::move(m_next), now);
+        } else {
+            Log::warn(string("transcription stream for tier ") + name(m_next->tier) + " failed to connect");
+            m_next.reset();
+            m_retryNs = now + toNs(m_options.retry);
+        }
+    }
+
+    // close drained streams outside the lock, their result threads need it to finish
+    vector<unique_ptr<Stream>> done;
+    {
+        lock_guard<mutex> lock(m_lock);
+        for (auto it = m_draining.begin(); it != m_draining.end();) {
+            if (now >= (*it)->closeNs) {
+                done.push_back(std::move(*it));
+                it = m_draining.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& stream : done)
+        stream->backend->close();
+
+    // a dropped stream is replaced at the tier it was wanted at
+    if (m_current && !m_current->backend->isOpen() && !m_next && now >= m_retryNs) {
+        static LogRateLimit limit(chrono::seconds(10));
+        Log::throttled(limit, Log::WARN, "transcription stream closed, reconnecting");
+        connect(m_tier, now);
+    }
+}
+
+double AdaptiveUplink::pressure(uint64_t now) {
+    if (now - m_sampleNs < c_sampleNs)
+        return m_pressure;
+    m_sampleNs = now;
+
+    auto backlog = m_current->backend->backlog();
+    double queue = backlog.queueLimit ? static_cast<double>(backlog.queued) / backlog.queueLimit : 0;
+    double socket = backlog.sendBuffer ? static_cast<double>(backlog.unsent) / backlog.sendBuffer : 0;
+
+    double lag = 0;
+    {
+        lock_guard<mutex> lock(m_lock);
+        // a stream that has not answered yet may just be slow to start
+        if (m_current->heard > 0)
+            lag = (m_current->pushed - m_current->heard) / (m_options.lagLimit.count() / 1000.0);
+    }
+
+    m_pressure = max({queue, socket, lag});
+    return m_pressure;
+}
+
+AdaptiveUplink::Tier AdaptiveUplink::decide(double pressure, uint64_t now) {
+    auto& metrics = uplinkMetrics();
+
+    if (pressure > m_options.high) {
+        m_lowSinceNs = 0;
+        if (!m_highSinceNs)
+            m_highSinceNs = now;
+
+        if (m_tier < VOICE && now - m_highSinceNs >= toNs(m_options.downAfter)) {
+            // falling back soon after recovering means the link is not as good as it looked
+            if (m_upNs && now - m_upNs < toNs(m_options.relapse))
+                m_upAfterNs = min(m_upAfterNs * 2, toNs(m_options.maxUpAfter));
+            else
+                m_upAfterNs = toNs(m_options.upAfter);
+
+            m_tier = static_cast<Tier>(m_tier + 1);
+            m_highSinceNs = 0;
+            metrics.down.inc();
+        }
+    } else if (pressure < m_options.low) {
+        m_highSinceNs = 0;
+        if (!m_lowSinceNs)
+            m_lowSinceNs = now;
+
+        if (m_tier > FULL && now - m_lowSinceNs >= m_upAfterNs) {
+            m_tier = static_cast<Tier>(m_tier - 1);
+            m_lowSinceNs = 0;
+            m_upNs = now;
+            metrics.up.inc();
+        }
+    } else {
+        m_highSinceNs = m_lowSinceNs = 0;
+    }
+
+    return m_tier;
+}
+
+void AdaptiveUplink::account(uint64_t now) {
+    if (m_lastPushNs && now > m_lastPushNs)
+        m_unaccountedNs += now - m_lastPushNs;
+    m_lastPushNs = now;
+
+    if (m_unaccountedNs >= 1000000) {
+        uplinkMetrics().milliseconds[m_current->tier]->inc(m_unaccountedNs / 1000000);
+        m_unaccountedNs %= 1000000;
+    }
+}
+
+bool AdaptiveUplink::push(char* data, size_t len) {
+    if (!m_current)
+        return false;
+
+    auto now = Metrics::now();
+    settle(now);
+    account(now);
+
+    // decisions wait for a switch in progress to land
+    if (!m_next) {
+        auto tier = decide(pressure(now), now);
+        if (tier != m_current->tier) {
+            int sampleRate;
+            string encoding;
+            formatOf(tier, sampleRate, encoding);
+
+            if (sampleRate != m_current->sampleRate || encoding != m_current->encoding) {
+                if (now >= m_retryNs)
+                    connect(tier, now);
+            } else {
+                auto& metrics = uplinkMetrics();
+                metrics.streams[m_current->tier]->add(-1);
+                metrics.streams[tier]->add(1);
+                Log::info(string("transcription uplink now sending at ") + name(tier));
+
+                lock_guard<mutex> lock(m_lock);
+                m_current->tier = tier;
+            }
+        }
+    }
+
+    if (!send(*m_current, data, len))
+        return false;
+
+    m_inputSeconds += static_cast<double>(len / sizeof(int16_t) / m_channels) / m_sampleRate;
+    return true;
+}
+
+bool AdaptiveUplink::send(Stream& stream, char* data, size_t len) {
+    const auto* samples = reinterpret_cast<const int16_t*>(data);
+    size_t count = len / sizeof(int16_t);
+    size_t frames = count / m_channels;
+
+    if (stream.tier == VOICE) {
+        // timed in audio rather than on the clock, so late callbacks do not cut words short
+        if (AudioDsp::levelDb(samples, count) > m_options.voiceDb)
+            m_voiceUntil = m_inputSeconds + m_options.hangover.count() / 1000.0;
+
+        // silence counts as taken; the next run of speech is marked where it falls in the input
+        if (m_inputSeconds >= m_voiceUntil) {
+            uplinkMetrics().skipped.inc(len);
+            lock_guard<mutex> lock(m_lock);
+            stream.skipping = true;
+            return true;
+        }
+    }
+
+    char* out = data;
+    size_t outLen = len;
+    int factor = m_sampleRate / stream.sampleRate;
+
+    if (factor > 1 || stream.encoding == "mulaw") {
+        m_resampled.resize(frames / factor * m_channels);
+        auto outFrames = AudioDsp::decimate(m_resampled.data(), samples, frames, m_channels, factor);
+        outLen = outFrames * m_channels * sizeof(int16_t);
+        out = reinterpret_cast<char*>(m_resampled.data());
+
+        if (stream.encoding == "mulaw") {
+            m_encoded.resize(outFrames * m_channels);
+            AudioDsp::mulaw(m_encoded.data(), m_resampled.data(), m_encoded.size());
+            outLen = m_encoded.size();
+            out = reinterpret_cast<char*>(m_encoded.data());
+        }
+    }
+
+    if (!stream.backend->push(out, outLen))
+        return false;
+
+    lock_guard<mutex> lock(m_lock);
+    if (stream.skipping) {
+        stream.marks.push_back({stream.pushed, m_inputSeconds});
+        if (stream.marks.size() > c_maxMarks)
+            stream.marks.pop_front();
+        stream.skipping = false;
+    }
+    stream.pushed += static_cast<double>(frames) / m_sampleRate;
+    return true;
+}
+
+double AdaptiveUplink::inputTimeAt(const Stream& stream, double seconds) const {
+    auto it = upper_bound(stream.marks.begin(), stream.marks.end(), seconds,
+                          [](double t, const Mark& mark) { return t < mark.stream; });
+    if (it == stream.marks.begin())
+        return seconds;
+
+    --it;
+    return it->input + (seconds - it->stream);
+}
+
+void AdaptiveUplink::onResult(Stream& stream, DeepgramResults& results) {
+    lock_guard<mutex> lock(m_lock);
+
+    if (results.type == "Results") {
+        double end = results.start + max(0.0, results.duration);
+        stream.heard = max(stream.heard, end);
+
+        // from the stream's own seconds onto the input's
+        double start = inputTimeAt(stream, results.start);
+        results.duration = max(0.0, inputTimeAt(stream, end) - start);
+        results.start = start;
+        for (auto& alternative : results.channel.alternatives) {
+            for (auto& word : alternative.words) {
+                word.start = inputTimeAt(stream, word.start);
+                word.end = inputTimeAt(stream, word.end);
+            }
+        }
+    }
+
+    if (m_onResult)
+        m_onResult(results);
+}
+
+bool AdaptiveUplink::flush() {
+    return m_current && m_current->backend->flush();
+}
+
+bool AdaptiveUplink::keepAlive() {
+    return m_current && m_current->backend->keepAlive();
+}
+
+bool AdaptiveUplink::closeStream() {
+    // taken out while they are closed: a closing engine may deliver results, and onResult needs the lock
+    vector<unique_ptr<Stream>> draining;
+    {
+        lock_guard<mutex> lock(m_lock);
+        draining.swap(m_draining);
+    }
+
+    for (auto& stream : draining)
+        stream->backend->closeStream();
+
+    {
+        lock_guard<mutex> lock(m_lock);
+        for (auto& stream : draining)
+            m_draining.push_back(std::move(stream));
+    }
+
+    return m_current && m_current->backend->closeStream();
+}
+
+void AdaptiveUplink::close() {
+    if (m_connector.joinable())
+        m_connector.join();
+
+    vector<unique_ptr<Stream>> streams;
+    {
+        lock_guard<mutex> lock(m_lock);
+        if (m_current) {
+            uplinkMetrics().streams[m_current->tier]->add(-1);
+            streams.push_back(std::move(m_current));
+        }
+        for (auto& stream : m_draining)
+            streams.push_back(std::move(stream));
+        m_draining.clear();
+    }
+    if (m_next)
+        streams.push_back(std::move(m_next));
+
+    for (auto& stream : streams)
+        stream->backend->close();
+}
+
+bool AdaptiveUplink::isOpen() const {
+    return m_current && m_current->backend->isOpen();
+}
+
+void AdaptiveUplink::setOnResult(const function<void(DeepgramResults&)>& callback) {
+    lock_guard<mutex> lock(m_lock);
+    m_onResult = callback;
+}
+
+TranscriptionBackend::Backlog AdaptiveUplink::backlog() {
+    return m_current ? m_current->backend->backlog() : Backlog();
+}
+
+AdaptiveUplink::Tier AdaptiveUplink::tier() {
+    lock_guard<mutex> lock(m_lock);
+    return m_current ? m_current->tier : FULL;
+}
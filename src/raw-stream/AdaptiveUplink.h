@@ -0,0 +1,162 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_ADAPTIVEUPLINK_H
+#define MEETING_SDK_LINUX_SAMPLE_ADAPTIVEUPLINK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "TranscriptionBackend.h"
+#include "../util/Threads.h"
+
+using namespace std;
+
+/**
+ * Wraps a transcription engine and trades audio quality for bandwidth when
+ * the uplink cannot keep up.
+ *
+ * Pressure is the worst of three ratios: frames queued in the process
+ * against the queue's limit, bytes the kernel has not had acknowledged
+ * against the socket's send buffer, and audio sent but not yet transcribed
+ * against lagLimit. Pressure above high for downAfter steps down one tier:
+ *
+ *   FULL        16-bit PCM at the capture rate
+ *   WIDEBAND    16-bit PCM at 16 kHz
+ *   NARROWBAND  mu-law at 8 kHz, a quarter of WIDEBAND's bytes
+ *   VOICE       mu-law at 8 kHz, only while someone is speaking
+ *
+ * Pressure below low for upAfter steps back up. A step down soon after a
+ * step up doubles upAfter, so a link on the edge does not flap.
+ *
+ * A new format needs a new stream, which connects in the background while
+ * the old one keeps sending; the old one is then finalized and left to
+ * deliver its last results. Results from every stream are moved onto the
+ * timeline of the audio pushed here, silence skipped in VOICE included,
+ * so callers see one continuous stream.
+ */
+class AdaptiveUplink : public TranscriptionBackend {
+public:
+    enum Tier { FULL, WIDEBAND, NARROWBAND, VOICE, TIERS };
+
+    struct Options {
+        // pressure above which the uplink counts as congested, and below which as clear
+        double high = 0.75;
+        double low = 0.25;
+        // audio sent but not yet transcribed that counts as full pressure
+        chrono::milliseconds lagLimit{4000};
+        // how long pressure must stay high before stepping down, and low before stepping up
+        chrono::milliseconds downAfter{1000};
+        chrono::milliseconds upAfter{10000};
+        // a step down this soon after a step up doubles upAfter, up to maxUpAfter
+        chrono::milliseconds relapse{30000};
+        chrono::milliseconds maxUpAfter{160000};
+        // VOICE: level below which a frame is silence, and how long speech keeps frames going after
+        double voiceDb = -45;
+        chrono::milliseconds hangover{500};
+        // how long a replaced stream may still deliver results
+        chrono::milliseconds drain{3000};
+        chrono::milliseconds retry{2000};
+    };
+
+    static const char* name(Tier tier);
+
+private:
+    struct Mark {
+        double stream;
+        double input;
+    };
+
+    struct Stream {
+        unique_ptr<TranscriptionBackend> backend;
+        Tier tier = FULL;
+        int sampleRate = 0;
+        string encoding;
+
+        // seconds sent, and where each run of them starts in the input once silence was skipped
+        double pushed = 0;
+        deque<Mark> marks;
+        bool skipping = false;
+
+        // end of the latest result, in seconds sent
+        double heard = 0;
+        uint64_t closeNs = 0;
+    };
+
+    TranscriptionBackend::Options m_engine;
+    Options m_options;
+
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    double m_inputSeconds = 0;
+
+    // stream positions, shared with the threads results arrive on
+    mutex m_lock;
+    unique_ptr<Stream> m_current;
+    vector<unique_ptr<Stream>> m_draining;
+    function<void(DeepgramResults&)> m_onResult;
+
+    unique_ptr<Stream> m_next;
+    atomic<bool> m_connecting{false};
+    Thread m_connector;
+    uint64_t m_connectNs = 0;
+    uint64_t m_retryNs = 0;
+
+    Tier m_tier = FULL;
+    double m_pressure = 0;
+    uint64_t m_sampleNs = 0;
+    uint64_t m_highSinceNs = 0;
+    uint64_t m_lowSinceNs = 0;
+    uint64_t m_upNs = 0;
+    uint64_t m_upAfterNs = 0;
+    double m_voiceUntil = 0;
+    uint64_t m_lastPushNs = 0;
+    uint64_t m_unaccountedNs = 0;
+
+    vector<int16_t> m_resampled;
+    vector<uint8_t> m_encoded;
+
+    void formatOf(Tier tier, int& sampleRate, string& encoding) const;
+    unique_ptr<Stream> makeStream(Tier tier);
+    void connect(Tier tier, uint64_t now);
+    void settle(uint64_t now);
+    void promote(unique_ptr<Stream> next, uint64_t now);
+    double pressure(uint64_t now);
+    Tier decide(double pressure, uint64_t now);
+    bool send(Stream& stream, char* data, size_t len);
+    void onResult(Stream& stream, DeepgramResults& results);
+    double inputTimeAt(const Stream& stream, double seconds) const;
+    void account(uint64_t now);
+
+public:
+    AdaptiveUplink(const TranscriptionBackend::Options& engine, const Options& options);
+    ~AdaptiveUplink() override;
+
+    /**
+     * Connect at FULL; only linear16 input is supported
+     */
+    bool open(int sampleRate, int channels, const string& encoding = "linear16") override;
+    bool push(char* data, size_t len) override;
+    bool flush() override;
+    bool keepAlive() override;
+
+    /**
+     * End the current stream and any still draining
+     */
+    bool closeStream() override;
+    void close() override;
+    bool isOpen() const override;
+    void setOnResult(const function<void(DeepgramResults&)>& callback) override;
+    Backlog backlog() override;
+
+    /**
+     * @return the tier audio is currently sent at
+     */
+    Tier tier();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_ADAPTIVEUPLINK_H
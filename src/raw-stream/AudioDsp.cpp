@@ -0,0 +1,199 @@
+#include "AudioDsp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+uint64_t AudioDsp::sumSquares(const int16_t* samples, size_t count) {
+    uint64_t total = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+
+        // each pair sums to at most 2^31, which fits when read as unsigned
+        __m128i pairs = _mm_madd_epi16(v, v);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(pairs, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(pairs, zero));
+    }
+
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    total = lanes[0] + lanes[1];
+#endif
+
+    for (; i < count; ++i)
+        total += static_cast<uint64_t>(static_cast<int32_t>(samples[i]) * samples[i]);
+
+    return total;
+}
+
+AudioDsp::Stats AudioDsp::stats(const int16_t* samples, size_t count, int16_t clipLevel) {
+    Stats result{0, 0, 0, 0};
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i below = _mm_set1_epi16(static_cast<int16_t>(clipLevel - 1));
+    __m128i squares = zero;
+    __m128i peak = zero;
+
+    while (i + 8 <= count) {
+        // 16-bit clip counts and 32-bit sums are flushed before they can wrap
+        __m128i clipped = zero;
+        __m128i sum = zero;
+        size_t blockEnd = min(count, i + 8 * 8192);
+
+        for (; i + 8 <= blockEnd; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+
+            // saturating negate turns -32768 into 32767
+            __m128i magnitude = _mm_max_epi16(v, _mm_subs_epi16(zero, v));
+            peak = _mm_max_epi16(peak, magnitude);
+            clipped = _mm_sub_epi16(clipped, _mm_cmpgt_epi16(magnitude, below));
+
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, ones));
+
+            __m128i pairs = _mm_madd_epi16(v, v);
+            squares = _mm_add_epi64(squares, _mm_unpacklo_epi32(pairs, zero));
+            squares = _mm_add_epi64(squares, _mm_unpackhi_epi32(pairs, zero));
+        }
+
+        alignas(16) int32_t sums[4];
+        alignas(16) uint16_t counts[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+        _mm_store_si128(reinterpret_cast<__m128i*>(counts), clipped);
+
+        for (auto s : sums)
+            result.sum += s;
+        for (auto c : counts)
+            result.clipped += c;
+    }
+
+    alignas(16) uint64_t lanes[2];
+    alignas(16) uint16_t peaks[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), squares);
+    _mm_store_si128(reinterpret_cast<__m128i*>(peaks), peak);
+
+    result.sumSquares = lanes[0] + lanes[1];
+    for (auto p : peaks)
+        result.peak = max<uint32_t>(result.peak, p);
+#endif
+
+    for (; i < count; ++i) {
+        int32_t v = samples[i];
+        auto magnitude = static_cast<uint32_t>(min(abs(v), 32767));
+
+        result.sum += v;
+        result.sumSquares += static_cast<uint64_t>(v * v);
+        result.peak = max(result.peak, magnitude);
+        result.clipped += magnitude >= static_cast<uint32_t>(clipLevel);
+    }
+
+    return result;
+}
+
+double AudioDsp::levelDb(const int16_t* samples, size_t count) {
+    if (count == 0)
+        return -100;
+
+    auto meanSquare = static_cast<double>(sumSquares(samples, count)) / count;
+    if (meanSquare < 1)
+        return -100;
+
+    return 10 * log10(meanSquare / (32768.0 * 32768.0));
+}
+
+void AudioDsp::accumulate(int32_t* bus, const int16_t* samples, size_t count) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+
+        // sign extend by placing each sample in the high half and shifting it down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+        auto* dst = reinterpret_cast<__m128i*>(bus + i);
+        _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), lo));
+        _mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), hi));
+    }
+#endif
+
+    for (; i < count; ++i)
+        bus[i] += samples[i];
+}
+
+uint32_t AudioDsp::peak(const int32_t* bus, size_t count) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < count; ++i)
+        result = max(result, static_cast<uint32_t>(abs(bus[i])));
+    return result;
+}
+
+void AudioDsp::scale(int16_t* out, const int32_t* bus, size_t count, float gain) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (; i + 8 <= count; i += 8) {
+        __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bus + i))), g);
+        __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bus + i + 4))), g);
+
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        auto v = lrintf(static_cast<float>(bus[i]) * gain);
+        out[i] = static_cast<int16_t>(min<long>(32767, max<long>(-32768, v)));
+    }
+}
+
+size_t AudioDsp::decimate(int16_t* out, const int16_t* in, size_t frames, int channels, int factor) {
+    if (factor <= 1) {
+        copy(in, in + frames * channels, out);
+        return frames;
+    }
+
+    size_t outFrames = frames / factor;
+    for (size_t f = 0; f < outFrames; ++f) {
+        const int16_t* run = in + f * factor * channels;
+        for (int c = 0; c < channels; ++c) {
+            int32_t sum = 0;
+            for (int k = 0; k < factor; ++k)
+                sum += run[k * channels + c];
+            out[f * channels + c] = static_cast<int16_t>(sum / factor);
+        }
+    }
+
+    return outFrames;
+}
+
+void AudioDsp::mulaw(uint8_t* out, const int16_t* in, size_t count) {
+    constexpr int32_t bias = 0x84;
+    constexpr int32_t clip = 32635;
+
+    for (size_t i = 0; i < count; ++i) {
+        int32_t sample = in[i];
+        uint8_t sign = sample < 0 ? 0x80 : 0;
+        int32_t magnitude = min(sample < 0 ? -sample : sample, clip) + bias;
+
+        // segment is the position of the highest set bit above the bias's
+        int exponent = 31 - __builtin_clz(static_cast<uint32_t>(magnitude)) - 7;
+        int mantissa = (magnitude >> (exponent + 3)) & 0x0f;
+        out[i] = static_cast<uint8_t>(~(sign | (exponent << 4) | mantissa));
+    }
+}
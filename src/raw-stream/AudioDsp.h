@@ -0,0 +1,66 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_AUDIODSP_H
+#define MEETING_SDK_LINUX_SAMPLE_AUDIODSP_H
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Vectorized helpers for 16-bit PCM
+ */
+namespace AudioDsp {
+    struct Stats {
+        int64_t sum;
+        uint64_t sumSquares;
+        uint32_t peak;
+        uint32_t clipped;
+    };
+
+    /**
+     * Sum, energy, peak and clipped sample count of a frame in one pass
+     * @param clipLevel magnitude at or above which a sample counts as clipped
+     */
+    Stats stats(const int16_t* samples, size_t count, int16_t clipLevel);
+
+    /**
+     * Sum of squared samples, accumulated in 64 bits so it cannot overflow
+     */
+    uint64_t sumSquares(const int16_t* samples, size_t count);
+
+    /**
+     * Level of a frame relative to full scale
+     * @return dBFS, -100 for silence
+     */
+    double levelDb(const int16_t* samples, size_t count);
+
+    /**
+     * Add samples into a 32-bit mix bus, which cannot clip however many are added
+     */
+    void accumulate(int32_t* bus, const int16_t* samples, size_t count);
+
+    /**
+     * Largest absolute value on a mix bus
+     */
+    uint32_t peak(const int32_t* bus, size_t count);
+
+    /**
+     * Apply a gain to a mix bus and pack it to 16 bits, saturating anything still out of range
+     */
+    void scale(int16_t* out, const int32_t* bus, size_t count, float gain);
+
+    /**
+     * Lower the sample rate by a whole factor, averaging each run of samples per channel
+     * so that little above the new Nyquist frequency folds back
+     * @param frames input frames; a trailing partial run is dropped
+     * @return output frames written, frames / factor
+     */
+    size_t decimate(int16_t* out, const int16_t* in, size_t frames, int channels, int factor);
+
+    /**
+     * G.711 mu-law, one byte per sample
+     */
+    void mulaw(uint8_t* out, const int16_t* in, size_t count);
+}
+
+#endif //MEETING_SDK_LINUX_SAMPLE_AUDIODSP_H
@@ -0,0 +1,118 @@
+#include "AudioMixer.h"
+
+#include <algorithm>
+
+#include "AudioDsp.h"
+#include "../util/Metrics.h"
+
+AudioMixer::AudioMixer() : AudioMixer(Options()) {}
+
+AudioMixer::AudioMixer(const Options& options) : m_options(options) {}
+
+void AudioMixer::setOutput(const Output& output) {
+    m_output = output;
+}
+
+uint64_t AudioMixer::positionAt(uint64_t ns) const {
+    if (ns <= m_epochNs)
+        return 0;
+
+    auto perSecond = static_cast<uint64_t>(m_sampleRate) * m_channels;
+    auto elapsed = ns - m_epochNs;
+    return elapsed / 1000000000 * perSecond + elapsed % 1000000000 * perSecond / 1000000000;
+}
+
+void AudioMixer::push(uint32_t nodeId, const int16_t* samples, size_t count, int sampleRate, int channels, uint64_t captureNs) {
+    static auto& late = MetricsRegistry::getInstance().counter("zoomsdk_mixer_late_samples_total", "Participant samples that arrived after their block was mixed");
+
+    if (count == 0 || sampleRate <= 0 || channels <= 0)
+        return;
+
+    if (!m_epochNs) {
+        m_epochNs = captureNs;
+        m_sampleRate = sampleRate;
+        m_channels = channels;
+
+        // two seconds of headroom, far more than the jitter allowance
+        m_bus.assign(static_cast<size_t>(sampleRate) * channels * 2, 0);
+    }
+
+    auto arrival = positionAt(captureNs);
+    auto tolerance = positionAt(m_epochNs + m_options.toleranceNs);
+
+    // keep a node's frames back to back unless it paused or drifted
+    auto start = arrival;
+    auto cursor = m_cursors.find(nodeId);
+    if (cursor != m_cursors.end()) {
+        auto distance = cursor->second > arrival ? cursor->second - arrival : arrival - cursor->second;
+        if (distance <= tolerance)
+            start = cursor->second;
+    }
+    m_cursors[nodeId] = start + count;
+
+    if (start < m_readPos) {
+        auto skip = min<uint64_t>(m_readPos - start, count);
+        late.inc(skip);
+        samples += skip;
+        count -= skip;
+        start += skip;
+    }
+
+    if (count == 0)
+        return;
+
+    // never let the writer lap the reader
+    if (start + count > m_readPos + m_bus.size())
+        emit(start + count - m_bus.size());
+
+    while (count) {
+        auto pos = static_cast<size_t>(start % m_bus.size());
+        auto span = min(count, m_bus.size() - pos);
+
+        AudioDsp::accumulate(m_bus.data() + pos, samples, span);
+
+        samples += span;
+        count -= span;
+        start += span;
+    }
+
+    advance(captureNs);
+}
+
+void AudioMixer::advance(uint64_t nowNs) {
+    if (!m_epochNs || nowNs < m_epochNs + m_options.latencyNs)
+        return;
+
+    emit(positionAt(nowNs - m_options.latencyNs));
+}
+
+void AudioMixer::emit(uint64_t until) {
+    static auto& limited = MetricsRegistry::getInstance().counter("zoomsdk_mixer_limited_blocks_total", "Mixed blocks turned down by the limiter");
+
+    auto perSecond = static_cast<uint64_t>(m_sampleRate) * m_channels;
+    auto maxBlock = static_cast<size_t>(perSecond / 50);
+    auto ceiling = m_options.ceiling * 32767.0f;
+
+    while (m_readPos < until) {
+        auto pos = static_cast<size_t>(m_readPos % m_bus.size());
+        auto count = static_cast<size_t>(min<uint64_t>({until - m_readPos, m_bus.size() - pos, maxBlock}));
+        auto* block = m_bus.data() + pos;
+
+        // turn down at once when a block would exceed the ceiling, recover gradually
+        auto peak = static_cast<float>(AudioDsp::peak(block, count));
+        m_gain += (1.0f - m_gain) * m_options.release;
+        if (peak * m_gain > ceiling) {
+            m_gain = ceiling / peak;
+            limited.inc();
+        }
+
+        m_out.resize(count);
+        AudioDsp::scale(m_out.data(), block, count, m_gain);
+        fill(block, block + count, 0);
+
+        if (m_output)
+            m_output(m_out.data(), count, m_epochNs + m_readPos / perSecond * 1000000000 + m_readPos % perSecond * 1000000000 / perSecond);
+
+        m_readPos += count;
+    }
+}
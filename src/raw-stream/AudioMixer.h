@@ -0,0 +1,80 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_AUDIOMIXER_H
+#define MEETING_SDK_LINUX_SAMPLE_AUDIOMIXER_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Mixes separate participant streams into one stream by arrival time.
+ *
+ * Each frame is placed on a shared sample timeline: right after the same
+ * node's previous frame when it arrives on schedule, or at its arrival time
+ * after a pause. Frames are summed on a 32-bit bus. A block is released
+ * once the jitter allowance has passed. A limiter that reacts instantly and
+ * recovers slowly brings the block below full scale, and the result is
+ * packed back to 16 bits with saturation.
+ */
+class AudioMixer {
+public:
+    struct Options {
+        // how long to wait for late frames before a block is mixed
+        uint64_t latencyNs = 60000000;
+        // how far a frame may drift from its node's cursor and still be placed contiguously
+        uint64_t toleranceNs = 30000000;
+        // limiter ceiling as a fraction of full scale
+        float ceiling = 0.9f;
+        // fraction of the way back to unity gain recovered per block
+        float release = 0.05f;
+    };
+
+    /**
+     * @param samples mixed samples
+     * @param count number of samples
+     * @param captureNs capture time of the first sample
+     */
+    using Output = function<void(const int16_t* samples, size_t count, uint64_t captureNs)>;
+
+private:
+    Options m_options;
+    Output m_output;
+
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    uint64_t m_epochNs = 0;
+
+    // ring of 32-bit sums indexed by absolute sample position
+    vector<int32_t> m_bus;
+    uint64_t m_readPos = 0;
+
+    unordered_map<uint32_t, uint64_t> m_cursors;
+    vector<int16_t> m_out;
+    float m_gain = 1;
+
+    uint64_t positionAt(uint64_t ns) const;
+    void emit(uint64_t until);
+
+public:
+    AudioMixer();
+    explicit AudioMixer(const Options& options);
+
+    void setOutput(const Output& output);
+
+    int sampleRate() const { return m_sampleRate; }
+    int channels() const { return m_channels; }
+
+    /**
+     * Add one node's frame
+     */
+    void push(uint32_t nodeId, const int16_t* samples, size_t count, int sampleRate, int channels, uint64_t captureNs);
+
+    /**
+     * Release every block whose jitter allowance has passed
+     */
+    void advance(uint64_t nowNs);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_AUDIOMIXER_H
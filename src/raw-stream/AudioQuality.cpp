@@ -0,0 +1,258 @@
+#include "AudioQuality.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+#include "AudioDsp.h"
+#include "../util/Log.h"
+
+namespace {
+    uint64_t toNs(chrono::milliseconds ms) {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(ms).count());
+    }
+
+    double toDb(double magnitude) {
+        return magnitude < 1 ? -100 : 20 * log10(magnitude / 32768.0);
+    }
+}
+
+AudioQuality::AudioQuality() : AudioQuality(Options()) {}
+
+AudioQuality::AudioQuality(const Options& options) : m_options(options), m_history(max<size_t>(options.history, 1)) {}
+
+uint8_t AudioQuality::levelIssues(const Bucket& b) const {
+    if (!b.samples)
+        return 0;
+
+    uint8_t issues = 0;
+    if (static_cast<double>(b.clipped) / b.samples > m_options.clipRatio)
+        issues |= TranscriptLog::CLIPPING;
+    if (fabs(static_cast<double>(b.sum) / b.samples) > m_options.dcLimit * 32768)
+        issues |= TranscriptLog::DC_OFFSET;
+
+    return issues;
+}
+
+void AudioQuality::close() {
+    auto& b = m_current;
+    b.issues |= levelIssues(b);
+
+    if (b.samples) {
+        double mean = static_cast<double>(b.sum) / b.samples;
+        double clipRatio = static_cast<double>(b.clipped) / b.samples;
+
+        m_snapshot.levelDb = toDb(sqrt(static_cast<double>(b.sumSquares) / b.samples));
+        m_snapshot.peakDb = toDb(b.peak);
+        m_snapshot.clipRatio = clipRatio;
+        m_snapshot.dcOffset = mean / 32768;
+    }
+
+    if (m_jitterNs > static_cast<double>(toNs(m_options.jitter)))
+        b.issues |= TranscriptLog::JITTER;
+
+    m_snapshot.jitterSeconds = m_jitterNs / 1e9;
+    m_snapshot.issues = b.issues;
+
+    m_history[m_next] = b;
+    m_next = (m_next + 1) % m_history.size();
+    m_current = Bucket();
+}
+
+AudioQuality::Frame AudioQuality::onFrame(const int16_t* samples, size_t count, int sampleRate, int channels, uint64_t captureNs) {
+    Frame frame{0, 0, 0, false};
+    bool restarted = false;
+
+    if (m_lastNs && captureNs > m_lastNs) {
+        frame.intervalNs = captureNs - m_lastNs;
+
+        auto resume = toNs(m_options.resume);
+        restarted = resume && frame.intervalNs >= resume;
+
+        if (!restarted) {
+            // RFC 3550 style smoothed deviation from the expected cadence
+            double deviation = fabs(static_cast<double>(frame.intervalNs) - static_cast<double>(m_frameNs));
+            m_jitterNs += (deviation - m_jitterNs) / 16;
+
+            if (frame.intervalNs >= toNs(m_options.stall))
+                frame.issues |= TranscriptLog::STALL | TranscriptLog::GAP;
+            else if (frame.intervalNs > m_frameNs + toNs(m_options.gap))
+                frame.issues |= TranscriptLog::GAP;
+        }
+    }
+
+    if (sampleRate > 0 && channels > 0)
+        m_frameNs = static_cast<uint64_t>(count / channels) * 1000000000ull / static_cast<uint64_t>(sampleRate);
+
+    // buckets only span audio that arrived, so a stall or restart starts a new one
+    if (m_current.samples && (captureNs - m_current.startNs >= toNs(m_options.bucket) || restarted ||
+                              frame.issues & TranscriptLog::STALL)) {
+        close();
+        frame.closed = true;
+    }
+
+    // the callback arrives as the frame ends
+    if (!m_current.samples)
+        m_current.startNs = captureNs > m_frameNs ? captureNs - m_frameNs : 0;
+
+    auto stats = AudioDsp::stats(samples, count, m_options.clipLevel);
+    m_current.samples += count;
+    m_current.sum += stats.sum;
+    m_current.sumSquares += stats.sumSquares;
+    m_current.peak = max(m_current.peak, stats.peak);
+    m_current.clipped += stats.clipped;
+    m_current.issues |= frame.issues;
+    m_current.endNs = captureNs;
+    frame.clipped = stats.clipped;
+
+    m_lastNs = captureNs;
+    m_snapshot.lastNs = captureNs;
+    return frame;
+}
+
+uint8_t AudioQuality::issues(uint64_t fromNs, uint64_t toNs) const {
+    uint8_t result = 0;
+
+    auto overlaps = [&](const Bucket& b) {
+        return b.samples && b.startNs <= toNs && b.endNs >= fromNs;
+    };
+
+    for (const auto& b : m_history)
+        if (overlaps(b))
+            result |= b.issues;
+
+    // the open bucket has not been judged on its levels yet
+    if (overlaps(m_current))
+        result |= m_current.issues | levelIssues(m_current);
+
+    return result;
+}
+
+const AudioQuality::Snapshot& AudioQuality::snapshot() const {
+    return m_snapshot;
+}
+
+struct AudioQualityMonitor::Gauges {
+    atomic<double> levelDb{-100};
+    atomic<double> peakDb{-100};
+    atomic<double> clipRatio{0};
+    atomic<double> dcOffset{0};
+    atomic<double> jitterSeconds{0};
+    atomic<uint64_t> lastNs{0};
+};
+
+AudioQualityMonitor::Gauges& AudioQualityMonitor::gauges(const string& labels) {
+    static auto* lock = new mutex();
+    static auto* byLabels = new map<string, Gauges*>();
+
+    lock_guard<mutex> guard(*lock);
+    auto& g = (*byLabels)[labels];
+    if (g)
+        return *g;
+
+    g = new Gauges();
+    auto* m = g;
+    auto& registry = MetricsRegistry::getInstance();
+
+    registry.gauge("zoomsdk_audio_level_dbfs", "RMS level of the loudest stream over the last bucket",
+                   [m]() { return m->levelDb.load(memory_order_relaxed); }, labels);
+    registry.gauge("zoomsdk_audio_peak_dbfs", "Highest peak of any stream over the last bucket",
+                   [m]() { return m->peakDb.load(memory_order_relaxed); }, labels);
+    registry.gauge("zoomsdk_audio_clip_ratio", "Highest share of clipped samples of any stream over the last bucket",
+                   [m]() { return m->clipRatio.load(memory_order_relaxed); }, labels);
+    registry.gauge("zoomsdk_audio_dc_offset", "Largest mean of any stream as a fraction of full scale",
+                   [m]() { return m->dcOffset.load(memory_order_relaxed); }, labels);
+    registry.gauge("zoomsdk_audio_jitter_seconds", "Largest smoothed callback jitter of any stream",
+                   [m]() { return m->jitterSeconds.load(memory_order_relaxed); }, labels);
+    registry.gauge("zoomsdk_audio_callback_age_seconds", "Time since the most recent raw audio callback of any stream",
+                   [m]() {
+                       auto last = m->lastNs.load(memory_order_relaxed);
+                       return last ? (Metrics::now() - last) / 1e9 : 0.0;
+                   }, labels);
+
+    return *g;
+}
+
+AudioQualityMonitor::AudioQualityMonitor(const string& stream, const AudioQuality::Options& options)
+    : m_options(options),
+      m_labels("stream=\"" + stream + "\""),
+      m_interval(MetricsRegistry::getInstance().histogram("zoomsdk_audio_interframe_seconds", "Time between raw audio callbacks of a stream", m_labels)),
+      m_gaps(MetricsRegistry::getInstance().counter("zoomsdk_audio_gaps_total", "Raw audio callbacks that arrived late enough to leave a gap", m_labels)),
+      m_stalls(MetricsRegistry::getInstance().counter("zoomsdk_audio_stalls_total", "Raw audio streams that stopped and then resumed", m_labels)),
+      m_clipped(MetricsRegistry::getInstance().counter("zoomsdk_audio_clipped_samples_total", "Raw audio samples at or near full scale", m_labels)),
+      m_gauges(gauges(m_labels))
+{
+}
+
+double AudioQualityMonitor::worst(double (*pick)(const AudioQuality::Snapshot&)) const {
+    bool any = false;
+    double result = 0;
+    for (const auto& stream : m_streams) {
+        double v = pick(stream.second->snapshot());
+        if (!any || v > result)
+            result = v;
+        any = true;
+    }
+
+    return result;
+}
+
+void AudioQualityMonitor::onFrame(uint32_t node, const char* data, size_t len, int sampleRate, int channels, uint64_t captureNs) {
+    static LogRateLimit stallLimit(chrono::seconds(10));
+
+    AudioQuality::Frame frame;
+    {
+        lock_guard<mutex> lock(m_lock);
+
+        auto& stream = m_streams[node];
+        if (!stream)
+            stream = make_unique<AudioQuality>(m_options);
+
+        frame = stream->onFrame(reinterpret_cast<const int16_t*>(data), len / sizeof(int16_t), sampleRate, channels, captureNs);
+
+        // the worst stream only changes when one of them closes a bucket
+        if (frame.closed) {
+            m_gauges.levelDb.store(worst([](const AudioQuality::Snapshot& s) { return s.levelDb; }), memory_order_relaxed);
+            m_gauges.peakDb.store(worst([](const AudioQuality::Snapshot& s) { return s.peakDb; }), memory_order_relaxed);
+            m_gauges.clipRatio.store(worst([](const AudioQuality::Snapshot& s) { return s.clipRatio; }), memory_order_relaxed);
+            m_gauges.dcOffset.store(worst([](const AudioQuality::Snapshot& s) { return fabs(s.dcOffset); }), memory_order_relaxed);
+            m_gauges.jitterSeconds.store(worst([](const AudioQuality::Snapshot& s) { return s.jitterSeconds; }), memory_order_relaxed);
+        }
+    }
+
+    if (captureNs > m_gauges.lastNs.load(memory_order_relaxed))
+        m_gauges.lastNs.store(captureNs, memory_order_relaxed);
+
+    if (frame.intervalNs)
+        m_interval.record(frame.intervalNs);
+
+    if (frame.clipped)
+        m_clipped.inc(frame.clipped);
+
+    if (frame.issues & TranscriptLog::GAP)
+        m_gaps.inc();
+
+    if (frame.issues & TranscriptLog::STALL) {
+        m_stalls.inc();
+
+        stringstream ss;
+        ss << "audio from node " << node << " stalled for " << frame.intervalNs / 1000000 << "ms";
+        Log::throttled(stallLimit, Log::WARN, ss.str());
+    }
+}
+
+uint8_t AudioQualityMonitor::issues(uint32_t node, uint64_t fromNs, uint64_t toNs) const {
+    lock_guard<mutex> lock(m_lock);
+
+    auto it = m_streams.find(node);
+    if (it != m_streams.end())
+        return it->second->issues(fromNs, toNs);
+
+    uint8_t result = 0;
+    if (node == 0)
+        for (const auto& stream : m_streams)
+            result |= stream.second->issues(fromNs, toNs);
+
+    return result;
+}
@@ -0,0 +1,157 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_AUDIOQUALITY_H
+#define MEETING_SDK_LINUX_SAMPLE_AUDIOQUALITY_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../transcript/TranscriptLog.h"
+#include "../util/Metrics.h"
+
+using namespace std;
+
+/**
+ * Rolling quality of one audio stream.
+ *
+ * Each frame is reduced to its sum, energy, peak and clipped sample count in
+ * one SIMD pass, and its arrival is compared with the previous callback for
+ * jitter, gaps and stalls. Frames are folded into short buckets; a closed
+ * bucket is marked with the issues it showed and kept for a while so that a
+ * transcript segment can be looked up by the capture times of its audio.
+ */
+class AudioQuality {
+public:
+    struct Options {
+        chrono::milliseconds bucket{250};
+        // buckets kept for lookups, a minute at the default bucket length
+        size_t history = 240;
+        int16_t clipLevel = 32000;
+        // share of clipped samples that marks a bucket
+        double clipRatio = 0.001;
+        // mean as a fraction of full scale that marks a bucket
+        double dcLimit = 0.02;
+        // a callback this much later than the previous frame's length is a gap
+        chrono::milliseconds gap{30};
+        chrono::milliseconds stall{500};
+        // smoothed inter-arrival jitter that marks a bucket
+        chrono::milliseconds jitter{15};
+        // silence after which the stream is treated as restarted rather than
+        // stalled, for one-way streams that stop while a participant is muted
+        chrono::milliseconds resume{0};
+    };
+
+    struct Snapshot {
+        double levelDb = -100;
+        double peakDb = -100;
+        double clipRatio = 0;
+        double dcOffset = 0;
+        double jitterSeconds = 0;
+        uint64_t lastNs = 0;
+        uint8_t issues = 0;
+    };
+
+private:
+    struct Bucket {
+        uint64_t startNs = 0;
+        uint64_t endNs = 0;
+        uint64_t samples = 0;
+        int64_t sum = 0;
+        uint64_t sumSquares = 0;
+        uint32_t peak = 0;
+        uint64_t clipped = 0;
+        uint8_t issues = 0;
+    };
+
+    Options m_options;
+    Bucket m_current;
+    vector<Bucket> m_history;
+    size_t m_next = 0;
+
+    uint64_t m_lastNs = 0;
+    uint64_t m_frameNs = 0;
+    double m_jitterNs = 0;
+    Snapshot m_snapshot;
+
+    uint8_t levelIssues(const Bucket& b) const;
+    void close();
+
+public:
+    /**
+     * What one frame said about the stream
+     */
+    struct Frame {
+        // time since the previous callback, 0 for the first
+        uint64_t intervalNs;
+        uint32_t clipped;
+        uint8_t issues;
+        // a bucket was closed, so snapshot() changed
+        bool closed;
+    };
+
+    AudioQuality();
+    explicit AudioQuality(const Options& options);
+
+    Frame onFrame(const int16_t* samples, size_t count, int sampleRate, int channels, uint64_t captureNs);
+
+    /**
+     * Issues seen in the audio captured between two times, as TranscriptLog::AudioIssue flags
+     */
+    uint8_t issues(uint64_t fromNs, uint64_t toNs) const;
+
+    /**
+     * Statistics of the last complete bucket
+     */
+    const Snapshot& snapshot() const;
+};
+
+/**
+ * Keeps an AudioQuality per node of one kind of stream and exports the worst
+ * of them as metrics labelled with the stream
+ */
+class AudioQualityMonitor {
+
+    AudioQuality::Options m_options;
+    string m_labels;
+
+    mutable mutex m_lock;
+    unordered_map<uint32_t, unique_ptr<AudioQuality>> m_streams;
+
+    Histogram& m_interval;
+    Counter& m_gaps;
+    Counter& m_stalls;
+    Counter& m_clipped;
+
+    struct Gauges;
+    Gauges& m_gauges;
+
+    /**
+     * Shared by every monitor with the same labels and never destroyed, so
+     * the sampled gauges never read a monitor that is gone
+     */
+    static Gauges& gauges(const string& labels);
+
+    /**
+     * Largest value of any stream, with m_lock held
+     */
+    double worst(double (*pick)(const AudioQuality::Snapshot&)) const;
+
+public:
+    /**
+     * @param stream label value, e.g. mixed or one_way
+     */
+    AudioQualityMonitor(const string& stream, const AudioQuality::Options& options);
+
+    void onFrame(uint32_t node, const char* data, size_t len, int sampleRate, int channels, uint64_t captureNs);
+
+    /**
+     * Issues in a node's audio between two capture times. Node 0 without a
+     * stream of its own, i.e. a local mix, takes the issues of every node.
+     */
+    uint8_t issues(uint32_t node, uint64_t fromNs, uint64_t toNs) const;
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_AUDIOQUALITY_H
@@ -0,0 +1,211 @@
+#include "CannedBackend.h"
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+namespace {
+    const char* c_script[] = {
+        "Good morning everyone, thanks for joining.",
+        "Let's start with a quick update on the release.",
+        "The build is green and the last blockers were fixed yesterday.",
+        "We still need sign-off from the security review.",
+        "Can someone take the action item for the customer follow-up?",
+        "Great, let's check in again on Thursday."
+    };
+
+    vector<string> split(const string& line) {
+        vector<string> words;
+        istringstream in(line);
+        for (string word; in >> word;)
+            words.push_back(word);
+        return words;
+    }
+
+    void appendEscaped(string& out, const string& text) {
+        for (char c : text) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char esc[8];
+                        snprintf(esc, sizeof(esc), "\\u%04x", c);
+                        out += esc;
+                    } else {
+                        out.push_back(c);
+                    }
+            }
+        }
+    }
+
+    void appendNumber(string& out, double v) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.3f", v);
+        out += buf;
+    }
+
+    // lower case without punctuation, as Deepgram reports "word" next to "punctuated_word"
+    string bare(const string& word) {
+        string out;
+        for (char c : word)
+            if (isalnum(static_cast<unsigned char>(c)) || c == '\'' || c == '-')
+                out.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+        return out;
+    }
+}
+
+CannedBackend::CannedBackend(const TranscriptionBackend::Options& options) {
+    if (!options.script.empty()) {
+        ifstream file(options.script);
+        if (!file)
+            Log::error("failed to open canned transcript " + options.script);
+
+        for (string line; getline(file, line);) {
+            auto words = split(line);
+            if (!words.empty())
+                m_lines.push_back(std::move(words));
+        }
+    }
+
+    if (m_lines.empty())
+        for (const auto* line : c_script)
+            m_lines.push_back(split(line));
+}
+
+bool CannedBackend::open(int sampleRate, int channels, const string& encoding) {
+    // mu-law packs a sample into a byte
+    size_t bytesPerSample = encoding == "mulaw" ? 1 : sizeof(int16_t);
+    m_bytesPerSecond = static_cast<double>(sampleRate) * channels * bytesPerSample;
+    m_pushed = 0;
+    m_segmentStart = 0;
+    m_nextInterim = static_cast<uint64_t>(m_bytesPerSecond * c_interimSeconds);
+    m_line = 0;
+    m_open = m_bytesPerSecond > 0;
+    return m_open;
+}
+
+bool CannedBackend::push(char* data, size_t len) {
+    (void) data;
+    if (!m_open)
+        return false;
+
+    auto interim = static_cast<uint64_t>(m_bytesPerSecond * c_interimSeconds);
+    auto final = static_cast<uint64_t>(m_bytesPerSecond * c_finalSeconds);
+
+    m_pushed += len;
+    while (m_pushed >= m_nextInterim) {
+        if (m_nextInterim - m_segmentStart >= final) {
+            emit(m_segmentStart, m_nextInterim, true);
+            m_segmentStart = m_nextInterim;
+        } else {
+            emit(m_segmentStart, m_nextInterim, false);
+        }
+        m_nextInterim += interim;
+    }
+
+    return true;
+}
+
+bool CannedBackend::flush() {
+    if (!m_open)
+        return false;
+
+    if (m_pushed > m_segmentStart) {
+        emit(m_segmentStart, m_pushed, true);
+        m_segmentStart = m_pushed;
+        m_nextInterim = m_pushed + static_cast<uint64_t>(m_bytesPerSecond * c_interimSeconds);
+    }
+
+    return true;
+}
+
+bool CannedBackend::keepAlive() {
+    return m_open;
+}
+
+bool CannedBackend::closeStream() {
+    if (!flush())
+        return false;
+
+    m_open = false;
+    return true;
+}
+
+void CannedBackend::close() {
+    m_open = false;
+}
+
+bool CannedBackend::isOpen() const {
+    return m_open;
+}
+
+void CannedBackend::setOnResult(const function<void(DeepgramResults&)>& callback) {
+    m_onResult = callback;
+}
+
+void CannedBackend::emit(uint64_t from, uint64_t to, bool final) {
+    auto& registry = MetricsRegistry::getInstance();
+    static auto& finals = registry.counter("zoomsdk_results_total", "Transcription results received", "type=\"final\"");
+    static auto& interims = registry.counter("zoomsdk_results_total", "Transcription results received", "type=\"interim\"");
+
+    double start = from / m_bytesPerSecond;
+    double duration = (to - from) / m_bytesPerSecond;
+
+    // interims show the words of the utterance spoken so far, finals all of it
+    const auto& line = m_lines[m_line];
+    vector<string> words;
+    for (size_t i = 0; i < line.size(); ++i)
+        if (final || (i + 1) * c_finalSeconds / line.size() <= duration)
+            words.push_back(line[i]);
+
+    render(m_json, words, start, final ? duration : c_finalSeconds * words.size() / line.size(), final);
+
+    DeepgramResults results = DeepgramJsonParser::parse(m_json);
+    (final ? finals : interims).inc();
+
+    if (final)
+        m_line = (m_line + 1) % m_lines.size();
+
+    if (m_onResult)
+        m_onResult(results);
+}
+
+void CannedBackend::render(string& out, const vector<string>& words, double start, double duration, bool final) {
+    out.clear();
+    out += R"({"type":"Results","channel_index":[0,1],"duration":)";
+    appendNumber(out, duration);
+    out += R"(,"start":)";
+    appendNumber(out, start);
+    out += final ? R"(,"is_final":true,"speech_final":true)" : R"(,"is_final":false,"speech_final":false)";
+    out += R"(,"channel":{"alternatives":[{"transcript":")";
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (i)
+            out.push_back(' ');
+        appendEscaped(out, words[i]);
+    }
+
+    out += R"(","confidence":0.99,"words":[)";
+
+    double step = words.empty() ? 0 : duration / words.size();
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (i)
+            out.push_back(',');
+        out += R"({"word":")";
+        appendEscaped(out, bare(words[i]));
+        out += R"(","start":)";
+        appendNumber(out, start + i * step);
+        out += R"(,"end":)";
+        appendNumber(out, start + (i + 1) * step);
+        out += R"(,"confidence":0.99,"speaker":0,"punctuated_word":")";
+        appendEscaped(out, words[i]);
+        out += R"("})";
+    }
+
+    out += R"(]}],"search":[]},"metadata":{"request_id":"canned","models":["canned"]}})";
+}
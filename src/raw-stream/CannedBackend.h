@@ -0,0 +1,60 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_CANNEDBACKEND_H
+#define MEETING_SDK_LINUX_SAMPLE_CANNEDBACKEND_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TranscriptionBackend.h"
+
+using namespace std;
+
+/**
+ * In-process engine that answers with canned results and no network.
+ *
+ * Results are paced by the audio pushed, not by the clock, so the same
+ * audio always gives the same results: an interim every 500 ms of audio and
+ * a final every 2 s, or on flush(), each playing the next line of the
+ * script with its words spread evenly over the stretch. They are rendered
+ * as Deepgram JSON and parsed like a real message on the pushing thread,
+ * so everything behind the backend can be profiled without network cost.
+ */
+class CannedBackend : public TranscriptionBackend {
+    static constexpr double c_interimSeconds = 0.5;
+    static constexpr double c_finalSeconds = 2.0;
+
+    vector<vector<string>> m_lines;
+    size_t m_line = 0;
+
+    double m_bytesPerSecond = 0;
+    uint64_t m_pushed = 0;
+    uint64_t m_segmentStart = 0;
+    uint64_t m_nextInterim = 0;
+    atomic<bool> m_open{false};
+
+    function<void(DeepgramResults&)> m_onResult;
+    string m_json;
+
+    void emit(uint64_t from, uint64_t to, bool final);
+
+public:
+    explicit CannedBackend(const TranscriptionBackend::Options& options);
+
+    bool open(int sampleRate, int channels, const string& encoding = "linear16") override;
+    bool push(char* data, size_t len) override;
+    bool flush() override;
+    bool keepAlive() override;
+    bool closeStream() override;
+    void close() override;
+    bool isOpen() const override;
+    void setOnResult(const function<void(DeepgramResults&)>& callback) override;
+
+    /**
+     * Render one result in Deepgram's streaming format
+     * @param words the words, spread evenly over [start, start + duration)
+     */
+    static void render(string& out, const vector<string>& words, double start, double duration, bool final);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_CANNEDBACKEND_H
@@ -33,14 +33,11 @@ DeepgramResults DeepgramJsonParser::parse(const std::string& jsonString) {
                 }
             } 
         } catch (Poco::Exception& e) {
-            std::cerr << "Poco Exception while parsing 'models': " << e.displayText() << std::endl;
-            std::cerr << "Error parsing 'models'. JSON: " << jsonString << std::endl;
+            Log::error("Poco Exception while parsing 'models': " + e.displayText() + ". JSON: " + jsonString);
         } catch (std::exception& e) {
-            std::cerr << "Standard Exception while parsing 'models': " << e.what() << std::endl;
-            std::cerr << "Error parsing 'models'. JSON: " << jsonString << std::endl;
+            Log::error("Standard Exception while parsing 'models': " + std::string(e.what()) + ". JSON: " + jsonString);
         } catch (...) {
-            std::cerr << "Unknown error parsing 'models'" << std::endl;
-            std::cerr << "Error parsing 'models'. JSON: " << jsonString << std::endl;
+            Log::error("Unknown error parsing 'models'. JSON: " + jsonString);
         }
 
 
@@ -85,6 +82,8 @@ DeepgramResults DeepgramJsonParser::parse(const std::string& jsonString) {
                     word.start = wordObject->getValue<double>("start");
                     word.end = wordObject->getValue<double>("end");
                     word.confidence = wordObject->getValue<double>("confidence");
+                    word.speaker = wordObject->optValue<int>("speaker", -1);
+                    word.punctuated_word = wordObject->optValue<std::string>("punctuated_word", word.word);
                     alternative.words.push_back(word);
                 }
 
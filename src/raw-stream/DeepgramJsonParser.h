@@ -6,12 +6,15 @@
 #include "Poco/Dynamic/Var.h"
 #include <iostream>
 #include <vector>
+#include "../util/Log.h"
 
 struct Word {
     std::string word;
     double start;
     double end;
     double confidence;
+    int speaker = -1;
+    std::string punctuated_word;
 };
 
 struct Alternative {
@@ -25,6 +28,7 @@ struct Hit {
     double start;
     double end;
     std::string snippet;
+    int speaker = -1;
 };
 
 struct Search {
@@ -56,6 +60,12 @@ struct DeepgramResults {
     bool is_final;
     bool speech_final;
     Channel channel;
+    // participant whose one-way audio produced the result, 0 for the mixed stream
+    uint32_t node = 0;
+    // steady clock capture time of the result's first audio, 0 if unknown
+    uint64_t captureNs = 0;
+    // TranscriptLog::AudioIssue bits seen in the result's audio
+    uint8_t audioIssues = 0;
 };
 
 class DeepgramJsonParser {
@@ -1,22 +1,46 @@
 // DeepgramWSHelper.cpp
 #include "DeepgramWSHelper.h"
 #include "DeepgramJsonParser.h"
-#include <Poco/Net/SocketReactor.h>
-#include <Poco/Net/SocketNotification.h>
-#include <Poco/RunnableAdapter.h>
+#include "../util/IoLoop.h"
+#include "../util/Metrics.h"
+#include "../util/Trace.h"
+#include "TlsSessions.h"
 #include <Poco/Delegate.h>
 #include <Poco/JSON/Parser.h>
 #include <Poco/JSON/Object.h>
-#include <Poco/JSON/Parser.h>
-#include <Poco/JSON/Object.h>
+#include <Poco/Base64Encoder.h>
+#include <Poco/SHA1Engine.h>
+#include <climits>
+#include <random>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+
+namespace {
+    const std::string c_websocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    // Poco has no well-known port for wss
+    uint16_t portOf(const Poco::URI& uri) {
+        return uri.getPort() ? uri.getPort() : 443;
+    }
 
+    std::string base64(const unsigned char* data, size_t length) {
+        std::ostringstream out;
+        Poco::Base64Encoder encoder(out);
+        encoder.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(length));
+        encoder.close();
+        return out.str();
+    }
+}
 
-DeepgramWSHelper::DeepgramWSHelper() : uri(nullptr), m_psock(nullptr), reactor(nullptr) {
+DeepgramWSHelper::DeepgramWSHelper() {
     // Default constructor
 }
 
-DeepgramWSHelper::DeepgramWSHelper(std::string wsEndPoint, const std::map<std::string, std::string>& extraHeaders, const std::string& encoding, int sampleRate, int channels)
-    : uri(nullptr), m_psock(nullptr), reactor(nullptr) {
+DeepgramWSHelper::DeepgramWSHelper(const TranscriptionBackend::Options& options)
+    : m_options(options) {
+}
+
+DeepgramWSHelper::DeepgramWSHelper(std::string wsEndPoint, const std::map<std::string, std::string>& extraHeaders, const std::string& encoding, int sampleRate, int channels) {
     initialize(wsEndPoint, extraHeaders, encoding, sampleRate, channels);
 }
 
@@ -26,22 +50,26 @@ DeepgramWSHelper::~DeepgramWSHelper() {
 
 void DeepgramWSHelper::initialize(std::string wsEndPoint, const std::map<std::string, std::string>& extraHeaders, const std::string& encoding, int sampleRate, int channels) {
     std::stringstream logStream;
-    uri = new Poco::URI(wsEndPoint);
+    m_uri = Poco::URI(wsEndPoint);
 
     // Append query parameters to the WebSocket URL
-    std::string queryString = "encoding=" + encoding + "&sample_rate=" + std::to_string(sampleRate) + "&channels=" + std::to_string(channels) + "&model=nova-2" + "&endpointing=10&smart_format=true&diarize=true&utterances=true";
-    uri->setQuery(queryString);
+    std::string queryString = "encoding=" + encoding + "&sample_rate=" + std::to_string(sampleRate) + "&channels=" + std::to_string(channels);
+    if (!m_options.model.empty())
+        queryString += "&model=" + m_options.model;
+    if (!m_options.params.empty())
+        queryString += "&" + m_options.params;
+    m_uri.setQuery(queryString);
 
     logStream.str("");
     logStream << "WebSocket Query String: " << queryString;
     Log::info(logStream.str());
 
     try {
-        Poco::Net::Context::Ptr context = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", Poco::Net::Context::VERIFY_NONE, 9, true);
-
-        Poco::Net::HTTPSClientSession cs(uri->getHost(), 443, context);
+        // one shared, verifying context; reconnects resume the last session with the host
+        auto socket = TlsSessions::getInstance().connect(m_uri.getHost(), portOf(m_uri));
+        Poco::Net::HTTPSClientSession cs(socket);
 
-        Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri->getPathEtc(), Poco::Net::HTTPMessage::HTTP_1_1);
+        Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, m_uri.getPathEtc(), Poco::Net::HTTPMessage::HTTP_1_1);
 
         // Add extra headers
         for (const auto& header : extraHeaders) {
@@ -49,10 +77,9 @@ void DeepgramWSHelper::initialize(std::string wsEndPoint, const std::map<std::st
         }
 
         Poco::Net::HTTPResponse response;
-        m_psock = new Poco::Net::WebSocket(cs, request, response);
 
         // Check if the socket is open
-        if (m_psock->impl() && m_psock->impl()->initialized()) {
+        if (upgrade(cs, request, response)) {
             // NOP everything is good
         } else {
             logStream.str("");
@@ -75,15 +102,19 @@ void DeepgramWSHelper::initialize(std::string wsEndPoint, const std::map<std::st
             return;
         }
 
-        reactor = new Poco::Net::SocketReactor();
-        using PocoObserver = Poco::Observer<DeepgramWSHelper, Poco::Net::ReadableNotification>;
-        reactor->addEventHandler(*m_psock, PocoObserver(*this, &DeepgramWSHelper::onSocketReadable));
+        m_socket.setBlocking(false);
+        m_socket.setReceiveTimeout(Poco::Timespan(10, 0));
+        m_socket.setSendTimeout(Poco::Timespan(10, 0));
 
-        reactorThread.start(*this);
+        m_writer.clear();
+        m_reader.clear();
+        m_open = true;
 
-        m_psock->setBlocking(false);
-        m_psock->setReceiveTimeout(Poco::Timespan(10, 0));
-        m_psock->setSendTimeout(Poco::Timespan(10, 0));
+        // read whenever Deepgram sends, until either side closes
+        m_readWatch = IoLoop::getInstance().watch(m_socket.impl()->sockfd(), G_IO_IN, [this](GIOCondition condition) {
+            receive_buffer();
+            return m_open && !(condition & G_IO_ERR);
+        });
 
     } catch (const Poco::Exception& ex) {
         std::string msg(ex.what());
@@ -93,94 +124,302 @@ void DeepgramWSHelper::initialize(std::string wsEndPoint, const std::map<std::st
     }
 }
 
-void DeepgramWSHelper::runReactor() {
-    reactor->run();
+bool DeepgramWSHelper::upgrade(Poco::Net::HTTPSClientSession& session, Poco::Net::HTTPRequest& request, Poco::Net::HTTPResponse& response) {
+    std::random_device random;
+    unsigned char nonce[16];
+    for (auto& byte : nonce)
+        byte = static_cast<unsigned char>(random());
+
+    auto key = base64(nonce, sizeof(nonce));
+    request.set("Connection", "Upgrade");
+    request.set("Upgrade", "websocket");
+    request.set("Sec-WebSocket-Version", "13");
+    request.set("Sec-WebSocket-Key", key);
+
+    session.sendRequest(request);
+    session.receiveResponse(response);
+
+    if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_SWITCHING_PROTOCOLS)
+        return false;
+
+    Poco::SHA1Engine sha1;
+    sha1.update(key + c_websocketGuid);
+    const auto& digest = sha1.digest();
+
+    if (response.get("Sec-WebSocket-Accept", "") != base64(digest.data(), digest.size())) {
+        Log::error("WebSocket upgrade returned the wrong Sec-WebSocket-Accept");
+        return false;
+    }
+
+    // from here on frames are written and read directly on the TLS socket
+    m_socket = session.detachSocket();
+    return true;
 }
 
-void DeepgramWSHelper::onSocketReadable(Poco::Net::ReadableNotification* pNf) {
-    receive_buffer();
+size_t DeepgramWSHelper::flushFrames() {
+    auto& registry = MetricsRegistry::getInstance();
+    static auto& writes = registry.counter("zoomsdk_ws_writes_total", "Socket writes carrying queued WebSocket frames");
+    static auto& frames = registry.counter("zoomsdk_ws_frames_total", "WebSocket frames written to the socket");
+
+    auto written = m_writer.flush([this](const uint8_t* data, size_t length) {
+        int n = m_socket.sendBytes(data, static_cast<int>(std::min<size_t>(length, INT_MAX)));
+        if (n > 0)
+            writes.inc();
+        return n;
+    });
+
+    frames.inc(written);
+    return written;
 }
 
-void DeepgramWSHelper::send_buffer(char* buffer, unsigned int bufferLen) {
-    try {
-        bool isSocketReady = m_psock->poll(Poco::Timespan(2, 0), Poco::Net::WebSocket::SELECT_WRITE);
+void DeepgramWSHelper::awaitWritable() {
+    if (!m_open || !m_writer.pendingBytes() || m_writing.exchange(true))
+        return;
 
-        if (isSocketReady) {
-            // Send the raw buffer data to the socket
-            m_psock->sendFrame(buffer, bufferLen, Poco::Net::WebSocket::FRAME_BINARY);
+    m_writeWatch = IoLoop::getInstance().watch(m_socket.impl()->sockfd(), G_IO_OUT, [this](GIOCondition condition) {
+        try {
+            flushFrames();
+        } catch (const Poco::Exception& ex) {
+            Log::error("WebSocket send failed: " + std::string(ex.displayText()));
+            condition = static_cast<GIOCondition>(condition | G_IO_ERR);
         }
 
-        reactor->wakeUp();
-    } catch (const Poco::Net::WebSocketException& ex) {
+        if (m_open && m_writer.pendingBytes() && !(condition & G_IO_ERR))
+            return true;
+
+        // a sender that queued after the check above saw m_writing set and left the frames to this watch
+        m_writing = false;
+        return m_open && m_writer.pendingBytes() && !(condition & G_IO_ERR) && !m_writing.exchange(true);
+    });
+}
+
+bool DeepgramWSHelper::send_buffer(char* buffer, unsigned int bufferLen) {
+    auto& registry = MetricsRegistry::getInstance();
+    static auto& sendTime = registry.histogram("zoomsdk_ws_send_seconds", "Time to poll and send one audio frame");
+    static auto& sentBytes = registry.counter("zoomsdk_ws_sent_bytes_total", "Audio bytes sent to Deepgram");
+    static auto& skipped = registry.counter("zoomsdk_ws_send_skipped_total", "Audio frames dropped because too much was already waiting for the socket");
+    static auto& errors = registry.counter("zoomsdk_ws_send_errors_total", "WebSocket send failures");
+
+    ScopedTimer timer(sendTime);
+    Trace::Span span("send", "websocket");
+
+    if (!m_open)
+        return false;
+
+    // frames wait in the writer while the socket is busy and leave together once it drains
+    if (!m_writer.queue(WebSocketFrame::BINARY, buffer, bufferLen)) {
+        skipped.inc();
+        return false;
+    }
+    sentBytes.inc(bufferLen);
+
+    try {
+        if (m_socket.poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_WRITE))
+            flushFrames();
+
+        awaitWritable();
+    } catch (const Poco::Exception& ex) {
         // Indulging in the philosophical contemplation of potential exceptions
-        std::string msg(ex.what());
+        errors.inc();
         std::stringstream logStream;
-        logStream << "WebSocketException Exception: " << msg;
+        logStream << "WebSocket send failed: " << ex.displayText();
         Log::error(logStream.str());
     }
+
+    return true;
 }
 
-void DeepgramWSHelper::receive_buffer() {
+bool DeepgramWSHelper::send_control(const std::string& message) {
+    if (!m_open || !m_writer.queue(WebSocketFrame::TEXT, message.data(), message.size()))
+        return false;
+
+    // never wait for the socket here, callers include the IoLoop thread; the write watch finishes what is left
     try {
-        std::vector<char> readBuffer(2048);
-        std::vector<char> accumulatedData;
-        int bytesRead = 0;  // Declare bytesRead before the do-while loop
+        if (m_socket.poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_WRITE))
+            flushFrames();
+        awaitWritable();
+        return true;
+    } catch (const Poco::Exception& ex) {
+        Log::error("failed to send control message: " + std::string(ex.displayText()));
+        return false;
+    }
+}
 
-        do {
-            // Resize buffer as needed
-            readBuffer.resize(2048);
+void DeepgramWSHelper::receive_buffer() {
+    auto& registry = MetricsRegistry::getInstance();
+    static auto& receiveTime = registry.histogram("zoomsdk_ws_receive_seconds", "Time to read, parse and dispatch one message");
 
-            // Read data into the resized vector
-            bytesRead = m_psock->receiveBytes(readBuffer.data(), readBuffer.size());
+    ScopedTimer timer(receiveTime);
+    Trace::Span span("receive", "websocket");
 
-            if (bytesRead > 0) {
-                // Append the received data to the accumulated data
-                accumulatedData.insert(accumulatedData.end(), readBuffer.begin(), readBuffer.begin() + bytesRead);
+    try {
+        char readBuffer[16384];
+        int bytesRead = 0;
 
+        do {
+            bytesRead = m_socket.receiveBytes(readBuffer, sizeof(readBuffer));
+
+            if (bytesRead > 0 && !m_reader.feed(readBuffer, static_cast<size_t>(bytesRead),
+                                                [this](WebSocketFrame::Opcode opcode, const char* data, size_t length) {
+                                                    onMessage(opcode, data, length);
+                                                })) {
+                Log::error("WebSocket stream from Deepgram is not valid framing, closing");
+                m_open = false;
+                return;
             }
-        } while (bytesRead > 0 && bytesRead == readBuffer.size());
-
-        if (!accumulatedData.empty()) {
-            // Log the raw JSON data received
-            std::string receivedData(accumulatedData.begin(), accumulatedData.end());
-
-            try {
-                // Attempt to parse the received data as JSON
-                DeepgramResults result = DeepgramJsonParser::parse(receivedData);
-
-                // Check if the parsed JSON contains alternatives and transcript
-                if (!result.channel.alternatives.empty() && !result.channel.alternatives[0].transcript.empty()) {
-                    // Extract and print the transcript
-                    std::string transcript = result.channel.alternatives[0].transcript;
-                    Log::info("Transcript from JSON: " + transcript);
-                }
-            } catch (const Poco::JSON::JSONException& jsonEx) {
-                // Log the JSON parsing exception
-                Log::error("JSON Parsing Exception: " + jsonEx.message());
-            }
-        } else {
-            Log::info("WebSocket connection got nothing back");
+        } while (bytesRead == static_cast<int>(sizeof(readBuffer)));
+
+        if (bytesRead == 0 && m_open) {
+            Log::warn("Deepgram closed the WebSocket connection");
+            m_open = false;
         }
-    } catch (const Poco::Net::WebSocketException& ex) {
-        std::string errorMsg = "WebSocketException caught: " + std::string(ex.displayText());
-        Log::error(errorMsg);
     } catch (const Poco::Exception& ex) {
         std::string errorMsg = "Exception: " + std::string(ex.displayText());
         Log::error(errorMsg);
     }
 }
 
+void DeepgramWSHelper::onMessage(WebSocketFrame::Opcode opcode, const char* data, size_t length) {
+    switch (opcode) {
+        case WebSocketFrame::TEXT:
+        case WebSocketFrame::BINARY:
+            handleResult(std::string(data, length));
+            break;
+
+        case WebSocketFrame::PING:
+            m_writer.queue(WebSocketFrame::PONG, data, length);
+            flushFrames();
+            break;
+
+        case WebSocketFrame::CLOSE: {
+            int code = length >= 2 ? (static_cast<unsigned char>(data[0]) << 8) | static_cast<unsigned char>(data[1]) : 1005;
+            std::stringstream logStream;
+            logStream << "Deepgram closed the WebSocket with code " << code;
+            if (length > 2)
+                logStream << ": " << std::string(data + 2, length - 2);
+            Log::info(logStream.str());
+
+            // echo the close and stop sending
+            if (m_open.exchange(false)) {
+                m_writer.clear();
+                m_writer.queue(WebSocketFrame::CLOSE, data, std::min<size_t>(length, 2));
+                flushFrames();
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void DeepgramWSHelper::handleResult(const std::string& receivedData) {
+    auto& registry = MetricsRegistry::getInstance();
+    static auto& messages = registry.counter("zoomsdk_ws_received_messages_total", "Messages received from Deepgram");
+    static auto& receivedBytes = registry.counter("zoomsdk_ws_received_bytes_total", "Bytes received from Deepgram");
+    static auto& parseTime = registry.histogram("zoomsdk_parse_seconds", "Time to parse one Deepgram message");
+    static auto& finals = registry.counter("zoomsdk_results_total", "Transcription results received", "type=\"final\"");
+    static auto& interims = registry.counter("zoomsdk_results_total", "Transcription results received", "type=\"interim\"");
+
+    messages.inc();
+    receivedBytes.inc(receivedData.size());
+
+    try {
+        // Attempt to parse the received data as JSON
+        auto parseStart = Metrics::now();
+        DeepgramResults result = DeepgramJsonParser::parse(receivedData);
+        auto parseEnd = Metrics::now();
+        parseTime.record(parseEnd - parseStart);
+        Trace::record("parse", "websocket", parseStart, parseEnd - parseStart);
+        (result.is_final ? finals : interims).inc();
+
+        // Check if the parsed JSON contains alternatives and transcript
+        if (!result.channel.alternatives.empty() && !result.channel.alternatives[0].transcript.empty()) {
+            // Extract and print the transcript
+            std::string transcript = result.channel.alternatives[0].transcript;
+            Log::write(result.is_final ? Log::INFO : Log::DEBUG, "Transcript from JSON: " + transcript);
+        }
+
+        if (m_onResult)
+            m_onResult(result);
+    } catch (const Poco::JSON::JSONException& jsonEx) {
+        // Log the JSON parsing exception
+        Log::error("JSON Parsing Exception: " + jsonEx.message());
+    }
+}
+
 
-void DeepgramWSHelper::run() {
-    runReactor();
+void DeepgramWSHelper::setOnResult(const std::function<void(DeepgramResults&)>& callback) {
+    m_onResult = callback;
+}
+
+bool DeepgramWSHelper::open(int sampleRate, int channels, const std::string& encoding) {
+    initialize(m_options.url, m_options.headers, encoding, sampleRate, channels);
+    return isOpen();
+}
+
+bool DeepgramWSHelper::push(char* data, size_t len) {
+    return send_buffer(data, static_cast<unsigned int>(std::min<size_t>(len, UINT_MAX)));
+}
+
+bool DeepgramWSHelper::flush() {
+    return send_control(R"({"type":"Finalize"})");
+}
+
+bool DeepgramWSHelper::keepAlive() {
+    return send_control(R"({"type":"KeepAlive"})");
+}
+
+bool DeepgramWSHelper::closeStream() {
+    return send_control(R"({"type":"CloseStream"})");
+}
+
+TranscriptionBackend::Backlog DeepgramWSHelper::backlog() {
+    Backlog backlog;
+    if (!m_open)
+        return backlog;
+
+    backlog.queued = m_writer.pendingBytes();
+    backlog.queueLimit = m_writer.limit();
+
+    try {
+        int unsent = 0;
+        auto* impl = m_socket.impl();
+        if (impl && ioctl(impl->sockfd(), SIOCOUTQ, &unsent) == 0 && unsent > 0)
+            backlog.unsent = static_cast<size_t>(unsent);
+        // Linux reports twice the size asked for and keeps half for its own bookkeeping
+        backlog.sendBuffer = static_cast<size_t>(std::max(0, m_socket.getSendBufferSize())) / 2;
+    } catch (const Poco::Exception&) {
+        // closed underneath us, the writer queue is all there is
+    }
+
+    return backlog;
+}
+
+bool DeepgramWSHelper::isOpen() const {
+    return m_open && m_readWatch;
 }
 
 void DeepgramWSHelper::close() {
     try {
-        m_psock->shutdown();
+        // a normal closure, then stop writing
+        if (m_open.exchange(false)) {
+            const char normal[2] = {0x03, static_cast<char>(0xe8)};
+            m_writer.queue(WebSocketFrame::CLOSE, normal, sizeof(normal));
+            flushFrames();
+
+            // by now any TLS 1.3 ticket has arrived, so this is the session worth resuming
+            Poco::Net::SecureStreamSocket secure(m_socket);
+            TlsSessions::getInstance().remember(m_uri.getHost(), portOf(m_uri), secure);
+            m_socket.shutdown();
+        }
 
-        // Stop the reactor
-        reactor->stop();
+        // Stop watching, and wait out a handler already running, so the helper can be initialized again
+        auto& loop = IoLoop::getInstance();
+        loop.remove(m_writeWatch.exchange(0));
+        loop.remove(m_readWatch);
+        m_readWatch = 0;
+        m_writing = false;
     } catch (...) {
         std::stringstream logStream;
         logStream << "Closing failed." << std::endl;
@@ -3,47 +3,101 @@
 #define DEEPGRAMWSHELPER_H
 
 #include <Poco/Net/HTTPSClientSession.h>
-#include <Poco/Net/WebSocket.h>
+#include <Poco/Net/StreamSocket.h>
 #include <Poco/Net/HTTPRequest.h>
 #include <Poco/Net/HTTPResponse.h>
-#include <Poco/Net/SocketReactor.h>
-#include <Poco/Net/SocketNotification.h>
 #include <Poco/Net/NetException.h>
 #include <Poco/URI.h>
 #include <Poco/Buffer.h>
 #include <Poco/Logger.h>
+#include <atomic>
 #include <map>
+#include <functional>
 #include <sstream>
 #include "../util/Log.h"
-#include <Poco/Thread.h>
+#include "DeepgramJsonParser.h"
+#include "TranscriptionBackend.h"
+#include "WebSocketFrame.h"
 
-class DeepgramWSHelper : public Poco::Runnable {
+class DeepgramWSHelper : public TranscriptionBackend {
 public:
     DeepgramWSHelper(); 
+    explicit DeepgramWSHelper(const TranscriptionBackend::Options& options);
     DeepgramWSHelper(std::string wsEndPoint, const std::map<std::string, std::string>& extraHeaders, const std::string& encoding, int sampleRate, int channels);
     ~DeepgramWSHelper();
 
     void initialize(std::string wsEndPoint, const std::map<std::string, std::string>& extraHeaders, const std::string& encoding, int sampleRate, int channels);
 
-    void send_buffer(char* buffer, unsigned int bufferLen);
+    bool send_buffer(char* buffer, unsigned int bufferLen);
+
+    /**
+     * Send a control message such as {"type":"KeepAlive"} or {"type":"Finalize"} as a text frame
+     */
+    bool send_control(const std::string& message);
     void receive_buffer();
-    void close();
+    void close() override;
+
+    /**
+     * @return true once the WebSocket is connected and the I/O loop is reading it
+     */
+    bool isOpen() const override;
+
+    void setOnResult(const std::function<void(DeepgramResults&)>& callback) override;
+
+    /**
+     * Connect to the configured endpoint with the configured model and query parameters
+     */
+    bool open(int sampleRate, int channels, const std::string& encoding = "linear16") override;
+    bool push(char* data, size_t len) override;
+
+    /**
+     * Send Finalize
+     */
+    bool flush() override;
+
+    /**
+     * Send KeepAlive
+     */
+    bool keepAlive() override;
 
-    void run() override;
+    /**
+     * Send CloseStream; Deepgram answers with the last results and closes the WebSocket
+     */
+    bool closeStream() override;
+
+    /**
+     * Frames queued in the writer and, from the kernel, bytes the socket has yet to get acknowledged
+     */
+    Backlog backlog() override;
 
 private:
-    Poco::URI* uri;
-    Poco::Net::HTTPSClientSession* cs;
-    Poco::Net::HTTPRequest* request;
-    Poco::Net::HTTPResponse response;
-    Poco::Thread reactorThread;
-    Poco::Net::WebSocket* m_psock;
-    Poco::Net::SocketReactor* reactor;
-
-    void runReactor();
-    void onSocketReadable(Poco::Net::ReadableNotification* pNf);
-
-    std::stringstream logStream;
+    TranscriptionBackend::Options m_options;
+    Poco::URI m_uri;
+    Poco::Net::StreamSocket m_socket;
+    std::atomic<bool> m_open{false};
+
+    // IoLoop watches: reads for as long as the socket is open, writes only while frames are left over
+    unsigned m_readWatch = 0;
+    std::atomic<unsigned> m_writeWatch{0};
+    std::atomic<bool> m_writing{false};
+
+    WebSocketFrameWriter m_writer;
+    WebSocketFrameReader m_reader;
+
+    std::function<void(DeepgramResults&)> m_onResult;
+
+    /**
+     * Finish flushing from the I/O loop once the socket takes more, if frames are left over
+     */
+    void awaitWritable();
+
+    /**
+     * Upgrade the session's connection to a WebSocket and take over its socket
+     */
+    bool upgrade(Poco::Net::HTTPSClientSession& session, Poco::Net::HTTPRequest& request, Poco::Net::HTTPResponse& response);
+    void onMessage(WebSocketFrame::Opcode opcode, const char* data, size_t length);
+    void handleResult(const std::string& message);
+    size_t flushFrames();
 };
 
 #endif // DEEPGRAMWSHELPER_H
@@ -0,0 +1,99 @@
+#include "GapFiller.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "../util/Log.h"
+
+GapFiller::GapFiller() : GapFiller(Options()) {}
+
+GapFiller::GapFiller(const Options& options) : m_options(options) {}
+
+uint64_t GapFiller::samplesIn(uint64_t ns) const {
+    // whole frames across all channels
+    return ns * static_cast<uint64_t>(m_sampleRate) / 1000000000ull * static_cast<uint64_t>(m_channels);
+}
+
+uint64_t GapFiller::durationNs(uint64_t samples) const {
+    if (m_sampleRate <= 0 || m_channels <= 0)
+        return 0;
+
+    return samples / static_cast<uint64_t>(m_channels) * 1000000000ull / static_cast<uint64_t>(m_sampleRate);
+}
+
+void GapFiller::setOptions(const Options& options) {
+    m_options = options;
+}
+
+void GapFiller::setFormat(int sampleRate, int channels) {
+    if (sampleRate == m_sampleRate && channels == m_channels)
+        return;
+
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    reset();
+}
+
+size_t GapFiller::owed(size_t samples, uint64_t captureNs) {
+    if (m_sampleRate <= 0 || m_channels <= 0)
+        return 0;
+
+    // the callback arrives as its frame ends
+    auto frameNs = durationNs(samples);
+    if (!m_originNs) {
+        m_originNs = captureNs > frameNs ? captureNs - frameNs : 1;
+        return 0;
+    }
+
+    auto elapsed = captureNs > m_originNs + frameNs ? captureNs - m_originNs - frameNs : 0;
+    auto expected = samplesIn(elapsed);
+    auto drift = static_cast<int64_t>(m_sent) - static_cast<int64_t>(expected);
+    m_drift.store(drift, memory_order_relaxed);
+
+    auto threshold = samplesIn(static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(m_options.threshold).count()));
+    if (!threshold)
+        return 0;
+
+    // ahead of the clock, e.g. a backlog delivered in a burst: move the anchor
+    // so the next real gap is measured from here
+    if (drift > static_cast<int64_t>(threshold)) {
+        m_originNs -= min(m_originNs - 1, durationNs(static_cast<uint64_t>(drift)));
+        return 0;
+    }
+
+    if (-drift < static_cast<int64_t>(threshold))
+        return 0;
+
+    auto shortfall = static_cast<uint64_t>(-drift);
+    auto limit = samplesIn(static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(m_options.maxFill).count()));
+
+    if (shortfall > limit) {
+        static LogRateLimit logLimit(chrono::seconds(10));
+        stringstream ss;
+        ss << "audio fell " << durationNs(shortfall) / 1000000 << "ms behind capture time, filling "
+           << durationNs(limit) / 1000000 << "ms of silence and realigning";
+        Log::throttled(logLimit, Log::WARN, ss.str());
+
+        m_originNs += durationNs(shortfall - limit);
+        shortfall = limit;
+    }
+
+    return static_cast<size_t>(shortfall - shortfall % static_cast<uint64_t>(m_channels));
+}
+
+void GapFiller::onSent(size_t samples) {
+    m_sent += samples;
+}
+
+double GapFiller::driftSeconds() const {
+    if (m_sampleRate <= 0 || m_channels <= 0)
+        return 0;
+
+    return static_cast<double>(m_drift.load(memory_order_relaxed)) / m_channels / m_sampleRate;
+}
+
+void GapFiller::reset() {
+    m_originNs = 0;
+    m_sent = 0;
+    m_drift.store(0, memory_order_relaxed);
+}
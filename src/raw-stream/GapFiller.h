@@ -0,0 +1,76 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_GAPFILLER_H
+#define MEETING_SDK_LINUX_SAMPLE_GAPFILLER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Keeps the audio stream sent for transcription in step with capture time.
+ *
+ * The first frame anchors the stream to the steady clock. After that each
+ * frame's capture time says how many samples should have gone out before
+ * it; when fewer did, because callbacks were skipped or sends were dropped,
+ * the shortfall is owed as silence so that stream positions in the
+ * transcript keep matching wall-clock meeting time. Shortfalls below the
+ * threshold are callback jitter and are left alone.
+ */
+class GapFiller {
+public:
+    struct Options {
+        // shortfall before silence is inserted, 0 to never insert any
+        chrono::milliseconds threshold{100};
+        // longest silence inserted at once; anything beyond is forgiven
+        chrono::milliseconds maxFill{10000};
+    };
+
+private:
+    Options m_options;
+    int m_sampleRate = 0;
+    int m_channels = 0;
+
+    uint64_t m_originNs = 0;
+    uint64_t m_sent = 0;
+    atomic<int64_t> m_drift{0};
+
+public:
+    GapFiller();
+    explicit GapFiller(const Options& options);
+
+    void setOptions(const Options& options);
+    void setFormat(int sampleRate, int channels);
+
+    /**
+     * Silence owed before a frame
+     * @param samples frame length in samples across all channels
+     * @param captureNs steady clock time of the callback that delivered it
+     * @return samples of silence to send first, a multiple of the channel count
+     */
+    size_t owed(size_t samples, uint64_t captureNs);
+
+    /**
+     * Count samples that actually went out, silence included
+     */
+    void onSent(size_t samples);
+
+    /**
+     * Time sent ahead of (positive) or behind (negative) capture time at the last frame
+     */
+    double driftSeconds() const;
+
+    /**
+     * Length of a run of samples across all channels in ns
+     */
+    uint64_t durationNs(uint64_t samples) const;
+
+    /**
+     * Samples across all channels in whole frames that fit in a span of time
+     */
+    uint64_t samplesIn(uint64_t ns) const;
+
+    void reset();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_GAPFILLER_H
@@ -0,0 +1,341 @@
+#include "HedgedSession.h"
+
+#include <algorithm>
+
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+namespace {
+    struct HedgeMetrics {
+        Counter& duplicates;
+        Counter& trimmed;
+        Counter& leaderChanges;
+        Counter& reconnects;
+        Histogram& lead;
+        Gauge& openLegs;
+        Gauge& leader;
+    };
+
+    HedgeMetrics& hedgeMetrics() {
+        static HedgeMetrics* metrics = [] {
+            auto& registry = MetricsRegistry::getInstance();
+            return new HedgeMetrics{
+                registry.counter("zoomsdk_hedge_duplicates_total", "Final results dropped because another leg already delivered their audio"),
+                registry.counter("zoomsdk_hedge_trimmed_words_total", "Words dropped from final results that partly repeated another leg's"),
+                registry.counter("zoomsdk_hedge_leader_changes_total", "Times interim results moved to another leg"),
+                registry.counter("zoomsdk_hedge_reconnects_total", "Hedged legs reconnected after closing or going quiet"),
+                registry.histogram("zoomsdk_hedge_lead_seconds", "How much earlier the winning leg delivered a final than the duplicate"),
+                registry.gauge("zoomsdk_hedge_open_legs", "Hedged transcription sessions currently open"),
+                registry.gauge("zoomsdk_hedge_leader", "Leg whose interim results are passed on")
+            };
+        }();
+
+        return *metrics;
+    }
+
+    Counter& winsOf(size_t leg) {
+        return MetricsRegistry::getInstance().counter("zoomsdk_hedge_wins_total", "Final results passed on, by the leg that delivered them first",
+                                                      "leg=\"" + to_string(leg) + "\"");
+    }
+
+    uint64_t toNs(chrono::milliseconds ms) {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(ms).count());
+    }
+
+    string join(const vector<Word>& words) {
+        string text;
+        for (const auto& word : words) {
+            if (!text.empty())
+                text.push_back(' ');
+            text += word.punctuated_word.empty() ? word.word : word.punctuated_word;
+        }
+        return text;
+    }
+}
+
+HedgedSession::HedgedSession(const vector<TranscriptionBackend::Options>& legs, const Options& options) : m_options(options) {
+    for (const auto& backend : legs) {
+        auto leg = make_unique<Leg>();
+        leg->index = m_legs.size();
+        leg->backend = TranscriptionBackend::create(backend);
+        if (!leg->backend)
+            continue;
+
+        winsOf(leg->index);
+        m_legs.push_back(std::move(leg));
+    }
+
+    hedgeMetrics().leader.set(0);
+}
+
+HedgedSession::~HedgedSession() {
+    close();
+}
+
+void HedgedSession::setOnResult(const function<void(DeepgramResults&)>& callback) {
+    lock_guard<mutex> lock(m_lock);
+    m_onResult = callback;
+}
+
+void HedgedSession::initialize(int sampleRate, int channels) {
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+
+    auto now = Metrics::now();
+    for (auto& leg : m_legs)
+        connect(*leg, now);
+}
+
+void HedgedSession::connect(Leg& leg, uint64_t now) {
+    if (leg.connecting.load(memory_order_acquire))
+        return;
+
+    if (leg.connector.joinable())
+        leg.connector.join();
+
+    // the audio thread leaves the leg alone until this is cleared
+    leg.connecting.store(true, memory_order_release);
+    leg.retryNs = now + toNs(m_options.retry);
+
+    leg.connector = Thread("hedge-connect", [this, &leg]() {
+        leg.backend->close();
+
+        {
+            // a new connection starts a new stream
+            lock_guard<mutex> lock(m_lock);
+            leg.latency = make_unique<LatencyTracker>();
+            leg.latency->setFormat(m_sampleRate, m_channels);
+        }
+
+        leg.backend->setOnResult([this, &leg](DeepgramResults& results) { onResult(leg, results); });
+        leg.backend->open(m_sampleRate, m_channels);
+
+        leg.openedNs = Metrics::now();
+        leg.lastResultNs = 0;
+        if (!leg.backend->isOpen())
+            Log::warn("hedged transcription session " + to_string(leg.index) + " failed to connect");
+
+        leg.connecting.store(false, memory_order_release);
+    });
+}
+
+bool HedgedSession::usable(Leg& leg, uint64_t now) {
+    if (leg.connecting.load(memory_order_acquire))
+        return false;
+
+    if (leg.backend->isOpen()) {
+        auto silent = toNs(m_options.silent);
+        auto last = max(leg.lastResultNs.load(), leg.openedNs);
+        if (now < last || now - last < silent)
+            return true;
+
+        // quiet on its own is just silence in the meeting; quiet while another leg is not means it stalled
+        bool othersHeard = false;
+        for (auto& other : m_legs) {
+            auto heard = other->lastResultNs.load();
+            othersHeard |= other.get() != &leg && heard && now - heard < silent;
+        }
+
+        if (!othersHeard)
+            return true;
+
+        Log::warn("hedged transcription session " + to_string(leg.index) + " stopped returning results, reconnecting");
+        leg.retryNs = 0;
+    }
+
+    if (now < leg.retryNs)
+        return false;
+
+    hedgeMetrics().reconnects.inc();
+    connect(leg, now);
+    return false;
+}
+
+bool HedgedSession::send(char* data, size_t len, uint64_t captureNs) {
+    if (!m_sampleRate)
+        return false;
+
+    uint64_t unset = 0;
+    m_epochNs.compare_exchange_strong(unset, captureNs);
+
+    bool sent = false;
+    for (auto& leg : m_legs) {
+        if (!usable(*leg, captureNs))
+            continue;
+
+        if (leg->backend->push(data, len)) {
+            leg->latency->onSent(len, captureNs);
+            sent = true;
+        }
+    }
+
+    hedgeMetrics().openLegs.set(static_cast<int64_t>(open()));
+    return sent;
+}
+
+void HedgedSession::onResult(Leg& leg, DeepgramResults& results) {
+    auto now = Metrics::now();
+    auto previousNs = leg.lastResultNs.exchange(now);
+
+    lock_guard<mutex> lock(m_lock);
+
+    if (results.type != "Results") {
+        if (leg.index == m_leader && m_onResult)
+            m_onResult(results);
+        return;
+    }
+
+    // move the result from leg time onto the shared timeline
+    auto epochNs = m_epochNs.load();
+    auto captureNs = leg.latency ? leg.latency->captureTimeAt(results.start) : 0;
+    results.captureNs = captureNs;
+    if (captureNs && captureNs >= epochNs) {
+        double shift = (captureNs - epochNs) / 1e9 - results.start;
+        results.start += shift;
+        for (auto& alternative : results.channel.alternatives) {
+            for (auto& word : alternative.words) {
+                word.start += shift;
+                word.end += shift;
+            }
+        }
+    }
+
+    if (!results.is_final) {
+        follow(leg, false, previousNs);
+        if (leg.index == m_leader && m_onResult)
+            m_onResult(results);
+        return;
+    }
+
+    bool won = dedupe(results, now);
+    follow(leg, won, previousNs);
+    if (!won)
+        return;
+
+    winsOf(leg.index).inc();
+    if (m_onResult)
+        m_onResult(results);
+}
+
+bool HedgedSession::dedupe(DeepgramResults& results, uint64_t now) {
+    auto& metrics = hedgeMetrics();
+
+    auto window = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(m_options.window).count());
+    while (!m_passed.empty() && now - m_passed.front().arrivalNs > window)
+        m_passed.pop_front();
+
+    double start = results.start;
+    double end = results.start + max(0.0, results.duration);
+
+    uint64_t firstNs = 0;
+    auto covered = [&](double t) {
+        for (const auto& range : m_passed) {
+            if (t >= range.start && t < range.end) {
+                firstNs = firstNs ? min(firstNs, range.arrivalNs) : range.arrivalNs;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    bool duplicate;
+    auto* alternative = results.channel.alternatives.empty() ? nullptr : &results.channel.alternatives[0];
+
+    if (alternative && !alternative->words.empty()) {
+        auto& words = alternative->words;
+        auto before = words.size();
+        words.erase(remove_if(words.begin(), words.end(), [&](const Word& word) {
+            return covered((word.start + word.end) / 2);
+        }), words.end());
+
+        duplicate = words.empty();
+        if (!duplicate && words.size() != before) {
+            metrics.trimmed.inc(before - words.size());
+            alternative->transcript = join(words);
+
+            // what is left starts with its first word
+            start = max(start, words.front().start);
+            results.duration = max(0.0, end - start);
+            results.start = start;
+        }
+    } else {
+        // no words to go by, e.g. a final for silence: compare the time it covers
+        double overlap = 0;
+        for (const auto& range : m_passed) {
+            auto shared = min(end, range.end) - max(start, range.start);
+            if (shared > 0) {
+                overlap += shared;
+                firstNs = firstNs ? min(firstNs, range.arrivalNs) : range.arrivalNs;
+            }
+        }
+
+        duplicate = end > start ? overlap >= m_options.overlap * (end - start) : covered(start);
+    }
+
+    if (duplicate) {
+        metrics.duplicates.inc();
+        if (firstNs)
+            metrics.lead.record(now - firstNs);
+        return false;
+    }
+
+    m_passed.push_back({start, end, now});
+    return true;
+}
+
+void HedgedSession::follow(Leg& leg, bool won, uint64_t previousNs) {
+    if (leg.index == m_leader) {
+        // the leader winning breaks every other leg's run
+        if (won)
+            for (auto& other : m_legs)
+                other->streak = 0;
+        return;
+    }
+
+    if (won)
+        ++leg.streak;
+
+    auto& leader = *m_legs[m_leader];
+    auto leaderNs = leader.lastResultNs.load();
+
+    // the leader is down, or this leg kept producing results while the leader produced none
+    bool stalled = leader.connecting.load(memory_order_acquire) || !leader.backend->isOpen() ||
+                   (previousNs > leaderNs && previousNs - leaderNs > toNs(m_options.degraded));
+
+    if (!stalled && leg.streak < m_options.leadAfter)
+        return;
+
+    Log::info("hedged transcription session " + to_string(leg.index) + " now leads" +
+              (stalled ? ", session " + to_string(m_leader) + " stalled" : ""));
+
+    m_leader = leg.index;
+    for (auto& other : m_legs)
+        other->streak = 0;
+
+    auto& metrics = hedgeMetrics();
+    metrics.leaderChanges.inc();
+    metrics.leader.set(static_cast<int64_t>(m_leader));
+}
+
+size_t HedgedSession::open() {
+    size_t count = 0;
+    for (auto& leg : m_legs)
+        count += !leg->connecting.load(memory_order_acquire) && leg->backend->isOpen();
+    return count;
+}
+
+void HedgedSession::closeStream() {
+    for (auto& leg : m_legs)
+        if (!leg->connecting.load(memory_order_acquire) && leg->backend->isOpen())
+            leg->backend->closeStream();
+}
+
+void HedgedSession::close() {
+    for (auto& leg : m_legs) {
+        if (leg->connector.joinable())
+            leg->connector.join();
+        leg->backend->close();
+    }
+
+    hedgeMetrics().openLegs.set(0);
+}
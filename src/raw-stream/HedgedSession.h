@@ -0,0 +1,123 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_HEDGEDSESSION_H
+#define MEETING_SDK_LINUX_SAMPLE_HEDGEDSESSION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "TranscriptionBackend.h"
+#include "LatencyTracker.h"
+#include "../util/Threads.h"
+
+using namespace std;
+
+/**
+ * Sends the same audio to several independent transcription sessions and
+ * passes on whichever result for a stretch of audio arrives first.
+ *
+ * Each leg's results are moved from its own stream time onto one timeline,
+ * seconds since the first frame, by way of capture time. A final result
+ * keeps only the words whose middle falls outside every final already
+ * passed on; one with no words left is a duplicate. Interim results come
+ * from a single leader leg, which changes when the leader stops producing
+ * results or another leg keeps winning, so that captions do not flicker
+ * between two sessions.
+ *
+ * A leg that closes, or goes quiet while another keeps producing results,
+ * is reconnected in the background without holding up the others.
+ */
+class HedgedSession {
+public:
+    struct Options {
+        // share of a final's duration already passed on that makes it a duplicate when it has no words
+        double overlap = 0.5;
+        // a leader without results for this long hands interims to another leg
+        chrono::milliseconds degraded{1500};
+        // consecutive finals another leg must win before it becomes the leader
+        int leadAfter = 3;
+        // a leg without results for this long while another has them is reconnected
+        chrono::milliseconds silent{10000};
+        chrono::milliseconds retry{2000};
+        // how long finals passed on are remembered
+        chrono::seconds window{120};
+    };
+
+private:
+    struct Leg {
+        size_t index;
+        unique_ptr<TranscriptionBackend> backend;
+        unique_ptr<LatencyTracker> latency;
+
+        atomic<bool> connecting{false};
+        Thread connector;
+        uint64_t retryNs = 0;
+        atomic<uint64_t> lastResultNs{0};
+        uint64_t openedNs = 0;
+
+        // finals won in a row while another leg leads
+        int streak = 0;
+    };
+
+    struct Range {
+        double start;
+        double end;
+        uint64_t arrivalNs;
+    };
+
+    Options m_options;
+    vector<unique_ptr<Leg>> m_legs;
+
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    atomic<uint64_t> m_epochNs{0};
+
+    mutex m_lock;
+    deque<Range> m_passed;
+    size_t m_leader = 0;
+
+    function<void(DeepgramResults&)> m_onResult;
+
+    void connect(Leg& leg, uint64_t now);
+    bool usable(Leg& leg, uint64_t now);
+    void onResult(Leg& leg, DeepgramResults& results);
+    bool dedupe(DeepgramResults& results, uint64_t now);
+    void follow(Leg& leg, bool won, uint64_t previousNs);
+
+public:
+    HedgedSession(const vector<TranscriptionBackend::Options>& legs, const Options& options);
+    ~HedgedSession();
+
+    void setOnResult(const function<void(DeepgramResults&)>& callback);
+
+    /**
+     * Start connecting every leg; frames sent before a leg is open are not sent to it
+     */
+    void initialize(int sampleRate, int channels);
+
+    /**
+     * Send one frame to every open leg
+     * @return true if at least one leg took it
+     */
+    bool send(char* data, size_t len, uint64_t captureNs);
+
+    /**
+     * @return legs currently open
+     */
+    size_t open();
+
+    /**
+     * Ask every open leg for its last results and to end its stream
+     */
+    void closeStream();
+
+    void close();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_HEDGEDSESSION_H
@@ -0,0 +1,106 @@
+#include "LatencyTracker.h"
+
+#include <string>
+
+#include "../util/Trace.h"
+
+LatencyTracker::LatencyTracker() :
+    m_marks(c_capacity),
+    m_final(MetricsRegistry::getInstance().histogram("zoomsdk_transcript_latency_seconds", "Audio capture to transcript result", "type=\"final\"")),
+    m_interim(MetricsRegistry::getInstance().histogram("zoomsdk_transcript_latency_seconds", "Audio capture to transcript result", "type=\"interim\""))
+{
+    auto& registry = MetricsRegistry::getInstance();
+
+    for (auto type : {"final", "interim"}) {
+        auto& histogram = string(type) == "final" ? m_final : m_interim;
+        for (auto q : {"0.5", "0.9", "0.99"}) {
+            auto quantile = stod(q);
+            registry.gauge("zoomsdk_transcript_latency_quantile_seconds", "Audio capture to transcript result quantiles",
+                           [&histogram, quantile]() { return histogram.quantile(quantile) / 1e9; },
+                           string("type=\"") + type + "\",quantile=\"" + q + "\"");
+        }
+    }
+}
+
+void LatencyTracker::setFormat(int sampleRate, int channels) {
+    lock_guard<mutex> lock(m_lock);
+    m_bytesPerSecond = static_cast<double>(sampleRate) * channels * sizeof(int16_t);
+}
+
+void LatencyTracker::onSent(size_t bytes, uint64_t captureNs) {
+    lock_guard<mutex> lock(m_lock);
+    m_marks[m_count++ % c_capacity] = {m_offset, captureNs};
+    m_offset += bytes;
+}
+
+uint64_t LatencyTracker::bytesSent() {
+    lock_guard<mutex> lock(m_lock);
+    return m_offset;
+}
+
+uint64_t LatencyTracker::captureTimeAt(double streamSeconds) {
+    lock_guard<mutex> lock(m_lock);
+    if (m_count == 0 || m_bytesPerSecond <= 0)
+        return 0;
+
+    auto offset = static_cast<uint64_t>(streamSeconds * m_bytesPerSecond);
+    if (offset > 0) offset--;
+
+    size_t first = m_count > c_capacity ? m_count - c_capacity : 0;
+    if (offset < m_marks[first % c_capacity].offset)
+        return 0;
+
+    // last mark at or before the offset; marks are ordered by offset
+    size_t lo = first, hi = m_count;
+    while (hi - lo > 1) {
+        auto mid = lo + (hi - lo) / 2;
+        if (m_marks[mid % c_capacity].offset <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return m_marks[lo % c_capacity].captureNs;
+}
+
+double LatencyTracker::streamTimeAt(uint64_t captureNs) {
+    lock_guard<mutex> lock(m_lock);
+    if (m_count == 0 || m_bytesPerSecond <= 0)
+        return -1;
+
+    // capture times grow with the offset, so the same search works in reverse
+    size_t first = m_count > c_capacity ? m_count - c_capacity : 0;
+    size_t lo = first, hi = m_count;
+    while (hi - lo > 1) {
+        auto mid = lo + (hi - lo) / 2;
+        if (m_marks[mid % c_capacity].captureNs <= captureNs)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    const auto& mark = m_marks[lo % c_capacity];
+    double seconds = mark.offset / m_bytesPerSecond;
+    if (captureNs > mark.captureNs)
+        seconds += (captureNs - mark.captureNs) / 1e9;
+    else
+        seconds -= (mark.captureNs - captureNs) / 1e9;
+
+    return seconds > 0 ? seconds : 0;
+}
+
+void LatencyTracker::onResult(const DeepgramResults& results) {
+    if (results.type != "Results")
+        return;
+
+    auto captureNs = captureTimeAt(results.start + results.duration);
+    if (!captureNs)
+        return;
+
+    auto now = Metrics::now();
+    if (now < captureNs)
+        return;
+
+    (results.is_final ? m_final : m_interim).record(now - captureNs);
+    Trace::record(results.is_final ? "audio_to_final" : "audio_to_interim", "latency", captureNs, now - captureNs);
+}
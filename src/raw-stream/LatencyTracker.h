@@ -0,0 +1,72 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_LATENCYTRACKER_H
+#define MEETING_SDK_LINUX_SAMPLE_LATENCYTRACKER_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "DeepgramJsonParser.h"
+#include "../util/Metrics.h"
+
+using namespace std;
+
+/**
+ * Measures the delay between capturing audio and receiving its transcript.
+ *
+ * Every frame sent to the backend is remembered as (stream byte offset,
+ * capture time) in a fixed ring. A result covers [start, start + duration)
+ * seconds of the stream, so its end maps back to a byte offset and from there
+ * to the callback that delivered that audio.
+ */
+class LatencyTracker {
+
+    struct Mark {
+        uint64_t offset;
+        uint64_t captureNs;
+    };
+
+    static constexpr size_t c_capacity = 1 << 14;
+
+    mutex m_lock;
+    vector<Mark> m_marks;
+    size_t m_count = 0;
+    uint64_t m_offset = 0;
+    double m_bytesPerSecond = 0;
+
+    Histogram& m_final;
+    Histogram& m_interim;
+
+public:
+    LatencyTracker();
+
+    void setFormat(int sampleRate, int channels);
+
+    /**
+     * Note a frame handed to the backend
+     * @param bytes frame length
+     * @param captureNs steady clock time of the SDK callback that delivered it
+     */
+    void onSent(size_t bytes, uint64_t captureNs);
+
+    /**
+     * Record the latency of a result against the capture time of its last audio
+     */
+    void onResult(const DeepgramResults& results);
+
+    /**
+     * @param streamSeconds position in the audio stream
+     * @return capture time of the audio at that position, 0 if no longer known
+     */
+    uint64_t captureTimeAt(double streamSeconds);
+
+    /**
+     * Inverse of captureTimeAt, placing another capture, e.g. a video frame, on the transcript timeline
+     * @param captureNs steady clock time
+     * @return position in the audio stream in seconds, negative if no audio has been sent
+     */
+    double streamTimeAt(uint64_t captureNs);
+
+    uint64_t bytesSent();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_LATENCYTRACKER_H
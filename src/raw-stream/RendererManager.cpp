@@ -0,0 +1,193 @@
+#include "RendererManager.h"
+
+#include <algorithm>
+
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+namespace {
+    Gauge& renderersActive() {
+        static auto& gauge = MetricsRegistry::getInstance().gauge("zoomsdk_video_renderers_active", "Renderers subscribed to a user");
+        return gauge;
+    }
+}
+
+RendererManager::RendererManager() {
+    renderersActive();
+}
+
+RendererManager::~RendererManager() {
+    close();
+}
+
+void RendererManager::setCapacity(size_t capacity) {
+    m_capacity = max<size_t>(1, capacity);
+    m_slots.reserve(m_capacity);
+}
+
+void RendererManager::setResolution(ZoomSDKResolution resolution) {
+    m_resolution = resolution;
+}
+
+void RendererManager::setDir(const string& dir) {
+    m_dir = dir;
+}
+
+void RendererManager::setFilename(const string& filename) {
+    m_filename = filename;
+}
+
+void RendererManager::setOnCreate(const function<void(ZoomSDKRendererDelegate&)>& callback) {
+    m_onCreate = callback;
+}
+
+size_t RendererManager::active() const {
+    return m_active.load(memory_order_relaxed);
+}
+
+void RendererManager::updateActive() {
+    m_active = count_if(m_slots.begin(), m_slots.end(), [](const Slot& slot) { return slot.userId != 0; });
+    renderersActive().set(static_cast<int64_t>(m_active.load(memory_order_relaxed)));
+}
+
+string RendererManager::filenameFor(unsigned int userId) const {
+    if (m_capacity == 1)
+        return m_filename;
+
+    auto dot = m_filename.find_last_of('.');
+    if (dot == string::npos || dot == 0)
+        return m_filename + "-" + to_string(userId);
+
+    return m_filename.substr(0, dot) + "-" + to_string(userId) + m_filename.substr(dot);
+}
+
+RendererManager::Slot* RendererManager::find(unsigned int userId) {
+    for (auto& slot : m_slots)
+        if (slot.userId == userId)
+            return &slot;
+    return nullptr;
+}
+
+RendererManager::Slot* RendererManager::victim(uint64_t now) {
+    if (m_slots.size() < m_capacity) {
+        m_slots.emplace_back();
+        return &m_slots.back();
+    }
+
+    Slot* oldest = nullptr;
+    for (auto& slot : m_slots) {
+        if (slot.userId == 0)
+            return &slot;
+        if (!oldest || slot.activeNs < oldest->activeNs)
+            oldest = &slot;
+    }
+
+    if (oldest && now - oldest->activeNs < m_holdNs)
+        return nullptr;
+
+    return oldest;
+}
+
+SDKError RendererManager::assign(Slot& slot, unsigned int userId, uint64_t now) {
+    static auto& reassignments = MetricsRegistry::getInstance().counter("zoomsdk_video_renderer_assignments_total", "Renderers subscribed to a new user");
+
+    SDKError err;
+
+    if (!slot.renderer) {
+        slot.delegate = new ZoomSDKRendererDelegate();
+        slot.delegate->setDir(m_dir);
+        if (m_onCreate)
+            m_onCreate(*slot.delegate);
+
+        err = createRenderer(&slot.renderer, slot.delegate);
+        if (err != SDKERR_SUCCESS) {
+            Log::error("failed to create a raw video renderer: " + to_string(err));
+            delete slot.delegate;
+            slot.delegate = nullptr;
+            slot.renderer = nullptr;
+            return err;
+        }
+
+        slot.renderer->setRawDataResolution(m_resolution);
+    } else if (slot.userId) {
+        slot.renderer->unSubscribe();
+    }
+
+    slot.delegate->setFilename(filenameFor(userId));
+
+    err = slot.renderer->subscribe(userId, RAW_DATA_TYPE_VIDEO);
+    if (err != SDKERR_SUCCESS) {
+        Log::error("failed to subscribe to video from user " + to_string(userId) + ": " + to_string(err));
+        slot.userId = 0;
+        updateActive();
+        return err;
+    }
+
+    Log::info("rendering video from user " + to_string(userId));
+
+    slot.userId = userId;
+    slot.activeNs = now;
+    reassignments.inc();
+    updateActive();
+
+    return SDKERR_SUCCESS;
+}
+
+SDKError RendererManager::subscribe(const vector<unsigned int>& userIds) {
+    auto now = Metrics::now();
+    SDKError err = SDKERR_SUCCESS;
+
+    for (auto userId : userIds) {
+        if (find(userId))
+            continue;
+
+        auto* slot = victim(now);
+        if (!slot)
+            break;
+
+        err = assign(*slot, userId, now);
+    }
+
+    return err;
+}
+
+void RendererManager::onActiveSpeakers(const vector<unsigned int>& userIds) {
+    auto now = Metrics::now();
+
+    // refresh everyone first so a current speaker is never chosen as the victim
+    for (auto userId : userIds)
+        if (auto* slot = find(userId))
+            slot->activeNs = now;
+
+    for (auto userId : userIds) {
+        if (find(userId))
+            continue;
+
+        auto* slot = victim(now);
+        if (!slot)
+            return;
+
+        assign(*slot, userId, now);
+    }
+}
+
+void RendererManager::close() {
+    for (auto& slot : m_slots) {
+        if (slot.renderer) {
+            slot.renderer->unSubscribe();
+            destroyRenderer(slot.renderer);
+            slot.renderer = nullptr;
+        }
+
+        if (slot.delegate) {
+            slot.delegate->close();
+            delete slot.delegate;
+            slot.delegate = nullptr;
+        }
+
+        slot.userId = 0;
+    }
+
+    m_slots.clear();
+    updateActive();
+}
@@ -0,0 +1,95 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_RENDERERMANAGER_H
+#define MEETING_SDK_LINUX_SAMPLE_RENDERERMANAGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "zoom_sdk_def.h"
+#include "rawdata/zoom_rawdata_api.h"
+#include "rawdata/rawdata_renderer_interface.h"
+
+#include "ZoomSDKRendererDelegate.h"
+
+using namespace std;
+using namespace ZOOMSDK;
+
+/**
+ * Keeps a fixed pool of renderers subscribed to the most recent speakers.
+ *
+ * The pool size caps how many video streams are decoded at once. When someone
+ * starts speaking who has no renderer, the renderer of the speaker who has
+ * been quiet longest is resubscribed to them rather than destroyed, and its
+ * delegate switches to that user's file. A renderer is not taken from a user
+ * who spoke within the hold time, so overlapping speakers do not make
+ * renderers flap between them.
+ */
+class RendererManager {
+
+    struct Slot {
+        IZoomSDKRenderer* renderer = nullptr;
+        ZoomSDKRendererDelegate* delegate = nullptr;
+        unsigned int userId = 0;
+        uint64_t activeNs = 0;
+    };
+
+    vector<Slot> m_slots;
+    atomic<size_t> m_active{0};
+    size_t m_capacity = 1;
+    uint64_t m_holdNs = 2000000000;
+    ZoomSDKResolution m_resolution = ZoomSDKResolution_720P;
+
+    string m_dir = "out";
+    string m_filename;
+
+    function<void(ZoomSDKRendererDelegate&)> m_onCreate;
+
+    string filenameFor(unsigned int userId) const;
+    Slot* find(unsigned int userId);
+    Slot* victim(uint64_t now);
+    SDKError assign(Slot& slot, unsigned int userId, uint64_t now);
+    void updateActive();
+
+public:
+    RendererManager();
+    ~RendererManager();
+
+    /**
+     * @param capacity most renderers, and so video decodes, to run at once
+     */
+    void setCapacity(size_t capacity);
+    void setResolution(ZoomSDKResolution resolution);
+    void setDir(const string& dir);
+
+    /**
+     * With one renderer every user is written to this file; with more, each
+     * user gets their own file named after it, e.g. video-16778240.yuv
+     */
+    void setFilename(const string& filename);
+
+    /**
+     * Called once for each new delegate to apply its settings
+     */
+    void setOnCreate(const function<void(ZoomSDKRendererDelegate&)>& callback);
+
+    /**
+     * Subscribe to the given users in order until the pool is full
+     */
+    SDKError subscribe(const vector<unsigned int>& userIds);
+
+    /**
+     * Move renderers to the users who are speaking now
+     */
+    void onActiveSpeakers(const vector<unsigned int>& userIds);
+
+    /**
+     * Unsubscribe every renderer and flush their writers
+     */
+    void close();
+
+    size_t active() const;
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_RENDERERMANAGER_H
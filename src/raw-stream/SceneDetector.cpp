@@ -0,0 +1,141 @@
+#include "SceneDetector.h"
+
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+SceneDetector::SceneDetector() : SceneDetector(Options()) {}
+
+SceneDetector::SceneDetector(const Options& options) : m_options(options) {}
+
+void SceneDetector::thumbnail(const uint8_t* y, int width, int height, int stride, vector<uint32_t>& sums, vector<uint8_t>& out) {
+    int cols = width / c_block;
+    int rows = height / c_block;
+
+    out.resize(static_cast<size_t>(cols) * rows);
+    sums.assign(cols, 0);
+
+    for (int by = 0; by < rows; ++by) {
+        for (int r = 0; r < c_block; ++r) {
+            const uint8_t* row = y + static_cast<size_t>(by * c_block + r) * stride;
+#ifdef __SSE2__
+            const __m128i zero = _mm_setzero_si128();
+            for (int bx = 0; bx < cols; ++bx) {
+                // against zero the SAD is the plain sum of each 8 byte half
+                __m128i s = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + bx * c_block)), zero);
+                sums[bx] += static_cast<uint32_t>(_mm_cvtsi128_si32(s) + _mm_extract_epi16(s, 4));
+            }
+#else
+            for (int bx = 0; bx < cols; ++bx)
+                for (int i = 0; i < c_block; ++i)
+                    sums[bx] += row[bx * c_block + i];
+#endif
+        }
+
+        uint8_t* dst = out.data() + static_cast<size_t>(by) * cols;
+        for (int bx = 0; bx < cols; ++bx) {
+            dst[bx] = static_cast<uint8_t>((sums[bx] + c_block * c_block / 2) / (c_block * c_block));
+            sums[bx] = 0;
+        }
+    }
+}
+
+SceneDetector::Diff SceneDetector::compare(const uint8_t* a, const uint8_t* b, size_t n, int threshold) {
+    Diff diff;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+    __m128i sad = zero;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        sad = _mm_add_epi64(sad, _mm_sad_epu8(va, vb));
+
+        // |a - b| > threshold exactly when the saturated excess is non-zero
+        __m128i absDiff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        __m128i within = _mm_cmpeq_epi8(_mm_subs_epu8(absDiff, limit), zero);
+        diff.changed += 16 - __builtin_popcount(_mm_movemask_epi8(within));
+    }
+
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sad);
+    diff.sad = lanes[0] + lanes[1];
+#endif
+
+    for (; i < n; ++i) {
+        int d = abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+        diff.sad += d;
+        diff.changed += d > threshold;
+    }
+
+    return diff;
+}
+
+SceneDetector::Result SceneDetector::push(const uint8_t* y, int width, int height, int stride, uint64_t nowNs) {
+    if (width < c_block || height < c_block)
+        return STABLE;
+
+    thumbnail(y, width, height, stride, m_sums, m_current);
+
+    // the first frame, and the first after a resolution change, is always kept
+    if (width != m_width || height != m_height || m_keyframe.empty()) {
+        m_width = width;
+        m_height = height;
+        m_keyframe = m_current;
+        m_previous = m_current;
+        m_changing = false;
+        m_changedNs = nowNs;
+        m_score = 1;
+        return KEYFRAME;
+    }
+
+    auto blocks = static_cast<double>(m_current.size());
+    auto fromKeyframe = compare(m_current.data(), m_keyframe.data(), m_current.size(), m_options.blockThreshold).changed / blocks;
+    auto motion = compare(m_current.data(), m_previous.data(), m_current.size(), m_options.blockThreshold).changed / blocks;
+    m_previous.swap(m_current);
+
+    if (!m_changing) {
+        if (fromKeyframe < m_options.enter)
+            return STABLE;
+
+        m_changing = true;
+        m_changedNs = nowNs;
+        m_still = 0;
+        m_changingFrames = 0;
+    }
+
+    ++m_changingFrames;
+    m_still = motion < m_options.exit ? m_still + 1 : 0;
+
+    if (m_still < m_options.settleFrames && m_changingFrames < m_options.maxChangingFrames)
+        return CHANGING;
+
+    m_changing = false;
+
+    // the picture went back to what it was, e.g. a menu opened and closed
+    if (fromKeyframe < m_options.enter)
+        return STABLE;
+
+    m_keyframe = m_previous;
+    m_score = fromKeyframe;
+    return KEYFRAME;
+}
+
+uint64_t SceneDetector::changedNs() const {
+    return m_changedNs;
+}
+
+double SceneDetector::score() const {
+    return m_score;
+}
+
+void SceneDetector::reset() {
+    m_width = m_height = 0;
+    m_keyframe.clear();
+    m_changing = false;
+}
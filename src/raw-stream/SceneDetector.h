@@ -0,0 +1,100 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_SCENEDETECTOR_H
+#define MEETING_SDK_LINUX_SAMPLE_SCENEDETECTOR_H
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Finds the frames worth keeping in mostly static video such as shared slides.
+ *
+ * Each luma plane is reduced to a grid of 16x16 block means, summed with
+ * _mm_sad_epu8. A change starts when enough blocks differ from the last
+ * keyframe and is only accepted once the picture has held still for a few
+ * frames, so transitions and cursor movement do not produce keyframes of
+ * their own.
+ */
+class SceneDetector {
+public:
+    static constexpr int c_block = 16;
+
+    struct Options {
+        // luma levels a block mean must move by to count as changed
+        int blockThreshold = 6;
+        // fraction of blocks differing from the last keyframe that starts a change
+        double enter = 0.02;
+        // fraction of blocks moving between frames below which the picture is still
+        double exit = 0.005;
+        // still frames needed before a change is accepted
+        int settleFrames = 2;
+        // give up waiting for the picture to settle after this many frames
+        int maxChangingFrames = 30;
+    };
+
+    enum Result {
+        STABLE,
+        CHANGING,
+        KEYFRAME
+    };
+
+    struct Diff {
+        uint64_t sad = 0;
+        size_t changed = 0;
+    };
+
+private:
+    Options m_options;
+
+    int m_width = 0;
+    int m_height = 0;
+    vector<uint8_t> m_keyframe;
+    vector<uint8_t> m_previous;
+    vector<uint8_t> m_current;
+    vector<uint32_t> m_sums;
+
+    bool m_changing = false;
+    int m_still = 0;
+    int m_changingFrames = 0;
+    uint64_t m_changedNs = 0;
+    double m_score = 0;
+
+public:
+    SceneDetector();
+    explicit SceneDetector(const Options& options);
+
+    /**
+     * Analyze the next frame
+     * @param y luma plane
+     * @param width plane width; columns past the last full block are ignored
+     * @param height plane height; rows past the last full block are ignored
+     * @param stride bytes between rows
+     * @param nowNs capture time of the frame
+     * @return KEYFRAME when this frame should be kept
+     */
+    Result push(const uint8_t* y, int width, int height, int stride, uint64_t nowNs);
+
+    /**
+     * Capture time of the first frame of the change that produced the last keyframe
+     */
+    uint64_t changedNs() const;
+
+    /**
+     * Fraction of blocks that differed from the previous keyframe when the last keyframe was taken
+     */
+    double score() const;
+
+    void reset();
+
+    /**
+     * Reduce a plane to one mean per 16x16 block
+     */
+    static void thumbnail(const uint8_t* y, int width, int height, int stride, vector<uint32_t>& sums, vector<uint8_t>& out);
+
+    /**
+     * Sum of absolute differences and the number of bytes differing by more than a threshold
+     */
+    static Diff compare(const uint8_t* a, const uint8_t* b, size_t n, int threshold);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_SCENEDETECTOR_H
@@ -0,0 +1,512 @@
+#include "SharedAudioRing.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../util/IoLoop.h"
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+size_t SharedAudio::slotStride(size_t slotBytes) {
+    return (sizeof(SlotHeader) + slotBytes + 63) & ~static_cast<size_t>(63);
+}
+
+namespace {
+    struct RingMetrics {
+        Counter& frames;
+        Gauge& readers;
+    };
+
+    RingMetrics& ringMetrics() {
+        static RingMetrics* metrics = [] {
+            auto& registry = MetricsRegistry::getInstance();
+            return new RingMetrics{
+                registry.counter("zoomsdk_shm_audio_frames_total", "Slots written to the shared audio ring"),
+                registry.gauge("zoomsdk_shm_audio_readers", "Processes attached to the shared audio ring")
+            };
+        }();
+
+        return *metrics;
+    }
+
+    bool unixAddress(const string& path, sockaddr_un& addr) {
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path))
+            return false;
+
+        memcpy(addr.sun_path, path.c_str(), path.size());
+        return true;
+    }
+}
+
+SharedAudioWriter::SharedAudioWriter() {
+    for (auto& fd : m_notify)
+        fd = -1;
+}
+
+SharedAudioWriter::~SharedAudioWriter() {
+    close();
+}
+
+bool SharedAudioWriter::open(size_t slotCount, size_t slotBytes) {
+    if (m_map)
+        return true;
+
+    m_slotCount = max<size_t>(slotCount, 16);
+    m_slotBytes = (max<size_t>(slotBytes, 256) + 3) & ~static_cast<size_t>(3);
+    m_stride = SharedAudio::slotStride(m_slotBytes);
+    m_size = SharedAudio::c_headerSize + m_slotCount * m_stride;
+
+    m_memfd = memfd_create("zoomsdk-audio", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_memfd < 0) {
+        Log::error("unable to create shared audio memory: " + string(strerror(errno)));
+        return false;
+    }
+
+    if (ftruncate(m_memfd, static_cast<off_t>(m_size)) != 0) {
+        Log::error("unable to size shared audio memory: " + string(strerror(errno)));
+        close();
+        return false;
+    }
+
+    void* map = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_memfd, 0);
+    if (map == MAP_FAILED) {
+        Log::error("unable to map shared audio memory: " + string(strerror(errno)));
+        close();
+        return false;
+    }
+    m_map = static_cast<uint8_t*>(map);
+
+    m_header = new (m_map) SharedAudio::RingHeader();
+    memcpy(m_header->magic, SharedAudio::c_magic, sizeof(m_header->magic));
+    m_header->version = SharedAudio::c_version;
+    m_header->slotBytes = static_cast<uint32_t>(m_slotBytes);
+    m_header->slotCount = static_cast<uint32_t>(m_slotCount);
+    m_header->published.store(0, memory_order_relaxed);
+
+    for (size_t i = 0; i < m_slotCount; ++i)
+        new (m_map + SharedAudio::c_headerSize + i * m_stride) SharedAudio::SlotHeader();
+
+    // readers get the same fd, so fix the size and keep them from writing through new mappings
+    int seals = F_SEAL_SHRINK | F_SEAL_GROW;
+#ifdef F_SEAL_FUTURE_WRITE
+    seals |= F_SEAL_FUTURE_WRITE;
+#endif
+    if (fcntl(m_memfd, F_ADD_SEALS, seals | F_SEAL_SEAL) != 0)
+        Log::warn("unable to seal shared audio memory: " + string(strerror(errno)));
+
+    m_seq = 0;
+    return true;
+}
+
+bool SharedAudioWriter::listen(const string& path) {
+    if (!m_map || m_listenFd >= 0)
+        return false;
+
+    sockaddr_un addr{};
+    if (!unixAddress(path, addr)) {
+        Log::error("invalid shared audio socket path " + path);
+        return false;
+    }
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (m_listenFd < 0) {
+        Log::error("unable to create shared audio socket: " + string(strerror(errno)));
+        return false;
+    }
+
+    unlink(path.c_str());
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(m_listenFd, 8) != 0) {
+        Log::error("unable to listen on " + path + ": " + string(strerror(errno)));
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+
+    m_socketPath = path;
+    m_acceptWatch = IoLoop::getInstance().watch(m_listenFd, G_IO_IN, [this](GIOCondition) {
+        accept();
+        return true;
+    });
+
+    ringMetrics();
+
+    Log::info("sharing audio on " + path);
+    return true;
+}
+
+bool SharedAudioWriter::sendFds(int socket, int eventFd) {
+    char tag = 'A';
+    iovec iov{&tag, 1};
+
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        cmsghdr align;
+    } control{};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    auto* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+
+    int fds[2] = {m_memfd, eventFd};
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    return sendmsg(socket, &msg, MSG_NOSIGNAL) == 1;
+}
+
+void SharedAudioWriter::retire(int eventFd) {
+    {
+        // publish() holds this while it signals, so the fd cannot be closed under it
+        lock_guard<mutex> lock(m_lock);
+        for (auto& fd : m_notify)
+            if (fd == eventFd)
+                fd = -1;
+    }
+
+    ringMetrics().readers.add(-1);
+
+    ::close(eventFd);
+}
+
+void SharedAudioWriter::accept() {
+    while (true) {
+        int socket = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (socket < 0)
+            return;
+
+        int eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        bool placed = false;
+        if (eventFd >= 0) {
+            lock_guard<mutex> lock(m_lock);
+            for (auto& fd : m_notify) {
+                if (fd < 0) {
+                    fd = eventFd;
+                    placed = true;
+                    ringMetrics().readers.add(1);
+                    break;
+                }
+            }
+        }
+
+        if (!placed) {
+            Log::warn("rejecting shared audio reader, " + to_string(SharedAudio::c_maxReaders) + " already attached");
+            if (eventFd >= 0)
+                ::close(eventFd);
+            ::close(socket);
+            continue;
+        }
+
+        if (!sendFds(socket, eventFd)) {
+            retire(eventFd);
+            ::close(socket);
+            continue;
+        }
+
+        // a reader never sends anything, so readable means it has gone
+        auto watch = IoLoop::getInstance().watch(socket, G_IO_IN, [this, socket](GIOCondition) {
+            detach(socket);
+            return false;
+        });
+
+        m_clients.push_back({socket, eventFd, watch});
+        Log::info("shared audio reader attached");
+    }
+}
+
+void SharedAudioWriter::detach(int socket) {
+    auto it = find_if(m_clients.begin(), m_clients.end(), [socket](const Client& client) { return client.socket == socket; });
+    if (it == m_clients.end())
+        return;
+
+    retire(it->eventFd);
+    ::close(it->socket);
+    m_clients.erase(it);
+    Log::info("shared audio reader detached");
+}
+
+void SharedAudioWriter::publish(uint32_t node, int sampleRate, int channels, uint64_t captureNs, const char* data, size_t len) {
+    if (!m_map || !data || !len)
+        return;
+
+    lock_guard<mutex> lock(m_lock);
+
+    // keep whole samples in each slot
+    size_t chunk = m_slotBytes - m_slotBytes % (static_cast<size_t>(max(channels, 1)) * 2);
+    size_t slots = 0;
+
+    for (size_t offset = 0; offset < len; offset += chunk, ++slots) {
+        size_t bytes = min(chunk, len - offset);
+        uint64_t seq = m_seq++;
+
+        auto* slot = reinterpret_cast<SharedAudio::SlotHeader*>(
+                m_map + SharedAudio::c_headerSize + (seq % m_slotCount) * m_stride);
+
+        slot->seq.store(2 * seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        slot->captureNs = captureNs;
+        slot->node = node;
+        slot->sampleRate = static_cast<uint32_t>(sampleRate);
+        slot->bytes = static_cast<uint32_t>(bytes);
+        slot->channels = static_cast<uint16_t>(channels);
+        slot->flags = offset + bytes < len ? SharedAudio::CONTINUED : 0;
+        memcpy(reinterpret_cast<uint8_t*>(slot) + sizeof(SharedAudio::SlotHeader), data + offset, bytes);
+
+        slot->seq.store(2 * seq + 2, memory_order_release);
+    }
+
+    m_header->published.store(m_seq, memory_order_release);
+    ringMetrics().frames.inc(slots);
+
+    // a full counter only means the reader already has a wakeup pending
+    uint64_t one = 1;
+    for (int fd : m_notify)
+        if (fd >= 0)
+            (void) !write(fd, &one, sizeof(one));
+}
+
+void SharedAudioWriter::close() {
+    if (m_acceptWatch) {
+        IoLoop::getInstance().run([this]() {
+            auto& loop = IoLoop::getInstance();
+            loop.remove(m_acceptWatch);
+            for (const auto& client : m_clients) {
+                loop.remove(client.watch);
+                retire(client.eventFd);
+                ::close(client.socket);
+            }
+            m_clients.clear();
+        });
+        m_acceptWatch = 0;
+    }
+
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        unlink(m_socketPath.c_str());
+    }
+
+    if (m_map) {
+        munmap(m_map, m_size);
+        m_map = nullptr;
+        m_header = nullptr;
+    }
+
+    if (m_memfd >= 0) {
+        ::close(m_memfd);
+        m_memfd = -1;
+    }
+}
+
+size_t SharedAudioWriter::readers() {
+    lock_guard<mutex> lock(m_lock);
+    return static_cast<size_t>(count_if(m_notify.begin(), m_notify.end(), [](int fd) { return fd >= 0; }));
+}
+
+SharedAudioReader::~SharedAudioReader() {
+    close();
+}
+
+bool SharedAudioReader::connect(const string& path, bool fromStart) {
+    sockaddr_un addr{};
+    if (!unixAddress(path, addr)) {
+        Log::error("invalid shared audio socket path " + path);
+        return false;
+    }
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_socket < 0 || ::connect(m_socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        Log::error("unable to connect to " + path + ": " + string(strerror(errno)));
+        close();
+        return false;
+    }
+
+    char tag = 0;
+    iovec iov{&tag, 1};
+
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        cmsghdr align;
+    } control{};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    auto* cmsg = recvmsg(m_socket, &msg, MSG_CMSG_CLOEXEC) == 1 ? CMSG_FIRSTHDR(&msg) : nullptr;
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+        Log::error("shared audio writer at " + path + " did not hand over its ring");
+        close();
+        return false;
+    }
+
+    int fds[2];
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    m_memfd = fds[0];
+    m_eventFd = fds[1];
+
+    struct stat st{};
+    if (fstat(m_memfd, &st) != 0 || static_cast<size_t>(st.st_size) < SharedAudio::c_headerSize) {
+        Log::error("shared audio ring is too small");
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(st.st_size);
+
+    void* map = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_memfd, 0);
+    if (map == MAP_FAILED) {
+        Log::error("unable to map shared audio ring: " + string(strerror(errno)));
+        close();
+        return false;
+    }
+    m_map = static_cast<const uint8_t*>(map);
+    m_header = reinterpret_cast<const SharedAudio::RingHeader*>(m_map);
+
+    if (memcmp(m_header->magic, SharedAudio::c_magic, sizeof(m_header->magic)) != 0 ||
+        m_header->version != SharedAudio::c_version ||
+        SharedAudio::c_headerSize + m_header->slotCount * SharedAudio::slotStride(m_header->slotBytes) > m_size) {
+        Log::error("unsupported shared audio ring layout");
+        close();
+        return false;
+    }
+
+    m_stride = SharedAudio::slotStride(m_header->slotBytes);
+
+    uint64_t published = m_header->published.load(memory_order_acquire);
+    m_cursor = fromStart && published > m_header->slotCount ? published - m_header->slotCount : fromStart ? 0 : published;
+    m_lost = 0;
+
+    return true;
+}
+
+const SharedAudio::SlotHeader* SharedAudioReader::slot(uint64_t seq) const {
+    return reinterpret_cast<const SharedAudio::SlotHeader*>(
+            m_map + SharedAudio::c_headerSize + (seq % m_header->slotCount) * m_stride);
+}
+
+bool SharedAudioReader::next(Frame& frame) {
+    if (!m_map)
+        return false;
+
+    while (true) {
+        uint64_t published = m_header->published.load(memory_order_acquire);
+        if (m_cursor >= published)
+            return false;
+
+        // lapped: jump to the oldest slot that is still intact
+        if (published - m_cursor > m_header->slotCount) {
+            m_lost += published - m_header->slotCount - m_cursor;
+            m_cursor = published - m_header->slotCount;
+        }
+
+        const auto* s = slot(m_cursor);
+        uint64_t expected = 2 * m_cursor + 2;
+
+        if (s->seq.load(memory_order_acquire) != expected) {
+            ++m_lost;
+            ++m_cursor;
+            continue;
+        }
+
+        frame.seq = m_cursor;
+        frame.captureNs = s->captureNs;
+        frame.node = s->node;
+        frame.sampleRate = s->sampleRate;
+        frame.channels = s->channels;
+        frame.flags = s->flags;
+        frame.len = min<size_t>(s->bytes, m_header->slotBytes);
+        frame.data = reinterpret_cast<const char*>(s) + sizeof(SharedAudio::SlotHeader);
+
+        ++m_cursor;
+
+        if (!valid(frame)) {
+            ++m_lost;
+            continue;
+        }
+
+        return true;
+    }
+}
+
+bool SharedAudioReader::valid(const Frame& frame) const {
+    atomic_thread_fence(memory_order_acquire);
+    return slot(frame.seq)->seq.load(memory_order_relaxed) == 2 * frame.seq + 2;
+}
+
+void SharedAudioReader::rewind(uint64_t seq) {
+    m_cursor = min(m_cursor, seq);
+}
+
+bool SharedAudioReader::wait(int timeoutMs) {
+    if (m_eventFd < 0)
+        return false;
+
+    if (m_cursor < m_header->published.load(memory_order_acquire))
+        return true;
+
+    pollfd fds[2] = {{m_eventFd, POLLIN, 0}, {m_socket, POLLIN, 0}};
+    if (poll(fds, 2, timeoutMs) <= 0)
+        return false;
+
+    // the writer closing its end means it is gone
+    if (fds[1].revents)
+        return false;
+
+    uint64_t count;
+    (void) !read(m_eventFd, &count, sizeof(count));
+    return true;
+}
+
+bool SharedAudioReader::connected() const {
+    if (m_socket < 0)
+        return false;
+
+    pollfd fd{m_socket, POLLIN, 0};
+    return poll(&fd, 1, 0) == 0;
+}
+
+uint64_t SharedAudioReader::lost() const {
+    return m_lost;
+}
+
+int SharedAudioReader::eventFd() const {
+    return m_eventFd;
+}
+
+int SharedAudioReader::socketFd() const {
+    return m_socket;
+}
+
+void SharedAudioReader::close() {
+    if (m_map) {
+        munmap(const_cast<uint8_t*>(m_map), m_size);
+        m_map = nullptr;
+        m_header = nullptr;
+    }
+
+    for (int* fd : {&m_memfd, &m_eventFd, &m_socket}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
@@ -0,0 +1,204 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_SHAREDAUDIORING_H
+#define MEETING_SDK_LINUX_SAMPLE_SHAREDAUDIORING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Shared memory layout
+ *
+ *   ring header   one page: magic, version, slot size and count, published sequence
+ *   slots         slot header | payload[slotBytes]
+ *
+ * The writer fills slot (seq % count) and marks it with a per-slot sequence
+ * that is odd while being written and 2 * seq + 2 once complete, seqlock
+ * style. Readers copy or read in place, then check the sequence again, so a
+ * reader that has been lapped finds out instead of holding up the writer.
+ * Frames larger than a slot are split over consecutive slots that share a
+ * capture time and carry the CONTINUED flag on all but the last.
+ */
+namespace SharedAudio {
+    constexpr char c_magic[8] = {'Z', 'D', 'G', 'A', 'U', 'D', '1', '\0'};
+    constexpr uint32_t c_version = 1;
+    constexpr size_t c_headerSize = 4096;
+    constexpr size_t c_maxReaders = 16;
+
+    enum Flags : uint16_t {
+        CONTINUED = 1,
+    };
+
+    struct RingHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotBytes;
+        uint32_t slotCount;
+        uint32_t reserved;
+        alignas(64) atomic<uint64_t> published;
+    };
+
+    struct alignas(64) SlotHeader {
+        atomic<uint64_t> seq;
+        uint64_t captureNs;
+        uint32_t node;
+        uint32_t sampleRate;
+        uint32_t bytes;
+        uint16_t channels;
+        uint16_t flags;
+    };
+
+    size_t slotStride(size_t slotBytes);
+}
+
+/**
+ * Publishes audio frames into a memfd ring for other processes on the host.
+ *
+ * Readers connect to a unix socket and receive the memfd and an eventfd of
+ * their own over SCM_RIGHTS. Publishing is a copy into the ring and a
+ * non-blocking eventfd write per reader, and never waits for anyone.
+ */
+class SharedAudioWriter {
+
+    int m_memfd = -1;
+    uint8_t* m_map = nullptr;
+    size_t m_size = 0;
+    size_t m_slotBytes = 0;
+    size_t m_slotCount = 0;
+    size_t m_stride = 0;
+    SharedAudio::RingHeader* m_header = nullptr;
+    uint64_t m_seq = 0;
+
+    struct Client {
+        int socket;
+        int eventFd;
+        unsigned watch;
+    };
+
+    // the listening socket and connected readers are watched by the IoLoop and only touched on its thread
+    string m_socketPath;
+    int m_listenFd = -1;
+    unsigned m_acceptWatch = 0;
+    vector<Client> m_clients;
+
+    // reader eventfds, guarded by m_lock together with the ring writes
+    mutex m_lock;
+    array<int, SharedAudio::c_maxReaders> m_notify;
+
+    void accept();
+    void detach(int socket);
+    bool sendFds(int socket, int eventFd);
+    void retire(int eventFd);
+
+public:
+    SharedAudioWriter();
+    ~SharedAudioWriter();
+
+    /**
+     * Create the ring
+     * @param slotCount number of slots; a power of two keeps the index math cheap
+     * @param slotBytes payload bytes per slot
+     */
+    bool open(size_t slotCount = 2048, size_t slotBytes = 2048);
+
+    /**
+     * Accept readers on a unix socket
+     * @param path socket path, replaced if it exists
+     */
+    bool listen(const string& path);
+
+    void publish(uint32_t node, int sampleRate, int channels, uint64_t captureNs, const char* data, size_t len);
+
+    void close();
+
+    size_t readers();
+};
+
+/**
+ * Attaches to a SharedAudioWriter from another process
+ */
+class SharedAudioReader {
+
+    int m_socket = -1;
+    int m_memfd = -1;
+    int m_eventFd = -1;
+    const uint8_t* m_map = nullptr;
+    size_t m_size = 0;
+    size_t m_stride = 0;
+    const SharedAudio::RingHeader* m_header = nullptr;
+
+    uint64_t m_cursor = 0;
+    uint64_t m_lost = 0;
+
+    const SharedAudio::SlotHeader* slot(uint64_t seq) const;
+
+public:
+    struct Frame {
+        uint64_t seq;
+        uint64_t captureNs;
+        uint32_t node;
+        uint32_t sampleRate;
+        uint16_t channels;
+        uint16_t flags;
+        // points into shared memory; check valid() after using it
+        const char* data;
+        size_t len;
+    };
+
+    ~SharedAudioReader();
+
+    /**
+     * Connect to a writer's socket and map its ring
+     * @param path socket path
+     * @param fromStart start at the oldest frame still held rather than the newest
+     */
+    bool connect(const string& path, bool fromStart = false);
+
+    /**
+     * Take the next frame in place without copying
+     * @return false if there is nothing new
+     */
+    bool next(Frame& frame);
+
+    /**
+     * @return true if the writer has not overwritten the frame since next() returned it
+     */
+    bool valid(const Frame& frame) const;
+
+    /**
+     * Make next() return this frame again, e.g. one read before its consumer was ready
+     */
+    void rewind(uint64_t seq);
+
+    /**
+     * Block until the writer publishes or the timeout passes
+     * @param timeoutMs -1 to wait indefinitely
+     */
+    bool wait(int timeoutMs);
+
+    /**
+     * Frames overwritten before this reader got to them
+     */
+    uint64_t lost() const;
+
+    /**
+     * @return false once the writer has closed the connection
+     */
+    bool connected() const;
+
+    int eventFd() const;
+
+    /**
+     * @return the socket to the writer, readable once the writer has gone
+     */
+    int socketFd() const;
+
+    void close();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_SHAREDAUDIORING_H
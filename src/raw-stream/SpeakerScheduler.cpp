@@ -0,0 +1,291 @@
+#include "SpeakerScheduler.h"
+
+#include <algorithm>
+
+#include "AudioDsp.h"
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+namespace {
+    struct SchedulerMetrics {
+        Counter& assignments;
+        Counter& preemptions;
+        Counter& covered;
+        Counter& uncovered;
+        Gauge& speaking;
+    };
+
+    SchedulerMetrics& schedulerMetrics() {
+        static SchedulerMetrics* metrics = [] {
+            auto& registry = MetricsRegistry::getInstance();
+            auto* m = new SchedulerMetrics{
+                registry.counter("zoomsdk_scheduler_assignments_total", "Transcription sessions handed to a new participant"),
+                registry.counter("zoomsdk_scheduler_preemptions_total", "Assignments that took a session from another participant"),
+                registry.counter("zoomsdk_scheduler_voiced_frames_total", "One-way frames with speech", "covered=\"true\""),
+                registry.counter("zoomsdk_scheduler_voiced_frames_total", "One-way frames with speech", "covered=\"false\""),
+                registry.gauge("zoomsdk_scheduler_speaking_nodes", "Participants heard within the hangover time")
+            };
+
+            registry.gauge("zoomsdk_scheduler_coverage_ratio", "Share of speech frames sent to a transcription session", [m]() {
+                double covered = m->covered.value();
+                double total = covered + m->uncovered.value();
+                return total > 0 ? covered / total : 1.0;
+            });
+
+            return m;
+        }();
+
+        return *metrics;
+    }
+
+    uint64_t toNs(chrono::milliseconds ms) {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(ms).count());
+    }
+}
+
+SpeakerScheduler::SpeakerScheduler(const Options& options) : m_options(options) {
+    for (size_t i = 0; i < m_options.sessions; ++i)
+        m_sessions.push_back(make_unique<Session>());
+
+    schedulerMetrics();
+}
+
+SpeakerScheduler::~SpeakerScheduler() {
+    close();
+}
+
+void SpeakerScheduler::setBackend(const TranscriptionBackend::Options& options) {
+    m_backend = options;
+}
+
+void SpeakerScheduler::setOnResult(const function<void(DeepgramResults&)>& callback) {
+    m_onResult = callback;
+}
+
+SpeakerScheduler::Session* SpeakerScheduler::connect(size_t index) {
+    auto& session = *m_sessions[index];
+    if (!session.backend)
+        session.backend = TranscriptionBackend::create(m_backend);
+    if (!session.backend)
+        return nullptr;
+
+    if (session.backend->isOpen())
+        return &session;
+
+    session.backend->setOnResult([this, &session](DeepgramResults& results) { onResult(session, results); });
+    session.latency.setFormat(m_sampleRate, m_channels);
+
+    if (!session.backend->open(m_sampleRate, m_channels)) {
+        Log::error("failed to open transcription session " + to_string(index));
+        return nullptr;
+    }
+
+    return &session;
+}
+
+int SpeakerScheduler::choose(const Node& node, uint64_t now) {
+    auto hold = toNs(m_options.hold);
+    auto hangover = toNs(m_options.hangover);
+
+    int best = -1;
+    uint64_t bestQuiet = 0;
+
+    for (size_t i = 0; i < m_sessions.size(); ++i) {
+        const auto& session = *m_sessions[i];
+        if (now < session.retryNs)
+            continue;
+
+        if (session.node == 0)
+            return static_cast<int>(i);
+
+        if (now - session.assignedNs < hold)
+            continue;
+
+        const auto& holder = m_nodes[session.node];
+        auto quiet = now - holder.lastVoiceNs;
+        bool silent = quiet >= hangover;
+        bool louder = node.levelDb > holder.levelDb + m_options.marginDb;
+
+        // prefer whoever has been quiet longest
+        if ((silent || louder) && (best < 0 || quiet > bestQuiet)) {
+            best = static_cast<int>(i);
+            bestQuiet = quiet;
+        }
+    }
+
+    return best;
+}
+
+void SpeakerScheduler::assign(int index, uint32_t nodeId, Node& node, uint64_t now) {
+    auto& metrics = schedulerMetrics();
+    auto& session = *m_sessions[index];
+
+    if (session.node != 0) {
+        m_nodes[session.node].session = -1;
+        metrics.preemptions.inc();
+
+        // close the previous speaker's utterance before new audio arrives
+        session.backend->flush();
+        session.node = 0;
+    }
+
+    if (!connect(index)) {
+        session.retryNs = now + toNs(chrono::seconds(5));
+        return;
+    }
+
+    session.node = nodeId;
+    session.assignedNs = now;
+    node.session = index;
+    metrics.assignments.inc();
+
+    {
+        lock_guard<mutex> lock(session.lock);
+        session.segments.push_back({session.latency.bytesSent(), nodeId});
+        while (session.segments.size() > 1024)
+            session.segments.pop_front();
+    }
+
+    Log::debug("transcription session " + to_string(index) + " assigned to node " + to_string(nodeId));
+
+    for (auto& frame : node.preRoll) {
+        send(session, frame.data.data(), frame.data.size(), frame.captureNs);
+        node.spare.push_back(move(frame.data));
+    }
+    node.preRoll.clear();
+    node.preRollBytes = 0;
+}
+
+void SpeakerScheduler::send(Session& session, char* data, size_t len, uint64_t captureNs) {
+    if (session.backend->push(data, len))
+        session.latency.onSent(len, captureNs);
+
+    // in capture time, the clock keepAlive() runs on; pre-roll frames are older than the last send
+    session.lastSendNs = max(session.lastSendNs, captureNs);
+}
+
+void SpeakerScheduler::keepAlive(uint64_t now) {
+    auto interval = toNs(m_options.keepAlive);
+
+    // Deepgram closes a stream that has been sent nothing for a while
+    for (auto& session : m_sessions) {
+        if (session->backend && session->backend->isOpen() && now > session->lastSendNs && now - session->lastSendNs > interval) {
+            session->backend->keepAlive();
+            session->lastSendNs = now;
+        }
+    }
+}
+
+void SpeakerScheduler::onAudio(uint32_t nodeId, char* data, size_t len, int sampleRate, int channels, uint64_t captureNs) {
+    auto& metrics = schedulerMetrics();
+
+    if (!m_epochNs) {
+        m_epochNs = captureNs;
+        m_sampleRate = sampleRate;
+        m_channels = channels;
+        m_preRollLimit = static_cast<size_t>(sampleRate) * channels * sizeof(int16_t) * m_options.preRoll.count() / 1000;
+    }
+
+    auto& node = m_nodes[nodeId];
+    auto frameDb = AudioDsp::levelDb(reinterpret_cast<const int16_t*>(data), len / sizeof(int16_t));
+    bool voiced = frameDb > m_options.voiceDb;
+
+    // fast attack, slow release
+    node.levelDb += (frameDb > node.levelDb ? 0.5 : 0.05) * (frameDb - node.levelDb);
+    if (voiced) {
+        m_speaking.erase({node.lastVoiceNs, nodeId});
+        node.lastVoiceNs = captureNs;
+        m_speaking.insert({captureNs, nodeId});
+    }
+
+    if (node.session < 0 && voiced) {
+        int index = choose(node, captureNs);
+        if (index >= 0)
+            assign(index, nodeId, node, captureNs);
+    }
+
+    if (node.session >= 0) {
+        send(*m_sessions[node.session], data, len, captureNs);
+    } else {
+        // keep the last few hundred ms so an assignment starts before the first word
+        vector<char> buffer;
+        if (!node.spare.empty()) {
+            buffer = move(node.spare.back());
+            node.spare.pop_back();
+        }
+        buffer.assign(data, data + len);
+
+        node.preRoll.push_back({move(buffer), captureNs});
+        node.preRollBytes += len;
+
+        while (node.preRollBytes > m_preRollLimit && !node.preRoll.empty()) {
+            node.preRollBytes -= node.preRoll.front().data.size();
+            node.spare.push_back(move(node.preRoll.front().data));
+            node.preRoll.pop_front();
+        }
+    }
+
+    if (voiced)
+        (node.session >= 0 ? metrics.covered : metrics.uncovered).inc();
+
+    auto hangover = toNs(m_options.hangover);
+    while (!m_speaking.empty() && captureNs > m_speaking.begin()->first && captureNs - m_speaking.begin()->first >= hangover)
+        m_speaking.erase(m_speaking.begin());
+    metrics.speaking.set(static_cast<int64_t>(m_speaking.size()));
+
+    keepAlive(captureNs);
+}
+
+void SpeakerScheduler::onResult(Session& session, DeepgramResults& results) {
+    session.latency.onResult(results);
+
+    if (results.type == "Results") {
+        auto offset = static_cast<uint64_t>(results.start * m_sampleRate * m_channels * sizeof(int16_t));
+
+        {
+            lock_guard<mutex> lock(session.lock);
+            for (auto it = session.segments.rbegin(); it != session.segments.rend(); ++it) {
+                if (it->offset <= offset) {
+                    results.node = it->node;
+                    break;
+                }
+            }
+        }
+
+        // move the result from session time onto the shared timeline
+        auto captureNs = session.latency.captureTimeAt(results.start);
+        results.captureNs = captureNs;
+        if (captureNs >= m_epochNs && captureNs) {
+            double shift = (captureNs - m_epochNs) / 1e9 - results.start;
+            results.start += shift;
+            for (auto& alternative : results.channel.alternatives) {
+                for (auto& word : alternative.words) {
+                    word.start += shift;
+                    word.end += shift;
+                }
+            }
+        }
+    }
+
+    if (m_onResult)
+        m_onResult(results);
+}
+
+void SpeakerScheduler::closeStream() {
+    for (auto& session : m_sessions)
+        if (session->backend && session->backend->isOpen())
+            session->backend->closeStream();
+}
+
+size_t SpeakerScheduler::open() {
+    size_t count = 0;
+    for (auto& session : m_sessions)
+        count += session->backend && session->backend->isOpen();
+    return count;
+}
+
+void SpeakerScheduler::close() {
+    for (auto& session : m_sessions)
+        if (session->backend)
+            session->backend->close();
+}
@@ -0,0 +1,132 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_SPEAKERSCHEDULER_H
+#define MEETING_SDK_LINUX_SAMPLE_SPEAKERSCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TranscriptionBackend.h"
+#include "LatencyTracker.h"
+
+using namespace std;
+
+/**
+ * Shares a fixed number of transcription sessions among the participants
+ * who are speaking.
+ *
+ * Every one-way frame updates its node's short-term level and a short
+ * pre-roll buffer. A node that starts speaking takes a free session, or the
+ * session of a node that has been silent for the hangover time or is
+ * quieter by the margin, but never one assigned less than the hold time ago.
+ * The pre-roll is sent first so the first word is not clipped.
+ *
+ * Each session's results are traced back to the node that was assigned when
+ * their audio was sent. Their times are rewritten from session stream time
+ * to seconds since the first captured frame, so results from all sessions
+ * share one timeline.
+ */
+class SpeakerScheduler {
+public:
+    struct Options {
+        size_t sessions = 2;
+        chrono::milliseconds preRoll{300};
+        chrono::milliseconds hold{2000};
+        chrono::milliseconds hangover{1500};
+        chrono::milliseconds keepAlive{5000};
+        // level above which a frame counts as speech
+        double voiceDb = -45;
+        // how much louder a node must be to take a session from one still speaking
+        double marginDb = 6;
+    };
+
+private:
+    struct Frame {
+        vector<char> data;
+        uint64_t captureNs;
+    };
+
+    struct Node {
+        double levelDb = -100;
+        uint64_t lastVoiceNs = 0;
+        int session = -1;
+        deque<Frame> preRoll;
+        size_t preRollBytes = 0;
+        vector<vector<char>> spare;
+    };
+
+    struct Segment {
+        uint64_t offset;
+        uint32_t node;
+    };
+
+    struct Session {
+        unique_ptr<TranscriptionBackend> backend;
+        LatencyTracker latency;
+        uint32_t node = 0;
+        uint64_t assignedNs = 0;
+        uint64_t lastSendNs = 0;
+        uint64_t retryNs = 0;
+
+        mutex lock;
+        deque<Segment> segments;
+    };
+
+    Options m_options;
+    TranscriptionBackend::Options m_backend;
+
+    vector<unique_ptr<Session>> m_sessions;
+    unordered_map<uint32_t, Node> m_nodes;
+    // nodes heard within the hangover, by when they were last heard, so the oldest expire first
+    set<pair<uint64_t, uint32_t>> m_speaking;
+
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    size_t m_preRollLimit = 0;
+    uint64_t m_epochNs = 0;
+
+    function<void(DeepgramResults&)> m_onResult;
+
+    Session* connect(size_t index);
+    int choose(const Node& node, uint64_t now);
+    void assign(int index, uint32_t nodeId, Node& node, uint64_t now);
+    void send(Session& session, char* data, size_t len, uint64_t captureNs);
+    void keepAlive(uint64_t now);
+    void onResult(Session& session, DeepgramResults& results);
+
+public:
+    explicit SpeakerScheduler(const Options& options);
+    ~SpeakerScheduler();
+
+    void setBackend(const TranscriptionBackend::Options& options);
+    void setOnResult(const function<void(DeepgramResults&)>& callback);
+
+    /**
+     * Feed one frame from the one-way audio callback
+     */
+    void onAudio(uint32_t nodeId, char* data, size_t len, int sampleRate, int channels, uint64_t captureNs);
+
+    /**
+     * Ask every open session for its last results and to end its stream
+     */
+    void closeStream();
+
+    /**
+     * @return sessions currently open
+     */
+    size_t open();
+
+    /**
+     * Close every session
+     */
+    void close();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_SPEAKERSCHEDULER_H
@@ -0,0 +1,128 @@
+#include "TlsSessions.h"
+
+#include <Poco/Exception.h>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/URI.h>
+#include <openssl/ssl.h>
+
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+namespace {
+    Counter& handshakes(bool resumed) {
+        return MetricsRegistry::getInstance().counter("zoomsdk_tls_handshakes_total", "TLS handshakes by outcome",
+                                                      resumed ? "resumed=\"true\"" : "resumed=\"false\"");
+    }
+}
+
+string TlsSessions::key(const string& host, uint16_t port) {
+    return host + ":" + to_string(port);
+}
+
+Poco::Net::Context::Ptr TlsSessions::context() {
+    lock_guard<mutex> lock(m_lock);
+
+    if (!m_context) {
+        Poco::Net::Context::Params params;
+        params.verificationMode = Poco::Net::Context::VERIFY_RELAXED;
+        params.loadDefaultCAs = true;
+
+        m_context = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, params);
+        m_context->enableSessionCache(true);
+
+        // sockets are non-blocking and WebSocketFrameWriter retries from wherever the rest of its buffer now is,
+        // which OpenSSL otherwise rejects as a bad write retry
+        SSL_CTX_set_mode(m_context->sslContext(), SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+        MetricsRegistry::getInstance().gauge("zoomsdk_tls_resumption_ratio", "Share of TLS handshakes that resumed a cached session", [] {
+            auto resumed = handshakes(true).value();
+            auto total = resumed + handshakes(false).value();
+            return total ? static_cast<double>(resumed) / static_cast<double>(total) : 0.0;
+        });
+    }
+
+    return m_context;
+}
+
+Poco::Net::SecureStreamSocket TlsSessions::connect(const string& host, uint16_t port) {
+    static auto& resumedCount = handshakes(true);
+    static auto& fullCount = handshakes(false);
+    static auto& resumedTime = MetricsRegistry::getInstance().histogram("zoomsdk_tls_handshake_seconds", "TCP connect and TLS handshake time", "resumed=\"true\"");
+    static auto& fullTime = MetricsRegistry::getInstance().histogram("zoomsdk_tls_handshake_seconds", "TCP connect and TLS handshake time", "resumed=\"false\"");
+    static auto& failures = MetricsRegistry::getInstance().counter("zoomsdk_tls_handshake_failures_total", "TLS connections that failed to connect or verify");
+
+    Poco::Net::SecureStreamSocket socket(context());
+    socket.setPeerHostName(host);
+
+    Poco::Net::Session::Ptr cached;
+    {
+        lock_guard<mutex> lock(m_lock);
+        auto it = m_sessions.find(key(host, port));
+        if (it != m_sessions.end())
+            cached = it->second;
+    }
+    if (cached)
+        socket.useSession(cached);
+
+    auto start = Metrics::now();
+    try {
+        socket.connect(Poco::Net::SocketAddress(host, port), Poco::Timespan(10, 0));
+        socket.completeHandshake();
+    } catch (...) {
+        // a session the server no longer accepts should not be offered again
+        failures.inc();
+        forget(host, port);
+        throw;
+    }
+    auto elapsed = Metrics::now() - start;
+
+    bool resumed = cached && socket.sessionWasReused();
+    (resumed ? resumedCount : fullCount).inc();
+    (resumed ? resumedTime : fullTime).record(elapsed);
+
+    Log::debug("TLS " + string(resumed ? "resumed" : "full") + " handshake with " + host + " in " +
+               to_string(elapsed / 1000000) + " ms");
+
+    remember(host, port, socket);
+    return socket;
+}
+
+void TlsSessions::remember(const string& host, uint16_t port, Poco::Net::SecureStreamSocket& socket) {
+    auto session = socket.currentSession();
+    if (!session)
+        return;
+
+    lock_guard<mutex> lock(m_lock);
+    m_sessions[key(host, port)] = session;
+}
+
+void TlsSessions::forget(const string& host, uint16_t port) {
+    lock_guard<mutex> lock(m_lock);
+    m_sessions.erase(key(host, port));
+}
+
+bool TlsSessions::warm(const string& url) {
+    static auto& warmTime = MetricsRegistry::getInstance().histogram("zoomsdk_tls_warmup_seconds", "Time to connect ahead of need and keep the session");
+
+    ScopedTimer timer(warmTime);
+    try {
+        Poco::URI uri(url);
+        auto port = uri.getPort() ? uri.getPort() : static_cast<uint16_t>(443);
+        auto socket = connect(uri.getHost(), port);
+
+        // TLS 1.3 tickets follow the handshake; a short read lets one arrive before the session is kept
+        socket.setReceiveTimeout(Poco::Timespan(0, 250000));
+        try {
+            char byte;
+            socket.receiveBytes(&byte, 1);
+        } catch (const Poco::TimeoutException&) {
+        }
+
+        remember(uri.getHost(), port, socket);
+        socket.close();
+        return true;
+    } catch (const Poco::Exception& ex) {
+        Log::warn("TLS warm-up for " + url + " failed: " + ex.displayText());
+        return false;
+    }
+}
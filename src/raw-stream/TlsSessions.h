@@ -0,0 +1,67 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_TLSSESSIONS_H
+#define MEETING_SDK_LINUX_SAMPLE_TLSSESSIONS_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <Poco/Net/Context.h>
+#include <Poco/Net/SecureStreamSocket.h>
+#include <Poco/Net/Session.h>
+
+#include "../util/Singleton.h"
+
+using namespace std;
+
+/**
+ * Process-wide TLS client state for outgoing connections.
+ *
+ * Every connection shares one verifying Context, so certificates and cipher
+ * setup are loaded once, and the last session negotiated with each host is
+ * kept so the next connection to it can resume instead of paying for a full
+ * handshake. Reconnects and per-speaker sessions all go to the same host,
+ * which is where this pays off.
+ */
+class TlsSessions : public Singleton<TlsSessions> {
+
+    friend class Singleton<TlsSessions>;
+
+    mutex m_lock;
+    Poco::Net::Context::Ptr m_context;
+    map<string, Poco::Net::Session::Ptr> m_sessions;
+
+    static string key(const string& host, uint16_t port);
+
+public:
+    /**
+     * @return the shared client context, created on first use
+     */
+    Poco::Net::Context::Ptr context();
+
+    /**
+     * Connect and complete the TLS handshake, offering the cached session for the host
+     * @param host server name, also used for SNI and certificate verification
+     * @param port server port
+     * @return the connected socket
+     */
+    Poco::Net::SecureStreamSocket connect(const string& host, uint16_t port);
+
+    /**
+     * Keep the socket's current session for the next connection to the host.
+     * TLS 1.3 servers send their tickets after the handshake, so call this
+     * again once data has been exchanged.
+     */
+    void remember(const string& host, uint16_t port, Poco::Net::SecureStreamSocket& socket);
+
+    void forget(const string& host, uint16_t port);
+
+    /**
+     * Connect once ahead of need, so the first real connection to the URL's
+     * host finds the context loaded and a session to resume
+     * @return false if the host could not be reached
+     */
+    bool warm(const string& url);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_TLSSESSIONS_H
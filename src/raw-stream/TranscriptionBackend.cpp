@@ -0,0 +1,36 @@
+#include "TranscriptionBackend.h"
+
+#include "AdaptiveUplink.h"
+#include "CannedBackend.h"
+#include "DeepgramWSHelper.h"
+#include "../Config.h"
+#include "../util/Log.h"
+
+unique_ptr<TranscriptionBackend> TranscriptionBackend::create(const Options& options) {
+    if (options.engine.empty())
+        return nullptr;
+
+    if (options.adaptive)
+        return make_unique<AdaptiveUplink>(options, AdaptiveUplink::Options());
+
+    if (options.engine == "deepgram")
+        return make_unique<DeepgramWSHelper>(options);
+
+    if (options.engine == "canned")
+        return make_unique<CannedBackend>(options);
+
+    Log::error("unknown transcription engine: " + options.engine);
+    return nullptr;
+}
+
+TranscriptionBackend::Options TranscriptionBackend::fromConfig(const Config& config) {
+    Options options;
+    options.engine = config.engine();
+    options.url = config.endpoint();
+    options.model = config.model();
+    options.params = config.params();
+    options.script = config.script();
+    options.adaptive = config.uplinkAdapt();
+    options.headers["Authorization"] = "Token " + config.deepgramApiKey();
+    return options;
+}
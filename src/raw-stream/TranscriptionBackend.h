@@ -0,0 +1,102 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTIONBACKEND_H
+#define MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTIONBACKEND_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "DeepgramJsonParser.h"
+
+using namespace std;
+
+class Config;
+
+/**
+ * One streaming speech-to-text session.
+ *
+ * Audio goes in from the audio callback, 16-bit PCM unless opened with
+ * another encoding. Results come back through the result callback, on
+ * whichever thread the engine delivers them, timed in seconds of audio
+ * pushed since open().
+ */
+class TranscriptionBackend {
+public:
+    struct Options {
+        // deepgram or canned, empty for no transcription
+        string engine = "deepgram";
+        string url = "wss://api.deepgram.com/v1/listen";
+        map<string, string> headers;
+        string model = "nova-2";
+        // query parameters added to the stream's own encoding, rate, channels and model
+        string params = "endpointing=10&smart_format=true&diarize=true&utterances=true";
+        // canned: text to play back, one utterance per line; built-in text when empty
+        string script;
+        // step the stream's format down and back up with the uplink, see AdaptiveUplink
+        bool adaptive = false;
+    };
+
+    /**
+     * Audio waiting to leave, for engines that send over a socket
+     */
+    struct Backlog {
+        // bytes queued in the process and the most that may wait there
+        size_t queued = 0;
+        size_t queueLimit = 0;
+        // bytes in the kernel not yet acknowledged by the peer, and the socket's send buffer
+        size_t unsent = 0;
+        size_t sendBuffer = 0;
+    };
+
+    virtual ~TranscriptionBackend() = default;
+
+    /**
+     * Start a stream, replacing any previous one
+     * @param encoding linear16 or mulaw
+     * @return true once audio can be pushed
+     */
+    virtual bool open(int sampleRate, int channels, const string& encoding = "linear16") = 0;
+
+    /**
+     * @return false if the frame was not taken, e.g. while disconnected or backed up
+     */
+    virtual bool push(char* data, size_t len) = 0;
+
+    /**
+     * Ask for final results for everything pushed so far
+     */
+    virtual bool flush() = 0;
+
+    /**
+     * Keep an idle stream from being closed by the engine
+     */
+    virtual bool keepAlive() = 0;
+
+    /**
+     * Ask for final results for everything pushed and end the stream;
+     * isOpen() turns false once the engine has sent them and closed it
+     */
+    virtual bool closeStream() = 0;
+
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+    virtual void setOnResult(const function<void(DeepgramResults&)>& callback) = 0;
+
+    /**
+     * @return what is waiting to be sent, all zero for engines without a socket
+     */
+    virtual Backlog backlog() { return {}; }
+
+    /**
+     * @return a backend for options.engine, wrapped in an AdaptiveUplink if options.adaptive,
+     * nullptr if there is no such engine
+     */
+    static unique_ptr<TranscriptionBackend> create(const Options& options);
+
+    /**
+     * @return the engine, endpoint, key and stream parameters set on the RawAudio command
+     */
+    static Options fromConfig(const Config& config);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTIONBACKEND_H
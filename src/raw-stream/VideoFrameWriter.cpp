@@ -0,0 +1,148 @@
+#include "VideoFrameWriter.h"
+
+#include <cstring>
+
+#include "../util/Log.h"
+
+void VideoFrame::resize(int w, int h) {
+    width = w;
+    height = h;
+    data.resize(size());
+}
+
+VideoFrameWriter::VideoFrameWriter(size_t poolSize) :
+    m_frames(MetricsRegistry::getInstance().counter("zoomsdk_video_frames_written_total", "Raw video frames written to disk")),
+    m_dropped(MetricsRegistry::getInstance().counter("zoomsdk_video_frames_dropped_total", "Raw video frames dropped because the writer fell behind")),
+    m_bytes(MetricsRegistry::getInstance().counter("zoomsdk_video_bytes_written_total", "Raw video bytes written to disk")),
+    m_writeTime(MetricsRegistry::getInstance().histogram("zoomsdk_video_write_seconds", "Time to write one raw video frame"))
+{
+    for (size_t i = 0; i < poolSize; ++i)
+        m_free.push_back(make_unique<VideoFrame>());
+
+    m_thread = Thread("video-writer", [this]() { run(); });
+}
+
+VideoFrameWriter::~VideoFrameWriter() {
+    close();
+}
+
+void VideoFrameWriter::setPath(const string& path) {
+    lock_guard<mutex> lock(m_lock);
+    m_path = path;
+}
+
+unique_ptr<VideoFrame> VideoFrameWriter::acquire() {
+    lock_guard<mutex> lock(m_lock);
+
+    if (m_free.empty() || m_stop) {
+        m_dropped.inc();
+        return nullptr;
+    }
+
+    auto frame = move(m_free.back());
+    m_free.pop_back();
+    frame->index.clear();
+    return frame;
+}
+
+void VideoFrameWriter::submit(unique_ptr<VideoFrame> frame) {
+    {
+        lock_guard<mutex> lock(m_lock);
+        frame->path = m_path;
+        m_queue.push_back(move(frame));
+    }
+    m_wake.notify_one();
+}
+
+void VideoFrameWriter::release(unique_ptr<VideoFrame> frame) {
+    lock_guard<mutex> lock(m_lock);
+    m_free.push_back(move(frame));
+}
+
+size_t VideoFrameWriter::queued() {
+    lock_guard<mutex> lock(m_lock);
+    return m_queue.size();
+}
+
+void VideoFrameWriter::close() {
+    {
+        lock_guard<mutex> lock(m_lock);
+        if (m_stop)
+            return;
+        m_stop = true;
+    }
+    m_wake.notify_one();
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void VideoFrameWriter::run() {
+    unique_lock<mutex> lock(m_lock);
+
+    while (true) {
+        m_wake.wait(lock, [&]() { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty())
+            break;
+
+        auto frame = move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+
+        // the path may change between frames, e.g. when a renderer follows another user
+        const auto& path = frame->path;
+        if (m_file.is_open() && path != m_openPath) {
+            m_file.close();
+            m_index.close();
+        }
+
+        if (!m_file.is_open() && !path.empty()) {
+            m_openPath = path;
+            m_file.open(path, ios::out | ios::binary | ios::app);
+            if (!m_file.is_open())
+                Log::error("failed to open video output file: " + path);
+        }
+
+        if (m_file.is_open()) {
+            ScopedTimer timer(m_writeTime);
+            m_file.write(reinterpret_cast<const char*>(frame->data.data()), static_cast<streamsize>(frame->data.size()));
+            m_frames.inc();
+            m_bytes.inc(frame->data.size());
+
+            if (!frame->index.empty())
+                writeIndex(frame->index);
+        }
+
+        lock.lock();
+        m_free.push_back(move(frame));
+    }
+
+    if (m_file.is_open())
+        m_file.close();
+    if (m_index.is_open())
+        m_index.close();
+}
+
+void VideoFrameWriter::writeIndex(const string& line) {
+    if (!m_index.is_open()) {
+        auto path = m_openPath + ".keyframes.jsonl";
+        m_index.open(path, ios::out | ios::app);
+        if (!m_index.is_open()) {
+            Log::error("failed to open keyframe index: " + path);
+            return;
+        }
+    }
+
+    // flushed with each line so the index never names a frame the video file lacks
+    m_index << line << flush;
+}
+
+void VideoFrameWriter::copyPlane(uint8_t* dst, const uint8_t* src, int width, int height, int srcStride) {
+    if (srcStride == width) {
+        memcpy(dst, src, static_cast<size_t>(width) * height);
+        return;
+    }
+
+    for (int row = 0; row < height; ++row)
+        memcpy(dst + static_cast<size_t>(row) * width, src + static_cast<size_t>(row) * srcStride, width);
+}
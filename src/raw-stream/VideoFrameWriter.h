@@ -0,0 +1,114 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_VIDEOFRAMEWRITER_H
+#define MEETING_SDK_LINUX_SAMPLE_VIDEOFRAMEWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../util/Metrics.h"
+#include "../util/Threads.h"
+
+using namespace std;
+
+/**
+ * One packed I420 frame: the Y plane followed by the U and V planes
+ */
+struct VideoFrame {
+    vector<uint8_t> data;
+    int width = 0;
+    int height = 0;
+    uint64_t captureNs = 0;
+    // file the frame goes to, set by submit()
+    string path;
+    // line appended to <path>.keyframes.jsonl when the frame is written, none if empty
+    string index;
+
+    uint8_t* y() { return data.data(); }
+    uint8_t* u() { return data.data() + lumaSize(); }
+    uint8_t* v() { return u() + chromaSize(); }
+
+    size_t lumaSize() const { return static_cast<size_t>(width) * height; }
+    size_t chromaSize() const { return static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2); }
+    size_t size() const { return lumaSize() + 2 * chromaSize(); }
+
+    void resize(int w, int h);
+};
+
+/**
+ * Writes raw frames, and the keyframe index lines that go with them, to disk
+ * from a background thread.
+ *
+ * Frames are drawn from a fixed pool of recycled buffers. When every buffer is
+ * queued or being written the new frame is dropped and counted, so the
+ * producer never waits on the disk.
+ */
+class VideoFrameWriter {
+
+    string m_path;
+    string m_openPath;
+    ofstream m_file;
+    ofstream m_index;
+
+    mutex m_lock;
+    condition_variable m_wake;
+    vector<unique_ptr<VideoFrame>> m_free;
+    deque<unique_ptr<VideoFrame>> m_queue;
+    bool m_stop = false;
+    Thread m_thread;
+
+    Counter& m_frames;
+    Counter& m_dropped;
+    Counter& m_bytes;
+    Histogram& m_writeTime;
+
+    void run();
+    void writeIndex(const string& line);
+
+public:
+    /**
+     * @param poolSize number of frame buffers, i.e. how far the writer may fall behind
+     */
+    explicit VideoFrameWriter(size_t poolSize = 8);
+    ~VideoFrameWriter();
+
+    /**
+     * Frames submitted from now on go to this file, appending if it exists;
+     * frames already queued still go to the file that was set when they were submitted
+     */
+    void setPath(const string& path);
+
+    /**
+     * Take a free buffer to fill
+     * @return nullptr if the writer is behind; the frame is then counted as dropped
+     */
+    unique_ptr<VideoFrame> acquire();
+
+    /**
+     * Queue a filled buffer for writing
+     */
+    void submit(unique_ptr<VideoFrame> frame);
+
+    /**
+     * Return a buffer without writing it
+     */
+    void release(unique_ptr<VideoFrame> frame);
+
+    /**
+     * Write everything queued and stop the thread
+     */
+    void close();
+
+    size_t queued();
+
+    /**
+     * Copy an image plane, dropping any row padding
+     */
+    static void copyPlane(uint8_t* dst, const uint8_t* src, int width, int height, int srcStride);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_VIDEOFRAMEWRITER_H
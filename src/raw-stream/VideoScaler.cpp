@@ -0,0 +1,165 @@
+#include "VideoScaler.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void VideoScaler::halveScalar(const uint8_t* src, int srcWidth, int srcHeight, int srcStride, uint8_t* dst) {
+    int dstWidth = srcWidth / 2;
+
+    for (int y = 0; y < srcHeight / 2; ++y) {
+        const uint8_t* r0 = src + static_cast<size_t>(2 * y) * srcStride;
+        const uint8_t* r1 = r0 + srcStride;
+        uint8_t* out = dst + static_cast<size_t>(y) * dstWidth;
+
+        for (int x = 0; x < dstWidth; ++x)
+            out[x] = static_cast<uint8_t>((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+    }
+}
+
+void VideoScaler::halve(const uint8_t* src, int srcWidth, int srcHeight, int srcStride, uint8_t* dst) {
+#ifdef __SSE2__
+    int dstWidth = srcWidth / 2;
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    const __m128i two = _mm_set1_epi16(2);
+
+    for (int y = 0; y < srcHeight / 2; ++y) {
+        const uint8_t* r0 = src + static_cast<size_t>(2 * y) * srcStride;
+        const uint8_t* r1 = r0 + srcStride;
+        uint8_t* out = dst + static_cast<size_t>(y) * dstWidth;
+
+        int x = 0;
+        // 32 source pixels per row pair in, 16 out
+        for (; x + 16 <= dstWidth; x += 16) {
+            __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 2 * x));
+            __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 2 * x + 16));
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 2 * x));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 2 * x + 16));
+
+            // sum horizontal pairs in 16-bit lanes, then add the two rows
+            __m128i s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, lowBytes), _mm_srli_epi16(a0, 8)),
+                                       _mm_add_epi16(_mm_and_si128(b0, lowBytes), _mm_srli_epi16(b0, 8)));
+            __m128i s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, lowBytes), _mm_srli_epi16(a1, 8)),
+                                       _mm_add_epi16(_mm_and_si128(b1, lowBytes), _mm_srli_epi16(b1, 8)));
+
+            s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+            s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(s0, s1));
+        }
+
+        for (; x < dstWidth; ++x)
+            out[x] = static_cast<uint8_t>((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+    }
+#else
+    halveScalar(src, srcWidth, srcHeight, srcStride, dst);
+#endif
+}
+
+void VideoScaler::bilinear(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+                           uint8_t* dst, int dstWidth, int dstHeight) {
+    // 16.16 fixed point, sampling at pixel centres
+    const int64_t xStep = (static_cast<int64_t>(srcWidth) << 16) / dstWidth;
+    const int64_t yStep = (static_cast<int64_t>(srcHeight) << 16) / dstHeight;
+
+    std::vector<int> x0(dstWidth);
+    std::vector<int> xFrac(dstWidth);
+    for (int x = 0; x < dstWidth; ++x) {
+        int64_t sx = x * xStep + xStep / 2 - (1 << 15);
+        if (sx < 0) sx = 0;
+        x0[x] = static_cast<int>(sx >> 16);
+        xFrac[x] = static_cast<int>((sx >> 8) & 0xff);
+        if (x0[x] >= srcWidth - 1) {
+            x0[x] = srcWidth - 1;
+            xFrac[x] = 0;
+        }
+    }
+
+    for (int y = 0; y < dstHeight; ++y) {
+        int64_t sy = y * yStep + yStep / 2 - (1 << 15);
+        if (sy < 0) sy = 0;
+        int y0 = static_cast<int>(sy >> 16);
+        int yFrac = static_cast<int>((sy >> 8) & 0xff);
+        if (y0 >= srcHeight - 1) {
+            y0 = srcHeight - 1;
+            yFrac = 0;
+        }
+
+        const uint8_t* r0 = src + static_cast<size_t>(y0) * srcStride;
+        const uint8_t* r1 = yFrac ? r0 + srcStride : r0;
+        uint8_t* out = dst + static_cast<size_t>(y) * dstWidth;
+
+        for (int x = 0; x < dstWidth; ++x) {
+            int i = x0[x];
+            int j = xFrac[x] ? i + 1 : i;
+            int top = r0[i] * (256 - xFrac[x]) + r0[j] * xFrac[x];
+            int bottom = r1[i] * (256 - xFrac[x]) + r1[j] * xFrac[x];
+            out[x] = static_cast<uint8_t>((top * (256 - yFrac) + bottom * yFrac + (1 << 15)) >> 16);
+        }
+    }
+}
+
+void VideoScaler::scale(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+                        uint8_t* dst, int dstWidth, int dstHeight) {
+    if (dstWidth == srcWidth && dstHeight == srcHeight) {
+        for (int y = 0; y < srcHeight; ++y)
+            memcpy(dst + static_cast<size_t>(y) * dstWidth, src + static_cast<size_t>(y) * srcStride, srcWidth);
+        return;
+    }
+
+    // count how many exact halvings reach the target
+    int halvings = 0;
+    int w = srcWidth, h = srcHeight;
+    while (w > dstWidth && h > dstHeight && !(w & 1) && !(h & 1) && w / 2 >= dstWidth && h / 2 >= dstHeight) {
+        w /= 2;
+        h /= 2;
+        ++halvings;
+    }
+
+    if (halvings == 0 || w != dstWidth || h != dstHeight) {
+        bilinear(src, srcWidth, srcHeight, srcStride, dst, dstWidth, dstHeight);
+        return;
+    }
+
+    thread_local std::vector<uint8_t> scratch;
+    const uint8_t* in = src;
+    int inWidth = srcWidth, inHeight = srcHeight, inStride = srcStride;
+
+    for (int i = 0; i < halvings; ++i) {
+        int outWidth = inWidth / 2, outHeight = inHeight / 2;
+        bool last = i == halvings - 1;
+
+        // ping-pong through two halves of the scratch buffer
+        size_t half = static_cast<size_t>(srcWidth / 2) * (srcHeight / 2);
+        if (scratch.size() < 2 * half)
+            scratch.resize(2 * half);
+        uint8_t* out = last ? dst : scratch.data() + (i & 1) * half;
+
+        halve(in, inWidth, inHeight, inStride, out);
+
+        in = out;
+        inWidth = outWidth;
+        inHeight = outHeight;
+        inStride = outWidth;
+    }
+}
+
+void FrameDecimator::setFps(double fps) {
+    m_intervalNs = fps > 0 ? static_cast<uint64_t>(1e9 / fps) : 0;
+    m_nextNs = 0;
+}
+
+bool FrameDecimator::accept(uint64_t nowNs) {
+    if (!m_intervalNs)
+        return true;
+
+    if (nowNs < m_nextNs)
+        return false;
+
+    // keep a steady cadence but do not try to catch up after a gap
+    m_nextNs = m_nextNs && nowNs - m_nextNs < m_intervalNs ? m_nextNs + m_intervalNs : nowNs + m_intervalNs;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_VIDEOSCALER_H
+#define MEETING_SDK_LINUX_SAMPLE_VIDEOSCALER_H
+
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Downscaling for 8-bit image planes.
+ *
+ * Power-of-two reductions use a 2x2 box filter vectorized with SSE2, applied
+ * once per halving; any other ratio falls back to fixed-point bilinear.
+ */
+class VideoScaler {
+public:
+    /**
+     * Scale one plane
+     * @param src source plane
+     * @param srcWidth source width in pixels
+     * @param srcHeight source height in rows
+     * @param srcStride bytes between source rows
+     * @param dst destination plane, tightly packed
+     * @param dstWidth destination width, at most srcWidth
+     * @param dstHeight destination height, at most srcHeight
+     */
+    static void scale(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+                      uint8_t* dst, int dstWidth, int dstHeight);
+
+    /**
+     * 2x2 box filter halving both dimensions; width and height must be even
+     */
+    static void halve(const uint8_t* src, int srcWidth, int srcHeight, int srcStride, uint8_t* dst);
+    static void halveScalar(const uint8_t* src, int srcWidth, int srcHeight, int srcStride, uint8_t* dst);
+
+    static void bilinear(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+                         uint8_t* dst, int dstWidth, int dstHeight);
+};
+
+/**
+ * Passes frames through at no more than a target rate
+ */
+class FrameDecimator {
+    uint64_t m_intervalNs = 0;
+    uint64_t m_nextNs = 0;
+
+public:
+    /**
+     * @param fps target frame rate, 0 to keep every frame
+     */
+    void setFps(double fps);
+
+    /**
+     * @param nowNs steady clock time of the frame
+     * @return true if the frame should be kept
+     */
+    bool accept(uint64_t nowNs);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_VIDEOSCALER_H
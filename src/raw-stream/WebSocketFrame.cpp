@@ -0,0 +1,242 @@
+#include "WebSocketFrame.h"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WEBSOCKET_FRAME_AVX2
+#endif
+
+size_t WebSocketFrame::writeHeader(uint8_t* out, Opcode opcode, uint64_t length, uint32_t key) {
+    size_t n = 0;
+    out[n++] = static_cast<uint8_t>(0x80 | opcode);
+
+    if (length < 126) {
+        out[n++] = static_cast<uint8_t>(0x80 | length);
+    } else if (length <= 0xffff) {
+        out[n++] = 0x80 | 126;
+        out[n++] = static_cast<uint8_t>(length >> 8);
+        out[n++] = static_cast<uint8_t>(length);
+    } else {
+        out[n++] = 0x80 | 127;
+        for (int shift = 56; shift >= 0; shift -= 8)
+            out[n++] = static_cast<uint8_t>(length >> shift);
+    }
+
+    memcpy(out + n, &key, sizeof(key));
+    return n + sizeof(key);
+}
+
+void WebSocketFrame::maskScalar(uint8_t* dst, const uint8_t* src, size_t length, uint32_t key) {
+    uint8_t k[4];
+    memcpy(k, &key, sizeof(k));
+
+    for (size_t i = 0; i < length; ++i)
+        dst[i] = src[i] ^ k[i & 3];
+}
+
+namespace {
+    using MaskFn = void (*)(uint8_t*, const uint8_t*, size_t, uint32_t);
+
+    void maskSse2(uint8_t* dst, const uint8_t* src, size_t length, uint32_t key) {
+        size_t i = 0;
+
+#ifdef __SSE2__
+        const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+        for (; i + 16 <= length; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(v, k));
+        }
+#endif
+
+        // i is a multiple of 4, so the key lines up again for the tail
+        WebSocketFrame::maskScalar(dst + i, src + i, length - i, key);
+    }
+
+#ifdef WEBSOCKET_FRAME_AVX2
+    __attribute__((target("avx2")))
+    void maskAvx2(uint8_t* dst, const uint8_t* src, size_t length, uint32_t key) {
+        const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+        size_t i = 0;
+
+        for (; i + 64 <= length; i += 64) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(a, k));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 32), _mm256_xor_si256(b, k));
+        }
+
+        for (; i + 32 <= length; i += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(a, k));
+        }
+
+        WebSocketFrame::maskScalar(dst + i, src + i, length - i, key);
+    }
+#endif
+
+    MaskFn selectMask() {
+#ifdef WEBSOCKET_FRAME_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            return maskAvx2;
+#endif
+        return maskSse2;
+    }
+}
+
+void WebSocketFrame::mask(uint8_t* dst, const uint8_t* src, size_t length, uint32_t key) {
+    static const MaskFn impl = selectMask();
+    impl(dst, src, length, key);
+}
+
+WebSocketFrameWriter::WebSocketFrameWriter(size_t limit) : m_limit(limit), m_rng(random_device{}()) {}
+
+bool WebSocketFrameWriter::queue(WebSocketFrame::Opcode opcode, const void* data, size_t length) {
+    lock_guard<mutex> lock(m_lock);
+
+    // control frames go out even when audio is backed up
+    bool control = opcode >= WebSocketFrame::CLOSE;
+    if (!control && m_pending.size() + length > m_limit)
+        return false;
+
+    auto offset = m_pending.size();
+    m_pending.resize(offset + WebSocketFrame::c_maxHeader + length);
+
+    auto key = static_cast<uint32_t>(m_rng());
+    auto* out = m_pending.data() + offset;
+    auto header = WebSocketFrame::writeHeader(out, opcode, length, key);
+
+    WebSocketFrame::mask(out + header, static_cast<const uint8_t*>(data), length, key);
+    m_pending.resize(offset + header + length);
+    ++m_frames;
+
+    return true;
+}
+
+size_t WebSocketFrameWriter::flush(const Write& write) {
+    lock_guard<mutex> lock(m_lock);
+
+    size_t written = 0;
+    while (written < m_pending.size()) {
+        int n = write(m_pending.data() + written, m_pending.size() - written);
+        if (n <= 0)
+            break;
+        written += static_cast<size_t>(n);
+    }
+
+    if (written == m_pending.size()) {
+        auto frames = m_frames;
+        m_pending.clear();
+        m_frames = 0;
+        return frames;
+    }
+
+    // TLS wants a retried write to start with the same bytes, so keep the rest in order; the context
+    // accepts a moving write buffer, as erasing here and queue() both move them
+    m_pending.erase(m_pending.begin(), m_pending.begin() + static_cast<ptrdiff_t>(written));
+    return 0;
+}
+
+size_t WebSocketFrameWriter::pendingBytes() {
+    lock_guard<mutex> lock(m_lock);
+    return m_pending.size();
+}
+
+size_t WebSocketFrameWriter::limit() const {
+    return m_limit;
+}
+
+void WebSocketFrameWriter::clear() {
+    lock_guard<mutex> lock(m_lock);
+    m_pending.clear();
+    m_frames = 0;
+}
+
+WebSocketFrameReader::WebSocketFrameReader(size_t maxMessage) : m_maxMessage(maxMessage) {}
+
+bool WebSocketFrameReader::feed(const char* data, size_t length, const OnMessage& onMessage) {
+    m_buffer.insert(m_buffer.end(), data, data + length);
+
+    while (true) {
+        const uint8_t* p = m_buffer.data() + m_offset;
+        size_t available = m_buffer.size() - m_offset;
+        if (available < 2)
+            break;
+
+        bool fin = p[0] & 0x80;
+        auto opcode = static_cast<WebSocketFrame::Opcode>(p[0] & 0x0f);
+        bool masked = p[1] & 0x80;
+        uint64_t payload = p[1] & 0x7f;
+        size_t header = 2;
+
+        if (payload == 126) {
+            if (available < 4)
+                break;
+            payload = (static_cast<uint64_t>(p[2]) << 8) | p[3];
+            header = 4;
+        } else if (payload == 127) {
+            if (available < 10)
+                break;
+            payload = 0;
+            for (int i = 0; i < 8; ++i)
+                payload = (payload << 8) | p[2 + i];
+            header = 10;
+        }
+
+        if (payload > m_maxMessage)
+            return false;
+
+        uint32_t key = 0;
+        if (masked) {
+            if (available < header + 4)
+                break;
+            memcpy(&key, p + header, sizeof(key));
+            header += 4;
+        }
+
+        if (available < header + payload)
+            break;
+
+        auto* body = const_cast<uint8_t*>(p) + header;
+        if (masked)
+            WebSocketFrame::mask(body, body, payload, key);
+
+        if (opcode >= WebSocketFrame::CLOSE) {
+            onMessage(opcode, reinterpret_cast<const char*>(body), payload);
+        } else {
+            if (opcode != WebSocketFrame::CONTINUATION)
+                m_messageOpcode = opcode;
+            if (m_message.size() + payload > m_maxMessage)
+                return false;
+
+            m_message.insert(m_message.end(), body, body + payload);
+            if (fin) {
+                onMessage(m_messageOpcode, m_message.data(), m_message.size());
+                m_message.clear();
+            }
+        }
+
+        m_offset += header + payload;
+    }
+
+    // compact once the consumed prefix is worth moving
+    if (m_offset == m_buffer.size()) {
+        m_buffer.clear();
+        m_offset = 0;
+    } else if (m_offset > 64 * 1024) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<ptrdiff_t>(m_offset));
+        m_offset = 0;
+    }
+
+    return true;
+}
+
+void WebSocketFrameReader::clear() {
+    m_buffer.clear();
+    m_offset = 0;
+    m_message.clear();
+}
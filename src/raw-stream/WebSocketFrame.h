@@ -0,0 +1,116 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_WEBSOCKETFRAME_H
+#define MEETING_SDK_LINUX_SAMPLE_WEBSOCKETFRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/**
+ * RFC 6455 framing for the client side of a WebSocket
+ */
+namespace WebSocketFrame {
+    enum Opcode : uint8_t {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xa,
+    };
+
+    constexpr size_t c_maxHeader = 14;
+
+    /**
+     * Write a final, masked frame header
+     * @param out at least c_maxHeader bytes
+     * @param key masking key, written in memory order
+     * @return header length
+     */
+    size_t writeHeader(uint8_t* out, Opcode opcode, uint64_t length, uint32_t key);
+
+    /**
+     * XOR a payload with a masking key, 32 bytes at a time with AVX2 where the CPU has it
+     * @param dst may be the same as src
+     * @param key masking key as it appears in memory, starting at the first payload byte
+     */
+    void mask(uint8_t* dst, const uint8_t* src, size_t length, uint32_t key);
+
+    /**
+     * Byte at a time reference used for the tails and the benchmark
+     */
+    void maskScalar(uint8_t* dst, const uint8_t* src, size_t length, uint32_t key);
+}
+
+/**
+ * Queues masked client frames in one reusable buffer so that everything
+ * waiting, e.g. frames held back while the socket was not writable, goes to
+ * the TLS layer in a single write.
+ */
+class WebSocketFrameWriter {
+
+    mutex m_lock;
+    vector<uint8_t> m_pending;
+    size_t m_frames = 0;
+    size_t m_limit;
+    mt19937 m_rng;
+
+public:
+    /**
+     * Write callback: returns bytes taken, 0 or less if the socket would block
+     */
+    using Write = function<int(const uint8_t* data, size_t length)>;
+
+    /**
+     * @param limit bytes that may wait before frames are refused
+     */
+    explicit WebSocketFrameWriter(size_t limit = 256 * 1024);
+
+    /**
+     * Frame and mask a message at the end of the queue
+     * @return false if the queue is full
+     */
+    bool queue(WebSocketFrame::Opcode opcode, const void* data, size_t length);
+
+    /**
+     * Hand everything queued to the socket, keeping whatever it did not take
+     * @return frames fully written
+     */
+    size_t flush(const Write& write);
+
+    size_t pendingBytes();
+    size_t limit() const;
+    void clear();
+};
+
+/**
+ * Reassembles server frames from the byte stream, including fragmented
+ * messages and control frames interleaved with them
+ */
+class WebSocketFrameReader {
+
+    vector<uint8_t> m_buffer;
+    size_t m_offset = 0;
+    vector<char> m_message;
+    WebSocketFrame::Opcode m_messageOpcode = WebSocketFrame::TEXT;
+    size_t m_maxMessage;
+
+public:
+    using OnMessage = function<void(WebSocketFrame::Opcode opcode, const char* data, size_t length)>;
+
+    explicit WebSocketFrameReader(size_t maxMessage = 1 << 20);
+
+    /**
+     * Add received bytes and report every complete message or control frame
+     * @return false if the stream is not valid WebSocket framing
+     */
+    bool feed(const char* data, size_t length, const OnMessage& onMessage);
+
+    void clear();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_WEBSOCKETFRAME_H
@@ -1,54 +1,209 @@
 // ZoomSDKAudioRawDataDelegate.cpp
 #include "ZoomSDKAudioRawDataDelegate.h"
-#include "DeepgramWSHelper.h" // Updated include
 #include "../Config.h"
+#include "../util/Metrics.h"
+#include "../util/Threads.h"
+#include "../util/Trace.h"
+
+namespace {
+    AudioQuality::Options qualityOptions(bool useMixedAudio) {
+        AudioQuality::Options options;
+        // one-way audio stops while a participant is muted, which is not a stall
+        if (!useMixedAudio)
+            options.resume = chrono::seconds(2);
+        return options;
+    }
+
+    /**
+     * Pushed after every send; the sampled gauge reads this rather than the delegate, which may be gone
+     */
+    atomic<double>& timelineDrift() {
+        static auto* drift = [] {
+            auto* d = new atomic<double>(0);
+            MetricsRegistry::getInstance().gauge("zoomsdk_audio_timeline_drift_seconds", "Transcribed audio ahead of (positive) or behind capture time",
+                                                 [d]() { return d->load(memory_order_relaxed); });
+            return d;
+        }();
+
+        return *drift;
+    }
+}
 
 ZoomSDKAudioRawDataDelegate::ZoomSDKAudioRawDataDelegate(bool useMixedAudio)
     : m_useMixedAudio(useMixedAudio),
-      m_pocoHelper(),
-      m_initialized(false)
+      m_initialized(false),
+      m_quality(useMixedAudio ? "mixed" : "one_way", qualityOptions(useMixedAudio))
 {
-    m_deepgramWebSocketURL = "wss://api.deepgram.com/v1/listen";
-    m_extraHeaders = {{"Authorization", "Token " + m_dgApiKey}};
+    timelineDrift();
+
+    setBackend(m_backendOptions);
 }
 
 void ZoomSDKAudioRawDataDelegate::setDeepgramApiKey(const std::string& apiKey) {
-    m_dgApiKey = apiKey;
-    m_extraHeaders = {{"Authorization", "Token " + m_dgApiKey}};
+    m_backendOptions.headers["Authorization"] = "Token " + apiKey;
+    setBackend(m_backendOptions);
 }
 
-void ZoomSDKAudioRawDataDelegate::initializePocoHelper(int sampleRate, int channelCount)
+void ZoomSDKAudioRawDataDelegate::setBackend(const TranscriptionBackend::Options& options)
+{
+    m_backendOptions = options;
+    m_backend = TranscriptionBackend::create(m_backendOptions);
+    if (m_backend)
+        m_backend->setOnResult([this](DeepgramResults& results) { onBackendResult(results); });
+}
+
+void ZoomSDKAudioRawDataDelegate::openBackend(int sampleRate, int channelCount)
 {
     if (!m_initialized) {
-        m_pocoHelper.initialize(m_deepgramWebSocketURL, m_extraHeaders, "linear16", sampleRate, channelCount);
+        if (m_hedge)
+            m_hedge->initialize(sampleRate, channelCount);
+        else if (m_backend)
+            m_backend->open(sampleRate, channelCount);
+        m_latency.setFormat(sampleRate, channelCount);
+        m_gaps.setFormat(sampleRate, channelCount);
         m_initialized = true;
     }
 }
 
+namespace {
+    struct AudioMetrics {
+        Counter& frames;
+        Counter& bytes;
+        Histogram& callback;
+    };
+
+    AudioMetrics& audioMetrics(const char* stream) {
+        auto& registry = MetricsRegistry::getInstance();
+        string labels = string("stream=\"") + stream + "\"";
+
+        return *new AudioMetrics{
+            registry.counter("zoomsdk_audio_frames_total", "Raw audio callbacks received", labels),
+            registry.counter("zoomsdk_audio_bytes_total", "Raw audio bytes received", labels),
+            registry.histogram("zoomsdk_audio_callback_seconds", "Time spent inside the raw audio callback", labels)
+        };
+    }
+}
+
 void ZoomSDKAudioRawDataDelegate::onMixedAudioRawDataReceived(AudioRawData* data)
 {
-    if (!m_useMixedAudio)
+    if (!m_useMixedAudio || m_draining)
         return;
 
-    initializePocoHelper(data->GetSampleRate(), data->GetChannelNum());
-    m_pocoHelper.send_buffer(data->GetBuffer(), data->GetBufferLen());
+    auto captureNs = Metrics::now();
+    // the SDK's thread, placed by the sdk-audio role on its first frame
+    Threads::adopt("sdk-audio");
+
+    static auto& metrics = audioMetrics("mixed");
+    ScopedTimer timer(metrics.callback);
+    Trace::Span span("callback", "audio");
+    metrics.frames.inc();
+    metrics.bytes.inc(data->GetBufferLen());
+
+    openBackend(data->GetSampleRate(), data->GetChannelNum());
+    m_quality.onFrame(0, data->GetBuffer(), data->GetBufferLen(), data->GetSampleRate(), data->GetChannelNum(), captureNs);
+
+    if (m_shared)
+        m_shared->publish(0, data->GetSampleRate(), data->GetChannelNum(), captureNs, data->GetBuffer(), data->GetBufferLen());
+
+    sendAligned(data->GetBuffer(), data->GetBufferLen(), captureNs);
 }
 
 void ZoomSDKAudioRawDataDelegate::onOneWayAudioRawDataReceived(AudioRawData* data, uint32_t node_id)
 {
-    if (m_useMixedAudio)
+    if (m_useMixedAudio || m_draining)
         return;
 
+    auto captureNs = Metrics::now();
+    Threads::adopt("sdk-audio");
+
+    static auto& metrics = audioMetrics("one_way");
+    ScopedTimer timer(metrics.callback);
+    Trace::Span span("callback", "audio");
+    metrics.frames.inc();
+    metrics.bytes.inc(data->GetBufferLen());
+
+    m_quality.onFrame(node_id, data->GetBuffer(), data->GetBufferLen(), data->GetSampleRate(), data->GetChannelNum(), captureNs);
+
     std::stringstream path;
     path << m_dir << "/node-" << node_id << ".pcm";
     writeToFile(path.str(), data);
+
+    if (m_shared)
+        m_shared->publish(node_id, data->GetSampleRate(), data->GetChannelNum(), captureNs, data->GetBuffer(), data->GetBufferLen());
+
+    if (m_scheduler)
+        m_scheduler->onAudio(node_id, data->GetBuffer(), data->GetBufferLen(), data->GetSampleRate(), data->GetChannelNum(), captureNs);
+
+    if (m_mixer) {
+        openBackend(data->GetSampleRate(), data->GetChannelNum());
+        m_mixer->push(node_id, reinterpret_cast<const int16_t*>(data->GetBuffer()), data->GetBufferLen() / sizeof(int16_t),
+                      data->GetSampleRate(), data->GetChannelNum(), captureNs);
+    }
+}
+
+bool ZoomSDKAudioRawDataDelegate::sendAligned(char* buffer, unsigned int bytes, uint64_t captureNs)
+{
+    auto& registry = MetricsRegistry::getInstance();
+    static auto& fills = registry.counter("zoomsdk_audio_gap_fills_total", "Times silence was sent to cover audio missing from the transcribed stream");
+    static auto& filled = registry.counter("zoomsdk_audio_silence_samples_total", "Samples of silence sent to keep the transcribed stream on capture time");
+
+    auto samples = bytes / sizeof(int16_t);
+    auto owed = m_gaps.owed(samples, captureNs);
+
+    if (owed) {
+        // at most a second per send so one long gap does not become one huge frame
+        static vector<char> silence;
+        auto chunkSamples = min<size_t>(owed, max<uint64_t>(m_gaps.samplesIn(1000000000), samples));
+        if (silence.size() < chunkSamples * sizeof(int16_t))
+            silence.resize(chunkSamples * sizeof(int16_t));
+
+        fills.inc();
+
+        // the silence ends where this frame begins
+        auto endNs = captureNs - min(captureNs, m_gaps.durationNs(samples));
+        auto startNs = endNs - min(endNs, m_gaps.durationNs(owed));
+
+        for (size_t done = 0; done < owed;) {
+            auto chunk = min(chunkSamples, owed - done);
+            auto chunkBytes = static_cast<unsigned int>(chunk * sizeof(int16_t));
+            auto chunkNs = startNs + m_gaps.durationNs(done + chunk);
+
+            if (!send(silence.data(), chunkBytes, chunkNs))
+                break;
+
+            done += chunk;
+            m_gaps.onSent(chunk);
+            filled.inc(chunk);
+            m_latency.onSent(chunkBytes, chunkNs);
+        }
+    }
+
+    if (!send(buffer, bytes, captureNs))
+        return false;
+
+    m_gaps.onSent(samples);
+    m_latency.onSent(bytes, captureNs);
+    timelineDrift().store(m_gaps.driftSeconds(), memory_order_relaxed);
+    return true;
+}
+
+bool ZoomSDKAudioRawDataDelegate::send(char* buffer, unsigned int bytes, uint64_t captureNs)
+{
+    if (m_hedge)
+        return m_hedge->send(buffer, bytes, captureNs);
+
+    return m_backend && m_backend->push(buffer, bytes);
 }
 
 void ZoomSDKAudioRawDataDelegate::onShareAudioRawDataReceived(AudioRawData* data)
 {
+    static LogRateLimit limit(std::chrono::seconds(5));
+    if (!Log::enabled(Log::DEBUG))
+        return;
+
     std::stringstream ss;
     ss << "Shared Audio Raw data: " << data->GetBufferLen() << "b at " << data->GetSampleRate() << "Hz";
-    Log::info(ss.str());
+    Log::throttled(limit, Log::DEBUG, ss.str());
 }
 
 void ZoomSDKAudioRawDataDelegate::writeToFile(const std::string& path, AudioRawData* data)
@@ -64,9 +219,13 @@ void ZoomSDKAudioRawDataDelegate::writeToFile(const std::string& path, AudioRawD
     file.close();
     file.flush();
 
+    static LogRateLimit limit(std::chrono::seconds(5));
+    if (!Log::enabled(Log::DEBUG))
+        return;
+
     std::stringstream ss;
     ss << "Writing " << data->GetBufferLen() << "b to " << path << " at " << data->GetSampleRate() << "Hz";
-    Log::info(ss.str());
+    Log::throttled(limit, Log::DEBUG, ss.str());
 }
 
 void ZoomSDKAudioRawDataDelegate::setDir(const std::string& dir)
@@ -78,3 +237,143 @@ void ZoomSDKAudioRawDataDelegate::setFilename(const std::string& filename)
 {
     m_filename = filename;
 }
+
+void ZoomSDKAudioRawDataDelegate::setOnResult(const std::function<void(DeepgramResults&)>& callback)
+{
+    m_onResult = [this, callback](DeepgramResults& results) {
+        tagQuality(results);
+        if (callback)
+            callback(results);
+    };
+
+    if (m_scheduler)
+        m_scheduler->setOnResult(m_onResult);
+}
+
+void ZoomSDKAudioRawDataDelegate::onBackendResult(DeepgramResults& results)
+{
+    m_latency.onResult(results);
+    results.captureNs = m_latency.captureTimeAt(results.start);
+    if (m_onResult)
+        m_onResult(results);
+}
+
+void ZoomSDKAudioRawDataDelegate::tagQuality(DeepgramResults& results)
+{
+    static auto& degraded = MetricsRegistry::getInstance().counter(
+            "zoomsdk_transcript_degraded_total", "Final transcript results whose audio showed quality issues");
+
+    if (!results.is_final || !results.captureNs)
+        return;
+
+    auto endNs = results.captureNs + static_cast<uint64_t>(max(0.0, results.duration) * 1e9);
+    results.audioIssues = m_quality.issues(results.node, results.captureNs, endNs);
+
+    if (results.audioIssues)
+        degraded.inc();
+}
+
+void ZoomSDKAudioRawDataDelegate::setSessions(size_t sessions)
+{
+    if (m_useMixedAudio || sessions == 0) {
+        m_scheduler.reset();
+        return;
+    }
+
+    SpeakerScheduler::Options options;
+    options.sessions = sessions;
+
+    m_scheduler = make_unique<SpeakerScheduler>(options);
+    m_scheduler->setBackend(m_backendOptions);
+    m_scheduler->setOnResult(m_onResult);
+}
+
+void ZoomSDKAudioRawDataDelegate::setMixdown(bool mixdown)
+{
+    if (m_useMixedAudio || !mixdown) {
+        m_mixer.reset();
+        return;
+    }
+
+    m_mixer = make_unique<AudioMixer>();
+    m_mixer->setOutput([this](const int16_t* samples, size_t count, uint64_t captureNs) {
+        auto bytes = static_cast<unsigned int>(count * sizeof(int16_t));
+        auto* buffer = const_cast<char*>(reinterpret_cast<const char*>(samples));
+
+        // the mix goes out as node 0, as the SDK's mixed stream would
+        if (m_shared)
+            m_shared->publish(0, m_mixer->sampleRate(), m_mixer->channels(), captureNs, buffer, bytes);
+
+        sendAligned(buffer, bytes, captureNs);
+    });
+}
+
+void ZoomSDKAudioRawDataDelegate::setHedge(const string& url, const string& apiKey, const string& model)
+{
+    auto second = m_backendOptions;
+    if (!url.empty())
+        second.url = url;
+    if (!apiKey.empty())
+        second.headers["Authorization"] = "Token " + apiKey;
+    if (!model.empty())
+        second.model = model;
+
+    m_hedge = make_unique<HedgedSession>(vector<TranscriptionBackend::Options>{m_backendOptions, second}, HedgedSession::Options());
+
+    // results arrive already on the stream's timeline
+    m_hedge->setOnResult([this](DeepgramResults& results) {
+        m_latency.onResult(results);
+        if (!results.captureNs)
+            results.captureNs = m_latency.captureTimeAt(results.start);
+        if (m_onResult)
+            m_onResult(results);
+    });
+}
+
+void ZoomSDKAudioRawDataDelegate::setGapThreshold(chrono::milliseconds threshold)
+{
+    GapFiller::Options options;
+    options.threshold = threshold;
+    m_gaps.setOptions(options);
+}
+
+bool ZoomSDKAudioRawDataDelegate::setSharedMemory(const string& socketPath)
+{
+    if (socketPath.empty()) {
+        m_shared.reset();
+        return true;
+    }
+
+    auto shared = make_unique<SharedAudioWriter>();
+    if (!shared->open() || !shared->listen(socketPath))
+        return false;
+
+    m_shared = std::move(shared);
+    return true;
+}
+
+double ZoomSDKAudioRawDataDelegate::streamTimeAt(uint64_t captureNs)
+{
+    return m_latency.streamTimeAt(captureNs);
+}
+
+void ZoomSDKAudioRawDataDelegate::drain()
+{
+    m_draining = true;
+
+    if (m_hedge)
+        m_hedge->closeStream();
+    else if (m_backend && m_backend->isOpen())
+        m_backend->closeStream();
+
+    if (m_scheduler)
+        m_scheduler->closeStream();
+}
+
+size_t ZoomSDKAudioRawDataDelegate::openStreams()
+{
+    size_t open = m_hedge ? m_hedge->open() : (m_backend && m_backend->isOpen());
+    if (m_scheduler)
+        open += m_scheduler->open();
+    return open;
+}
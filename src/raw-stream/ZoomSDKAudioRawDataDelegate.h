@@ -3,13 +3,21 @@
 #ifndef MEETING_SDK_LINUX_SAMPLE_ZOOMSDKAUDIORAWDATADELEGATE_H
 #define MEETING_SDK_LINUX_SAMPLE_ZOOMSDKAUDIORAWDATADELEGATE_H
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include "zoom_sdk_raw_data_def.h"
 #include "rawdata/rawdata_audio_helper_interface.h"
 #include "../util/Log.h"
-#include "DeepgramWSHelper.h" // Updated include
+#include "TranscriptionBackend.h"
+#include "LatencyTracker.h"
+#include "SpeakerScheduler.h"
+#include "AudioMixer.h"
+#include "SharedAudioRing.h"
+#include "AudioQuality.h"
+#include "GapFiller.h"
+#include "HedgedSession.h"
 
 using namespace std;
 using namespace ZOOMSDK;
@@ -19,20 +27,84 @@ class ZoomSDKAudioRawDataDelegate : public IZoomSDKAudioRawDataDelegate {
     string m_filename = "test.pcm";
     bool m_useMixedAudio;
     bool m_initialized;
-    string m_deepgramWebSocketURL;
-    string m_dgApiKey;
-    std::map<std::string, std::string> m_extraHeaders;
-    DeepgramWSHelper m_pocoHelper; // Updated class name
+    atomic<bool> m_draining{false};
+    TranscriptionBackend::Options m_backendOptions;
+    unique_ptr<TranscriptionBackend> m_backend;
+    LatencyTracker m_latency;
+    unique_ptr<SpeakerScheduler> m_scheduler;
+    unique_ptr<AudioMixer> m_mixer;
+    unique_ptr<SharedAudioWriter> m_shared;
+    unique_ptr<HedgedSession> m_hedge;
+    AudioQualityMonitor m_quality;
+    GapFiller m_gaps;
+    function<void(DeepgramResults&)> m_onResult;
     
     void writeToFile(const string& path, AudioRawData* data);
-    void initializePocoHelper(int sampleRate, int channels);
+    void openBackend(int sampleRate, int channels);
+    void onBackendResult(DeepgramResults& results);
+    void tagQuality(DeepgramResults& results);
+    bool sendAligned(char* buffer, unsigned int bytes, uint64_t captureNs);
+    bool send(char* buffer, unsigned int bytes, uint64_t captureNs);
 
 public:
     ZoomSDKAudioRawDataDelegate(bool useMixedAudio);
 
     void setDeepgramApiKey(const std::string& apiKey);
+
+    /**
+     * Choose the transcription engine and its endpoint, model and query parameters.
+     * Call before setSessions and setHedge, which copy it.
+     */
+    void setBackend(const TranscriptionBackend::Options& options);
     void setDir(const string& dir);
     void setFilename(const string& filename);
+    void setOnResult(const function<void(DeepgramResults&)>& callback);
+
+    /**
+     * Transcribe separate participant audio with this many shared sessions, 0 for none
+     */
+    void setSessions(size_t sessions);
+
+    /**
+     * Mix separate participant audio locally and transcribe the mix on the single session
+     */
+    void setMixdown(bool mixdown);
+
+    /**
+     * Send silence for audio missing from the transcribed stream once it falls this far behind capture time
+     * @param threshold 0 to never insert silence
+     */
+    void setGapThreshold(chrono::milliseconds threshold);
+
+    /**
+     * Send the transcribed stream to a second session as well and keep whichever result arrives first.
+     * Applies to the mixed stream and the local mixdown, not to per-participant sessions.
+     * @param url endpoint of the second session, empty for the primary one
+     * @param apiKey key for the second session, empty for the primary one
+     * @param model model for the second session, empty for the primary one
+     */
+    void setHedge(const string& url, const string& apiKey, const string& model);
+
+    /**
+     * Publish every frame to a shared memory ring for readers on this host
+     * @param socketPath unix socket readers connect to, empty to disable
+     */
+    bool setSharedMemory(const string& socketPath);
+
+    /**
+     * Stop sending audio and ask every transcription stream for its last results
+     */
+    void drain();
+
+    /**
+     * @return transcription streams still open
+     */
+    size_t openStreams();
+
+    /**
+     * @return position of a capture time in the transcribed stream in seconds, negative if unknown
+     */
+    double streamTimeAt(uint64_t captureNs);
 
     void onMixedAudioRawDataReceived(AudioRawData* data) override;
     void onOneWayAudioRawDataReceived(AudioRawData* data, uint32_t node_id) override;
@@ -1,55 +1,203 @@
 #include "ZoomSDKRendererDelegate.h"
 
+#include <algorithm>
+#include <cstdio>
+
+ZoomSDKRendererDelegate::ZoomSDKRendererDelegate()
+{
+    updatePath();
+}
+
 void ZoomSDKRendererDelegate::setDir(const string &dir)
 {
     m_dir = dir;
+    updatePath();
 }
 
 void ZoomSDKRendererDelegate::setFilename(const string &filename)
 {
     m_filename = filename;
+    updatePath();
 }
 
-void ZoomSDKRendererDelegate::onRawDataFrameReceived(YUVRawDataI420 *data)
+void ZoomSDKRendererDelegate::setFps(double fps)
+{
+    m_decimator.setFps(fps);
+}
+
+void ZoomSDKRendererDelegate::setSize(int width, int height)
 {
-    Log::info("OnRawDataFrameReceived");
+    m_width = width;
+    m_height = height;
+}
 
+void ZoomSDKRendererDelegate::setKeyframesOnly(bool keyframesOnly)
+{
+    m_keyframesOnly = keyframesOnly;
+}
+
+void ZoomSDKRendererDelegate::setStreamClock(const function<double(uint64_t)>& clock)
+{
+    m_clock = clock;
+}
+
+void ZoomSDKRendererDelegate::setOnSlideChange(const function<void(const SlideChange&)>& callback)
+{
+    m_onSlideChange = callback;
+}
+
+void ZoomSDKRendererDelegate::outputSize(int width, int height, int& outWidth, int& outHeight) const
+{
+    outWidth = width;
+    outHeight = height;
+
+    if (m_width <= 0 && m_height <= 0)
+        return;
+
+    if (m_width > 0 && m_height > 0) {
+        outWidth = m_width;
+        outHeight = m_height;
+    } else if (m_width > 0) {
+        outWidth = m_width;
+        outHeight = static_cast<int>(static_cast<int64_t>(height) * m_width / width);
+    } else {
+        outHeight = m_height;
+        outWidth = static_cast<int>(static_cast<int64_t>(width) * m_height / height);
+    }
+
+    // keep the chroma planes exactly half size
+    outWidth = max(2, min(outWidth, width) & ~1);
+    outHeight = max(2, min(outHeight, height) & ~1);
+}
+
+void ZoomSDKRendererDelegate::updatePath()
+{
     stringstream path;
     path << m_dir << "/" << m_filename;
 
-    writeToFile(path.str(), data);
+    if (path.str() == m_path)
+        return;
+
+    m_path = path.str();
+    m_writer.setPath(m_path);
+
+    // a new file starts with a keyframe and its own index
+    m_scenes.reset();
 }
 
-void ZoomSDKRendererDelegate::onRawDataStatusChanged(RawDataStatus status) {
-    cout << "onRawDataStatusChanged() " << status << endl;
+void ZoomSDKRendererDelegate::close()
+{
+    m_writer.close();
 }
 
-void ZoomSDKRendererDelegate::onRendererBeDestroyed() {
-    cout << "onRendererBeDestroyed() " << endl;
+string ZoomSDKRendererDelegate::indexLine(const SlideChange& slide, uint64_t firstNs, int width, int height)
+{
+    // one line per frame in the video file; "t" is on the transcript timeline when audio is transcribed
+    char line[256];
+    snprintf(line, sizeof(line), "{\"frame\":%llu,\"t\":%.3f,\"video_t\":%.3f,\"width\":%d,\"height\":%d,\"score\":%.3f}\n",
+             static_cast<unsigned long long>(slide.index), slide.streamSeconds,
+             (slide.changedNs - firstNs) / 1e9, width, height, slide.score);
+
+    return line;
 }
 
-void ZoomSDKRendererDelegate::writeToFile(const string &path, YUVRawDataI420 *data)
+void ZoomSDKRendererDelegate::onRawDataFrameReceived(YUVRawDataI420 *data)
 {
+    static LogRateLimit limit(std::chrono::seconds(5));
+    Log::throttled(limit, Log::DEBUG, "OnRawDataFrameReceived");
+
+    static auto& decimated = MetricsRegistry::getInstance().counter("zoomsdk_video_frames_decimated_total", "Raw video frames skipped to hold the target frame rate");
+    static auto& scaleTime = MetricsRegistry::getInstance().histogram("zoomsdk_video_scale_seconds", "Time to copy and downscale one raw video frame");
+
+    auto now = Metrics::now();
+    if (!m_decimator.accept(now)) {
+        decimated.inc();
+        return;
+    }
+
+    int width = static_cast<int>(data->GetStreamWidth());
+    int height = static_cast<int>(data->GetStreamHeight());
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+
+    // the SDK delivers tightly packed planes, so the stride is the stream width
+    auto y = reinterpret_cast<const uint8_t*>(data->GetYBuffer());
+    auto u = reinterpret_cast<const uint8_t*>(data->GetUBuffer());
+    auto v = reinterpret_cast<const uint8_t*>(data->GetVBuffer());
+
+    if (!m_firstNs)
+        m_firstNs = now;
+
+    SlideChange slide{};
+    if (m_keyframesOnly) {
+        static auto& detectTime = MetricsRegistry::getInstance().histogram("zoomsdk_video_scene_detect_seconds", "Time to compare one raw video frame against the last keyframe");
+        static auto& unchanged = MetricsRegistry::getInstance().counter("zoomsdk_video_frames_unchanged_total", "Raw video frames skipped because the picture did not change");
+
+        SceneDetector::Result result;
+        {
+            ScopedTimer timer(detectTime);
+            result = m_scenes.push(y, width, height, width, now);
+        }
 
-	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::app);
-	if (!file.is_open()) 
-        return Log::error("failed to open video output file: " + path);
-	
-	// Calculate the sizes for Y, U, and V components
-	size_t ySize = data->GetStreamWidth() * data->GetStreamHeight();
-	size_t uvSize = ySize / 4;
+        if (result != SceneDetector::KEYFRAME) {
+            unchanged.inc();
+            return;
+        }
 
-	// Write Y, U, and V components to the output file
-	file.write(data->GetYBuffer(), ySize);
-	file.write(data->GetUBuffer(), uvSize);
-	file.write(data->GetVBuffer(), uvSize);
+        slide.index = m_slides[m_path];
+        slide.changedNs = m_scenes.changedNs();
+        slide.streamSeconds = m_clock ? m_clock(slide.changedNs) : -1;
+        slide.score = m_scenes.score();
+    }
 
-    auto bytes = ySize + uvSize*2;
-    stringstream ss;
-    ss << "Writing " << bytes << "b to " << path;
+    // the renderer thread only copies into a pooled buffer; the writer thread owns the disk
+    auto frame = m_writer.acquire();
+    if (!frame) {
+        // try again on the next frame rather than lose the slide
+        if (m_keyframesOnly)
+            m_scenes.reset();
+        return;
+    }
 
-    Log::info(ss.str());
+    ScopedTimer timer(scaleTime);
 
-	file.close();
-	file.flush();
+    int outWidth, outHeight;
+    outputSize(width, height, outWidth, outHeight);
+
+    frame->resize(outWidth, outHeight);
+    frame->captureNs = now;
+
+    if (outWidth == width && outHeight == height) {
+        VideoFrameWriter::copyPlane(frame->y(), y, width, height, width);
+        VideoFrameWriter::copyPlane(frame->u(), u, chromaWidth, chromaHeight, chromaWidth);
+        VideoFrameWriter::copyPlane(frame->v(), v, chromaWidth, chromaHeight, chromaWidth);
+    } else {
+        VideoScaler::scale(y, width, height, width, frame->y(), outWidth, outHeight);
+        VideoScaler::scale(u, chromaWidth, chromaHeight, chromaWidth, frame->u(), outWidth / 2, outHeight / 2);
+        VideoScaler::scale(v, chromaWidth, chromaHeight, chromaWidth, frame->v(), outWidth / 2, outHeight / 2);
+    }
+
+    // the writer appends the index line next to the frame, so the disk stays off this thread
+    if (m_keyframesOnly)
+        frame->index = indexLine(slide, m_firstNs, outWidth, outHeight);
+
+    m_writer.submit(move(frame));
+
+    if (m_keyframesOnly) {
+        static auto& keyframes = MetricsRegistry::getInstance().counter("zoomsdk_video_keyframes_total", "Raw video frames kept because the picture changed");
+        keyframes.inc();
+
+        ++m_slides[m_path];
+
+        if (m_onSlideChange)
+            m_onSlideChange(slide);
+    }
+}
+
+void ZoomSDKRendererDelegate::onRawDataStatusChanged(RawDataStatus status) {
+    Log::info("onRawDataStatusChanged() " + to_string(status));
+}
+
+void ZoomSDKRendererDelegate::onRendererBeDestroyed() {
+    Log::info("onRendererBeDestroyed()");
 }
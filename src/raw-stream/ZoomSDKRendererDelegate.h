@@ -4,24 +4,95 @@
 
 #include <iostream>
 #include <fstream>
+#include <functional>
 #include <sstream>
+#include <unordered_map>
 #include "zoom_sdk_raw_data_def.h"
 #include "rawdata/rawdata_renderer_interface.h"
 
 #include "../util/Log.h"
+#include "VideoFrameWriter.h"
+#include "VideoScaler.h"
+#include "SceneDetector.h"
 
 using namespace std;
 using namespace ZOOMSDK;
 
 class ZoomSDKRendererDelegate : public IZoomSDKRendererDelegate {
+public:
+    /**
+     * A keyframe kept by the scene detector
+     */
+    struct SlideChange {
+        uint64_t index;
+        // capture time of the first frame that differed from the previous slide
+        uint64_t changedNs;
+        // position of changedNs in the transcribed audio, negative if unknown
+        double streamSeconds;
+        double score;
+    };
+
+private:
     string m_dir = "out";
     string m_filename = "test.yuv";
+    string m_path;
+
+    VideoFrameWriter m_writer;
+    FrameDecimator m_decimator;
+
+    int m_width = 0;
+    int m_height = 0;
+
+    bool m_keyframesOnly = false;
+    SceneDetector m_scenes;
+    unordered_map<string, uint64_t> m_slides;
+    uint64_t m_firstNs = 0;
+
+    function<double(uint64_t)> m_clock;
+    function<void(const SlideChange&)> m_onSlideChange;
+
+    void updatePath();
+    static string indexLine(const SlideChange& slide, uint64_t firstNs, int width, int height);
+
+    /**
+     * Size frames are written at for a given stream size, never larger than the stream
+     */
+    void outputSize(int width, int height, int& outWidth, int& outHeight) const;
+
 public:
-    void writeToFile(const string& path, YUVRawDataI420* data);
+    ZoomSDKRendererDelegate();
 
     void setDir(const string& dir);
     void setFilename(const string& filename);
 
+    /**
+     * @param fps maximum frame rate to write, 0 to keep every frame
+     */
+    void setFps(double fps);
+
+    /**
+     * Downscale frames before writing; a zero dimension follows the stream's aspect ratio
+     * @param width output width, 0 to derive it from height
+     * @param height output height, 0 to derive it from width
+     */
+    void setSize(int width, int height);
+
+    /**
+     * Only write frames where the picture changed, with an index of their times next to the video file
+     */
+    void setKeyframesOnly(bool keyframesOnly);
+
+    /**
+     * @param clock maps a capture time to seconds in the transcribed audio, negative if unknown
+     */
+    void setStreamClock(const function<double(uint64_t)>& clock);
+    void setOnSlideChange(const function<void(const SlideChange&)>& callback);
+
+    /**
+     * Flush queued frames to disk and stop the writer thread
+     */
+    void close();
+
     void onRawDataFrameReceived(YUVRawDataI420* data) override;
     void onRawDataStatusChanged(RawDataStatus status) override;
     void onRendererBeDestroyed() override;
@@ -0,0 +1,345 @@
+#include "Gateway.h"
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <unistd.h>
+
+#include "../Config.h"
+#include "../util/IoLoop.h"
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+
+namespace {
+    constexpr uint64_t c_retryNs = 2000000000;
+
+    struct GatewayMetrics {
+        Counter& frames;
+        Counter& lost;
+        Counter& dropped;
+        Gauge& attached;
+    };
+
+    GatewayMetrics& gatewayMetrics() {
+        static auto* metrics = []() {
+            auto& registry = MetricsRegistry::getInstance();
+            return new GatewayMetrics{
+                registry.counter("zoomsdk_gateway_frames_total", "Audio frames read from worker rings and sent for transcription"),
+                registry.counter("zoomsdk_gateway_lost_frames_total", "Frames a worker overwrote before the gateway read them"),
+                registry.counter("zoomsdk_gateway_dropped_frames_total", "Frames read while the meeting had no transcription stream"),
+                registry.gauge("zoomsdk_gateway_attached", "Worker rings the gateway is reading")
+            };
+        }();
+        return *metrics;
+    }
+}
+
+double Gateway::Stream::seconds() const {
+    return sampleRate && channels ? bytes / (2.0 * sampleRate * channels) : 0;
+}
+
+Gateway::Stream::~Stream() {
+    if (connector.joinable())
+        connector.join();
+    if (backend)
+        backend->close();
+}
+
+Gateway::Gateway(const Config& config)
+    : m_backend(TranscriptionBackend::fromConfig(config)),
+      m_keywordFile(config.keywordFile()),
+      m_transcriptLog(config.transcriptLog()),
+      m_captions(config.captions()) {
+    gatewayMetrics();
+}
+
+Gateway::~Gateway() {
+    IoLoop::getInstance().run([this]() {
+        for (auto& entry : m_meetings)
+            release(*entry.second);
+    });
+}
+
+string Gateway::pathFor(const string& path, const string& meetingId) {
+    if (path.empty())
+        return path;
+
+    auto slash = path.rfind('/');
+    auto dot = path.rfind('.');
+    if (dot == string::npos || dot == 0 || (slash != string::npos && dot < slash + 2))
+        return path + "-" + meetingId;
+
+    return path.substr(0, dot) + "-" + meetingId + path.substr(dot);
+}
+
+Gateway::Meeting* Gateway::find(const string& meetingId) {
+    auto it = m_meetings.find(meetingId);
+    return it == m_meetings.end() ? nullptr : it->second.get();
+}
+
+bool Gateway::add(const string& meetingId) {
+    auto meeting = make_unique<Meeting>();
+    meeting->id = meetingId;
+
+    if (!meeting->sinks.open(m_keywordFile, pathFor(m_transcriptLog, meetingId), pathFor(m_captions, meetingId), meetingId))
+        return false;
+
+    IoLoop::getInstance().run([&]() { m_meetings[meetingId] = std::move(meeting); });
+    return true;
+}
+
+bool Gateway::attach(const string& meetingId, const string& socketPath) {
+    bool attached = false;
+
+    IoLoop::getInstance().run([&]() {
+        auto* meeting = find(meetingId);
+        if (!meeting)
+            return;
+
+        release(*meeting);
+        retire(*meeting);
+
+        auto reader = make_unique<SharedAudioReader>();
+        if (!reader->connect(socketPath, true)) {
+            Log::error("gateway could not attach to meeting " + meetingId + " at " + socketPath);
+            return;
+        }
+
+        auto& loop = IoLoop::getInstance();
+        meeting->reader = std::move(reader);
+        meeting->lost = 0;
+        meeting->audioWatch = loop.watch(meeting->reader->eventFd(), G_IO_IN, [this, meeting](GIOCondition) {
+            onAudio(*meeting);
+            return true;
+        });
+
+        // the worker never writes to the socket, so readable means it has gone
+        meeting->hangupWatch = loop.watch(meeting->reader->socketFd(), G_IO_IN, [this, meeting](GIOCondition) {
+            Log::warn("worker for meeting " + meeting->id + " went away");
+            meeting->hangupWatch = 0;
+            release(*meeting);
+            retire(*meeting);
+            return false;
+        });
+
+        gatewayMetrics().attached.add(1);
+        Log::info("gateway transcribing meeting " + meetingId);
+        attached = true;
+    });
+
+    return attached;
+}
+
+void Gateway::detach(const string& meetingId) {
+    IoLoop::getInstance().run([&]() {
+        if (auto* meeting = find(meetingId)) {
+            release(*meeting);
+            retire(*meeting);
+        }
+    });
+}
+
+void Gateway::release(Meeting& meeting) {
+    if (!meeting.reader)
+        return;
+
+    auto& loop = IoLoop::getInstance();
+    loop.remove(meeting.audioWatch);
+    loop.remove(meeting.hangupWatch);
+    meeting.audioWatch = 0;
+    meeting.hangupWatch = 0;
+
+    meeting.reader->close();
+    meeting.reader.reset();
+    gatewayMetrics().attached.add(-1);
+}
+
+void Gateway::settle(Meeting& meeting) {
+    for (auto it = meeting.retired.begin(); it != meeting.retired.end();) {
+        auto& stream = **it;
+        if (stream.connecting) {
+            ++it;
+            continue;
+        }
+
+        // retired while it was still connecting
+        if (!stream.closed && stream.backend->isOpen()) {
+            stream.backend->closeStream();
+            stream.closed = true;
+        }
+
+        // done once it has delivered its last results
+        if (stream.backend->isOpen())
+            ++it;
+        else
+            it = meeting.retired.erase(it);
+    }
+}
+
+void Gateway::retire(Meeting& meeting) {
+    if (meeting.stream) {
+        meeting.transcribed = meeting.stream->offset + meeting.stream->seconds();
+        meeting.retired.push_back(std::move(meeting.stream));
+    }
+
+    settle(meeting);
+}
+
+void Gateway::startStream(Meeting& meeting, int sampleRate, int channels) {
+    retire(meeting);
+
+    auto stream = make_unique<Stream>();
+    stream->backend = TranscriptionBackend::create(m_backend);
+    if (!stream->backend) {
+        meeting.retryNs = Metrics::now() + c_retryNs;
+        return;
+    }
+
+    stream->sampleRate = sampleRate;
+    stream->channels = channels;
+    stream->offset = meeting.transcribed;
+    stream->latency.setFormat(sampleRate, channels);
+
+    auto* meetingPtr = &meeting;
+    auto* streamPtr = stream.get();
+    stream->backend->setOnResult([this, meetingPtr, streamPtr](DeepgramResults& results) {
+        onResult(*meetingPtr, *streamPtr, results);
+    });
+
+    // connecting blocks, so it runs beside the loop; frames wait in the worker's ring meanwhile
+    stream->connecting = true;
+    stream->connector = Thread("gateway-connect", [streamPtr]() {
+        streamPtr->backend->open(streamPtr->sampleRate, streamPtr->channels);
+        streamPtr->connecting = false;
+    });
+
+    meeting.stream = std::move(stream);
+}
+
+void Gateway::onAudio(Meeting& meeting) {
+    auto& metrics = gatewayMetrics();
+
+    uint64_t count;
+    (void) !read(meeting.reader->eventFd(), &count, sizeof(count));
+
+    // leave frames in the ring until the stream can take them
+    if (meeting.stream && meeting.stream->connecting)
+        return;
+
+    if (meeting.stream && !meeting.stream->backend->isOpen()) {
+        Log::warn("transcription stream for meeting " + meeting.id + " is not open, retrying");
+        retire(meeting);
+        meeting.retryNs = Metrics::now() + c_retryNs;
+    }
+
+    SharedAudioReader::Frame frame{};
+    while (meeting.reader->next(frame)) {
+        if (frame.node != 0)
+            continue;
+
+        if (!meeting.stream || meeting.stream->sampleRate != static_cast<int>(frame.sampleRate) ||
+            meeting.stream->channels != frame.channels) {
+            if (Metrics::now() < meeting.retryNs) {
+                metrics.dropped.inc();
+                continue;
+            }
+
+            startStream(meeting, static_cast<int>(frame.sampleRate), frame.channels);
+            if (meeting.stream) {
+                // this frame is read again once the stream has connected
+                meeting.reader->rewind(frame.seq);
+                break;
+            }
+            metrics.dropped.inc();
+            continue;
+        }
+
+        // copy out first, the worker may lap the ring while the frame is being sent
+        m_frame.assign(frame.data, frame.data + frame.len);
+        if (!meeting.reader->valid(frame)) {
+            metrics.lost.inc();
+            continue;
+        }
+
+        auto& stream = *meeting.stream;
+        if (stream.backend->push(m_frame.data(), m_frame.size())) {
+            stream.latency.onSent(m_frame.size(), frame.captureNs);
+            stream.bytes += m_frame.size();
+            metrics.frames.inc();
+        }
+    }
+
+    metrics.lost.inc(meeting.reader->lost() - meeting.lost);
+    meeting.lost = meeting.reader->lost();
+}
+
+void Gateway::onResult(Meeting& meeting, Stream& stream, DeepgramResults& results) {
+    stream.latency.onResult(results);
+    results.captureNs = stream.latency.captureTimeAt(results.start);
+
+    // move the result after what earlier workers' streams transcribed
+    if (stream.offset > 0) {
+        results.start += stream.offset;
+        for (auto& alternative : results.channel.alternatives) {
+            for (auto& word : alternative.words) {
+                word.start += stream.offset;
+                word.end += stream.offset;
+            }
+        }
+    }
+
+    lock_guard<mutex> lock(meeting.lock);
+    meeting.sinks.onResult(results);
+}
+
+size_t Gateway::openStreams() {
+    size_t open = 0;
+
+    IoLoop::getInstance().run([&]() {
+        for (auto& entry : m_meetings) {
+            auto& meeting = *entry.second;
+            if (meeting.stream && meeting.stream->backend->isOpen())
+                ++open;
+
+            settle(meeting);
+            for (auto& stream : meeting.retired)
+                if (stream->connecting || stream->backend->isOpen())
+                    ++open;
+        }
+    });
+
+    return open;
+}
+
+void Gateway::drain(chrono::milliseconds timeout) {
+    IoLoop::getInstance().run([this]() {
+        for (auto& entry : m_meetings) {
+            release(*entry.second);
+            retire(*entry.second);
+        }
+    });
+
+    auto deadline = chrono::steady_clock::now() + timeout;
+    size_t open;
+    while ((open = openStreams()) && chrono::steady_clock::now() < deadline)
+        this_thread::sleep_for(chrono::milliseconds(10));
+
+    if (open)
+        Log::warn(to_string(open) + " gateway streams still open at the drain deadline");
+
+    // a stream still connecting joins its connector when destroyed, so that happens here rather than on the loop
+    vector<unique_ptr<Stream>> leftover;
+    IoLoop::getInstance().run([&]() {
+        for (auto& entry : m_meetings) {
+            auto& retired = entry.second->retired;
+            move(retired.begin(), retired.end(), back_inserter(leftover));
+            retired.clear();
+        }
+    });
+    leftover.clear();
+
+    for (auto& entry : m_meetings) {
+        lock_guard<mutex> lock(entry.second->lock);
+        entry.second->sinks.close();
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_GATEWAY_H
+#define MEETING_SDK_LINUX_SAMPLE_GATEWAY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../raw-stream/LatencyTracker.h"
+#include "../raw-stream/SharedAudioRing.h"
+#include "../raw-stream/TranscriptionBackend.h"
+#include "../transcript/TranscriptSinks.h"
+#include "../util/Threads.h"
+
+using namespace std;
+
+class Config;
+
+/**
+ * Transcribes the audio worker processes share over their shared memory
+ * rings, one transcription stream and one set of transcript sinks per
+ * meeting, so workers need neither.
+ *
+ * Rings are read on the IoLoop thread whenever their eventfd fires, and
+ * node 0, the mixed stream, is sent on. When a worker goes away its stream
+ * is closed and left to deliver its last results. The meeting keeps its
+ * sinks, and the next worker's stream is placed after the audio already
+ * transcribed, so a restart only leaves a gap in the transcript.
+ *
+ * The loop thread serves every meeting, so nothing here waits on it:
+ * control frames finish through the socket's write watch, and streams
+ * still connecting at drain are joined on the caller's thread.
+ */
+class Gateway {
+
+    struct Stream {
+        unique_ptr<TranscriptionBackend> backend;
+        LatencyTracker latency;
+        int sampleRate = 0;
+        int channels = 0;
+        uint64_t bytes = 0;
+        // seconds transcribed by earlier streams of the meeting
+        double offset = 0;
+
+        // connecting blocks, so it runs on a thread of its own
+        Thread connector;
+        atomic<bool> connecting{false};
+        bool closed = false;
+
+        ~Stream();
+        double seconds() const;
+    };
+
+    struct Meeting {
+        string id;
+
+        // guards the sinks against results from engines with threads of their own
+        mutex lock;
+        TranscriptSinks sinks;
+
+        // only touched on the IoLoop thread
+        unique_ptr<SharedAudioReader> reader;
+        unsigned audioWatch = 0;
+        unsigned hangupWatch = 0;
+        uint64_t lost = 0;
+        unique_ptr<Stream> stream;
+        vector<unique_ptr<Stream>> retired;
+        double transcribed = 0;
+        uint64_t retryNs = 0;
+    };
+
+    TranscriptionBackend::Options m_backend;
+    string m_keywordFile;
+    string m_transcriptLog;
+    string m_captions;
+
+    map<string, unique_ptr<Meeting>> m_meetings;
+    vector<char> m_frame;
+
+    Meeting* find(const string& meetingId);
+    void onAudio(Meeting& meeting);
+    void startStream(Meeting& meeting, int sampleRate, int channels);
+    void retire(Meeting& meeting);
+    void settle(Meeting& meeting);
+    void release(Meeting& meeting);
+    void onResult(Meeting& meeting, Stream& stream, DeepgramResults& results);
+
+public:
+    explicit Gateway(const Config& config);
+    ~Gateway();
+
+    /**
+     * Open the meeting's sinks, named after the configured ones with the meeting ID added
+     */
+    bool add(const string& meetingId);
+
+    /**
+     * Start reading a worker's ring, replacing any earlier worker of the meeting
+     * @param socketPath unix socket the worker shares its ring on
+     */
+    bool attach(const string& meetingId, const string& socketPath);
+
+    /**
+     * Stop reading the meeting's ring and ask its stream for the last results
+     */
+    void detach(const string& meetingId);
+
+    /**
+     * Detach every meeting, wait up to the timeout for the last results, then close the sinks
+     */
+    void drain(chrono::milliseconds timeout);
+
+    /**
+     * @return transcription streams still open, including those still delivering their last results
+     */
+    size_t openStreams();
+
+    /**
+     * @param path a sink path from the config
+     * @return the path with "-<meeting ID>" before its extension, empty if the path is
+     */
+    static string pathFor(const string& path, const string& meetingId);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_GATEWAY_H
@@ -0,0 +1,485 @@
+#include "Supervisor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <glib-unix.h>
+
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+#include "../util/ProcessStats.h"
+#include "../util/Trace.h"
+
+namespace {
+    // a worker that exits sooner than this after starting waits before it is started again
+    constexpr uint64_t c_stableNs = 10000000000ull;
+    constexpr unsigned c_maxBackoffSeconds = 64;
+
+    // workers find the supervisor's socket here
+    constexpr int c_workerFd = 3;
+
+    Counter& restarts() {
+        static auto& counter = MetricsRegistry::getInstance().counter(
+                "zoomsdk_supervisor_restarts_total", "Meetings handed to another worker after theirs exited");
+        return counter;
+    }
+
+    string trim(const string& s) {
+        auto first = s.find_first_not_of(" \t\r\n");
+        if (first == string::npos)
+            return "";
+        return s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+    }
+
+    string describe(int status) {
+        if (WIFSIGNALED(status))
+            return string("was killed by ") + strsignal(WTERMSIG(status));
+        return "exited with status " + to_string(WEXITSTATUS(status));
+    }
+
+    // only async-signal-safe calls, it runs between fork and exec
+    void closeFrom(int first, long maxFd) {
+#ifdef SYS_close_range
+        if (syscall(SYS_close_range, first, ~0U, 0) == 0)
+            return;
+#endif
+        for (long fd = first; fd < maxFd; ++fd)
+            close(static_cast<int>(fd));
+    }
+}
+
+SDKError Supervisor::start(const Config& config, int argc, char** argv) {
+    if (!load(config.meetings()))
+        return SDKERR_INVALID_PARAMETER;
+
+    for (int i = 1; i < argc; ++i)
+        m_args.emplace_back(argv[i]);
+    m_drainTimeout = config.drainTimeout();
+
+    char dir[] = "/tmp/zoomsdk-XXXXXX";
+    if (!mkdtemp(dir)) {
+        Log::error("unable to create the worker socket directory: " + string(strerror(errno)));
+        return SDKERR_INTERNAL_ERROR;
+    }
+    m_runDir = dir;
+
+    if (config.useRawAudio()) {
+        if (config.separateParticipantAudio() && config.sessions())
+            Log::warn("workers mix separate participants down for the gateway; --sessions is not used");
+
+        m_gateway = make_unique<Gateway>(config);
+        for (const auto& meeting : m_meetings)
+            if (!m_gateway->add(meeting.id))
+                return SDKERR_INVALID_PARAMETER;
+    }
+
+    if (config.metricsPort()) {
+        auto& registry = MetricsRegistry::getInstance();
+        for (auto state : {STARTING, READY, BUSY}) {
+            const char* name = state == STARTING ? "starting" : state == READY ? "ready" : "busy";
+            registry.gauge("zoomsdk_supervisor_workers", "Worker processes by state",
+                           [this, state]() { return static_cast<double>(count(state)); }, string("state=\"") + name + "\"");
+        }
+        registry.gauge("zoomsdk_log_dropped", "Log messages dropped because a thread's ring was full",
+                       []() { return static_cast<double>(Log::dropped()); });
+        restarts();
+        ProcessStats::expose();
+
+        if (config.trace()) {
+            Trace::enable();
+            m_metricsServer.addRoute("/trace", "application/json", []() { return Trace::dump(); });
+        }
+
+        if (!m_metricsServer.start(config.metricsPort()))
+            return SDKERR_INVALID_PARAMETER;
+    }
+
+    auto workers = config.workers() ? config.workers() : m_meetings.size();
+    for (size_t i = 0; i < workers; ++i) {
+        auto worker = make_unique<Worker>();
+        worker->index = i;
+        worker->socket = m_runDir + "/worker-" + to_string(i) + ".sock";
+        if (!spawn(*worker))
+            return SDKERR_INTERNAL_ERROR;
+        m_workers.push_back(std::move(worker));
+    }
+
+    Log::info("supervising " + to_string(m_meetings.size()) + " meetings with " + to_string(workers) + " workers");
+    return SDKERR_SUCCESS;
+}
+
+bool Supervisor::load(const string& path) {
+    ifstream in(path);
+    if (!in.is_open()) {
+        Log::error("unable to open meeting list " + path);
+        return false;
+    }
+
+    string line;
+    for (size_t number = 1; getline(in, line); ++number) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        Meeting meeting;
+        istringstream fields(line);
+        string first;
+        fields >> first;
+
+        if (first.find("://") != string::npos) {
+            Config url;
+            if (!url.parseUrl(first)) {
+                Log::error(path + ":" + to_string(number) + ": unable to parse join URL");
+                return false;
+            }
+            meeting.id = url.meetingId();
+            meeting.password = url.password();
+        } else {
+            meeting.id = first;
+            fields >> meeting.password;
+        }
+
+        string rest;
+        getline(fields, rest);
+        meeting.displayName = trim(rest);
+
+        if (meeting.id.empty() || meeting.password.empty()) {
+            Log::error(path + ":" + to_string(number) + ": expected <meeting-id> <password> [display name] or a join URL");
+            return false;
+        }
+
+        // the ID names the meeting's output files and directory, which no two workers may share
+        if (meeting.id.find('/') != string::npos || meeting.id == "." || meeting.id == "..") {
+            Log::error(path + ":" + to_string(number) + ": meeting ID " + meeting.id + " is not usable in a file name");
+            return false;
+        }
+
+        auto same = [&](const Meeting& other) { return other.id == meeting.id; };
+        if (any_of(m_meetings.begin(), m_meetings.end(), same)) {
+            Log::error(path + ":" + to_string(number) + ": meeting " + meeting.id + " is listed twice");
+            return false;
+        }
+
+        m_meetings.push_back(meeting);
+    }
+
+    if (m_meetings.empty()) {
+        Log::error("no meetings in " + path);
+        return false;
+    }
+
+    return true;
+}
+
+bool Supervisor::spawn(Worker& worker) {
+    static auto& spawns = MetricsRegistry::getInstance().counter("zoomsdk_supervisor_spawns_total", "Worker processes started");
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+        Log::error("unable to create a worker socket: " + string(strerror(errno)));
+        return false;
+    }
+
+    // everything the child needs is built before fork, it may only make async-signal-safe calls
+    vector<string> args = {"zoomsdk", "--worker-fd", to_string(c_workerFd), "--worker-socket", worker.socket};
+    args.insert(args.end(), m_args.begin(), m_args.end());
+
+    vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    auto parent = getpid();
+    auto maxFd = sysconf(_SC_OPEN_MAX);
+
+    // signals stay blocked until the child has put back the default handlers
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+
+    auto pid = fork();
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != parent)
+            _exit(EXIT_FAILURE);
+
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &previous, nullptr);
+
+        if (fds[1] == c_workerFd)
+            fcntl(c_workerFd, F_SETFD, 0);
+        else if (dup2(fds[1], c_workerFd) < 0)
+            _exit(127);
+        closeFrom(c_workerFd + 1, maxFd);
+
+        execv("/proc/self/exe", argv.data());
+        _exit(127);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    close(fds[1]);
+
+    if (pid < 0) {
+        Log::error("unable to start a worker: " + string(strerror(errno)));
+        close(fds[0]);
+        return false;
+    }
+
+    worker.pid = pid;
+    worker.control = fds[0];
+    worker.state = STARTING;
+    worker.startedNs = Metrics::now();
+    worker.controlSource = g_unix_fd_add(worker.control, static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR), onControl, &worker);
+    worker.childSource = g_child_watch_add(pid, onChild, &worker);
+
+    spawns.inc();
+    Log::info("started worker " + to_string(worker.index) + " as pid " + to_string(pid));
+    return true;
+}
+
+gboolean Supervisor::onControl(gint fd, GIOCondition condition, gpointer data) {
+    auto* worker = static_cast<Worker*>(data);
+
+    char buf[512];
+    auto n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n < 0 && errno == EAGAIN)
+        return G_SOURCE_CONTINUE;
+
+    // the worker is gone; its exit is handled by the child watch
+    if (n <= 0) {
+        worker->controlSource = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    getInstance().onMessage(*worker, string(buf, static_cast<size_t>(n)));
+    return G_SOURCE_CONTINUE;
+}
+
+void Supervisor::onMessage(Worker& worker, const string& message) {
+    if (message == "ready") {
+        worker.state = READY;
+        assign();
+        return;
+    }
+
+    if (worker.meeting < 0) {
+        Log::warn("unexpected message from idle worker " + to_string(worker.index) + ": " + message);
+        return;
+    }
+
+    auto& meeting = m_meetings[static_cast<size_t>(worker.meeting)];
+
+    if (message == "recording") {
+        if (m_gateway)
+            m_gateway->attach(meeting.id, worker.socket);
+    } else if (message == "ended") {
+        Log::info("meeting " + meeting.id + " has ended");
+        meeting.ended = true;
+        if (m_gateway)
+            m_gateway->detach(meeting.id);
+    } else {
+        Log::warn("unexpected message from worker " + to_string(worker.index) + ": " + message);
+    }
+}
+
+void Supervisor::assign() {
+    if (m_draining)
+        return;
+
+    for (size_t i = 0; i < m_meetings.size(); ++i) {
+        auto& meeting = m_meetings[i];
+        if (meeting.ended || meeting.worker >= 0)
+            continue;
+
+        auto it = find_if(m_workers.begin(), m_workers.end(), [](const unique_ptr<Worker>& w) { return w->state == READY; });
+        if (it == m_workers.end())
+            return;
+
+        auto& worker = **it;
+        auto message = "join\t" + meeting.id + "\t" + meeting.password + "\t" + meeting.displayName;
+        if (send(worker.control, message.data(), message.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(message.size())) {
+            // it is on its way out; the child watch takes it from here
+            worker.state = STOPPED;
+            continue;
+        }
+
+        worker.state = BUSY;
+        worker.meeting = static_cast<int>(i);
+        meeting.worker = static_cast<int>(worker.index);
+        Log::info("meeting " + meeting.id + " assigned to worker " + to_string(worker.index));
+    }
+}
+
+void Supervisor::onChild(GPid pid, gint status, gpointer data) {
+    auto* worker = static_cast<Worker*>(data);
+    g_spawn_close_pid(pid);
+
+    worker->childSource = 0;
+    getInstance().onExit(*worker, status);
+}
+
+void Supervisor::onExit(Worker& worker, int status) {
+    if (worker.controlSource) {
+        g_source_remove(worker.controlSource);
+        worker.controlSource = 0;
+    }
+    close(worker.control);
+    worker.control = -1;
+    worker.pid = -1;
+    worker.state = STOPPED;
+
+    if (worker.meeting >= 0) {
+        auto& meeting = m_meetings[static_cast<size_t>(worker.meeting)];
+        meeting.worker = -1;
+        worker.meeting = -1;
+
+        if (!meeting.ended) {
+            Log::warn("worker " + to_string(worker.index) + " for meeting " + meeting.id + " " + describe(status) +
+                      ", handing the meeting to another worker");
+            restarts().inc();
+            if (m_gateway)
+                m_gateway->detach(meeting.id);
+        }
+    } else {
+        Log::warn("idle worker " + to_string(worker.index) + " " + describe(status));
+    }
+
+    finishIfDone();
+    if (m_draining)
+        return;
+
+    // a slot that keeps failing straight away waits longer each time
+    bool quick = Metrics::now() - worker.startedNs < c_stableNs;
+    worker.failures = quick ? worker.failures + 1 : 0;
+
+    if (worker.failures) {
+        auto delay = min(c_maxBackoffSeconds, 1u << min(worker.failures, 6u));
+        Log::warn("starting worker " + to_string(worker.index) + " again in " + to_string(delay) + "s");
+        worker.retrySource = g_timeout_add_seconds(delay, onRetry, &worker);
+    } else {
+        spawn(worker);
+    }
+
+    // a spare that is already initialized takes over now
+    assign();
+}
+
+gboolean Supervisor::onRetry(gpointer data) {
+    auto* worker = static_cast<Worker*>(data);
+    worker->retrySource = 0;
+
+    if (!getInstance().m_draining)
+        getInstance().spawn(*worker);
+
+    return G_SOURCE_REMOVE;
+}
+
+void Supervisor::finishIfDone() {
+    if (m_draining)
+        return;
+
+    for (const auto& meeting : m_meetings)
+        if (!meeting.ended)
+            return;
+
+    Log::info("every meeting has ended");
+    drain();
+
+    if (m_onFinished)
+        m_onFinished();
+}
+
+size_t Supervisor::count(State state) const {
+    return static_cast<size_t>(count_if(m_workers.begin(), m_workers.end(),
+                                        [state](const unique_ptr<Worker>& w) { return w->state == state; }));
+}
+
+void Supervisor::setOnFinished(const function<void()>& callback) {
+    m_onFinished = callback;
+}
+
+void Supervisor::drain() {
+    if (m_draining)
+        return;
+    m_draining = true;
+
+    auto start = Metrics::now();
+
+    // workers drain themselves on SIGTERM and leave their meetings
+    for (auto& worker : m_workers) {
+        for (auto* source : {&worker->controlSource, &worker->childSource, &worker->retrySource}) {
+            if (*source) {
+                g_source_remove(*source);
+                *source = 0;
+            }
+        }
+
+        if (worker->pid > 0)
+            kill(worker->pid, SIGTERM);
+    }
+
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(m_drainTimeout);
+    while (true) {
+        size_t running = 0;
+        for (auto& worker : m_workers) {
+            if (worker->pid <= 0)
+                continue;
+
+            int status;
+            if (waitpid(worker->pid, &status, WNOHANG) == worker->pid) {
+                close(worker->control);
+                worker->control = -1;
+                worker->pid = -1;
+                worker->state = STOPPED;
+            } else {
+                ++running;
+            }
+        }
+
+        if (!running)
+            break;
+
+        if (chrono::steady_clock::now() >= deadline) {
+            Log::warn(to_string(running) + " workers still running at the drain deadline, killing them");
+            for (auto& worker : m_workers) {
+                if (worker->pid > 0) {
+                    kill(worker->pid, SIGKILL);
+                    waitpid(worker->pid, nullptr, 0);
+                    close(worker->control);
+                    worker->pid = -1;
+                    worker->state = STOPPED;
+                }
+            }
+            break;
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    if (m_gateway)
+        m_gateway->drain(chrono::milliseconds(m_drainTimeout));
+
+    m_metricsServer.stop();
+
+    for (auto& worker : m_workers)
+        unlink(worker->socket.c_str());
+    if (!m_runDir.empty())
+        rmdir(m_runDir.c_str());
+
+    Log::info("supervisor drained in " + to_string((Metrics::now() - start) / 1000000) + "ms");
+    Log::flush();
+}
@@ -0,0 +1,117 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_SUPERVISOR_H
+#define MEETING_SDK_LINUX_SAMPLE_SUPERVISOR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include <glib.h>
+
+#include "zoom_sdk.h"
+
+#include "Gateway.h"
+#include "../Config.h"
+#include "../util/MetricsServer.h"
+#include "../util/Singleton.h"
+
+using namespace std;
+using namespace ZOOMSDK;
+
+/**
+ * Runs several meetings from one host: one worker process per meeting,
+ * each running the usual Zoom flow, and a Gateway in this process that
+ * transcribes them all.
+ *
+ * The SDK allows one meeting per process, so workers are this binary
+ * started again with --worker-fd. They initialize the SDK before they are
+ * given a meeting, so a spare worker can take over a crashed one's meeting
+ * without waiting for init. Workers talk to the supervisor over a
+ * socketpair, one message per packet:
+ *
+ *   worker      ready               SDK initialized, waiting for a meeting
+ *   supervisor  join\t<id>\t<pwd>\t<name>
+ *   worker      recording           audio ring listening on --worker-socket
+ *   worker      ended               the meeting is over, do not restart it
+ *
+ * A worker that exits without "ended" has its meeting handed to the next
+ * ready worker, and its slot is started again, after a growing delay if it
+ * keeps failing quickly. Other meetings carry on untouched.
+ */
+class Supervisor : public Singleton<Supervisor> {
+
+    friend class Singleton<Supervisor>;
+
+    enum State { STOPPED, STARTING, READY, BUSY };
+
+    struct Worker {
+        size_t index = 0;
+        pid_t pid = -1;
+        int control = -1;
+        guint controlSource = 0;
+        guint childSource = 0;
+        guint retrySource = 0;
+        // also read by the metrics thread
+        atomic<State> state{STOPPED};
+        int meeting = -1;
+        uint64_t startedNs = 0;
+        unsigned failures = 0;
+        string socket;
+    };
+
+    struct Meeting {
+        string id;
+        string password;
+        string displayName;
+        int worker = -1;
+        bool ended = false;
+    };
+
+    vector<string> m_args;
+    string m_runDir;
+    unsigned int m_drainTimeout = 0;
+
+    vector<unique_ptr<Worker>> m_workers;
+    vector<Meeting> m_meetings;
+
+    unique_ptr<Gateway> m_gateway;
+    MetricsServer m_metricsServer;
+
+    bool m_draining = false;
+    function<void()> m_onFinished;
+
+    Supervisor() = default;
+
+    bool load(const string& path);
+    bool spawn(Worker& worker);
+    void assign();
+    void onMessage(Worker& worker, const string& message);
+    void onExit(Worker& worker, int status);
+    void finishIfDone();
+    size_t count(State state) const;
+
+    static gboolean onControl(gint fd, GIOCondition condition, gpointer data);
+    static void onChild(GPid pid, gint status, gpointer data);
+    static gboolean onRetry(gpointer data);
+
+public:
+    /**
+     * Read the meeting list, start the gateway and metrics, and start the workers
+     * @param argc, argv this process's arguments, passed on to every worker
+     */
+    SDKError start(const Config& config, int argc, char** argv);
+
+    /**
+     * Called once every meeting has ended and the gateway has drained
+     */
+    void setOnFinished(const function<void()>& callback);
+
+    /**
+     * Stop the workers, wait up to the drain timeout for each, then drain the gateway
+     */
+    void drain();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_SUPERVISOR_H
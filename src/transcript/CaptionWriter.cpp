@@ -0,0 +1,236 @@
+#include "CaptionWriter.h"
+
+#include <algorithm>
+
+#include "TranscriptExport.h"
+#include "../util/Log.h"
+
+namespace {
+    bool endsSentence(const string& text) {
+        if (text.empty()) return false;
+        auto c = text.back();
+        return c == '.' || c == '?' || c == '!';
+    }
+
+    bool endsClause(const string& text) {
+        if (text.empty()) return false;
+        auto c = text.back();
+        return endsSentence(text) || c == ',' || c == ';' || c == ':';
+    }
+
+    vector<string> wrap(const vector<CaptionWord>& words, size_t maxChars) {
+        vector<string> lines(1);
+        for (const auto& word : words) {
+            auto& line = lines.back();
+            if (!line.empty() && line.size() + 1 + word.text.size() > maxChars) {
+                lines.emplace_back(word.text);
+                continue;
+            }
+            if (!line.empty()) line.push_back(' ');
+            line += word.text;
+        }
+        return lines;
+    }
+}
+
+/*
+ * Segmenter
+ */
+
+CaptionSegmenter::CaptionSegmenter() : CaptionSegmenter(Options()) {}
+
+CaptionSegmenter::CaptionSegmenter(const Options& options) : m_options(options) {}
+
+void CaptionSegmenter::setOnCue(const function<void(const Cue&)>& callback) {
+    m_onCue = callback;
+}
+
+void CaptionSegmenter::push(const CaptionWord& word) {
+    if (word.text.empty())
+        return;
+
+    if (!m_pending.empty()) {
+        const auto& first = m_pending.front();
+        const auto& last = m_pending.back();
+        auto budget = m_options.maxLineChars * m_options.maxLines;
+
+        bool close = word.speaker != first.speaker
+                  || word.startMs > last.endMs + m_options.pauseMs
+                  || word.endMs > first.startMs + m_options.maxCueMs
+                  || (endsSentence(last.text) && m_pendingChars * 10 >= budget * 6);
+
+        if (!close && m_pendingChars + 1 + word.text.size() > m_options.maxLineChars) {
+            m_pending.push_back(word);
+            close = wrap(m_pending, m_options.maxLineChars).size() > m_options.maxLines;
+            m_pending.pop_back();
+        }
+
+        if (close)
+            emit(word.startMs);
+    }
+
+    m_pendingChars += (m_pending.empty() ? 0 : 1) + word.text.size();
+    m_pending.push_back(word);
+}
+
+void CaptionSegmenter::advance(uint64_t settledMs, uint64_t nowMs) {
+    m_settled = max(m_settled, settledMs);
+
+    if (!m_pending.empty() && nowMs >= m_pending.back().endMs + m_options.maxLagMs)
+        emit(max(m_settled, m_pending.back().endMs));
+}
+
+void CaptionSegmenter::finish() {
+    if (!m_pending.empty())
+        emit(0);
+}
+
+vector<string> CaptionSegmenter::breakLines() const {
+    auto lines = wrap(m_pending, m_options.maxLineChars);
+    if (lines.size() != 2)
+        return lines;
+
+    // balance two lines, preferring to break after punctuation
+    size_t total = m_pendingChars;
+    size_t left = 0;
+    size_t bestSplit = 0;
+    long bestCost = -1;
+
+    for (size_t i = 0; i + 1 < m_pending.size(); ++i) {
+        left += (i ? 1 : 0) + m_pending[i].text.size();
+        auto right = total - left - 1;
+        if (left > m_options.maxLineChars || right > m_options.maxLineChars)
+            continue;
+
+        long cost = static_cast<long>(max(left, right)) - (endsClause(m_pending[i].text) ? 6 : 0);
+        if (bestCost < 0 || cost < bestCost) {
+            bestCost = cost;
+            bestSplit = i + 1;
+        }
+    }
+
+    if (bestCost < 0)
+        return lines;
+
+    vector<string> balanced(2);
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        auto& line = balanced[i < bestSplit ? 0 : 1];
+        if (!line.empty()) line.push_back(' ');
+        line += m_pending[i].text;
+    }
+
+    return balanced;
+}
+
+void CaptionSegmenter::emit(uint64_t nextStartMs) {
+    const auto& first = m_pending.front();
+    const auto& last = m_pending.back();
+
+    Cue cue;
+    cue.speaker = first.speaker;
+    cue.lines = breakLines();
+    cue.startMs = max(first.startMs, m_lastEnd ? m_lastEnd + m_options.minGapMs : 0);
+
+    // give slow readers time, but never run into the next cue
+    auto readingMs = static_cast<uint64_t>(m_pendingChars * 1000 / m_options.maxCharsPerSecond);
+    auto endMs = max({last.endMs, cue.startMs + m_options.minCueMs, cue.startMs + readingMs});
+
+    if (nextStartMs > m_options.minGapMs)
+        endMs = min(endMs, nextStartMs - m_options.minGapMs);
+
+    cue.endMs = max({endMs, last.endMs, cue.startMs + 1});
+    m_lastEnd = cue.endMs;
+
+    m_pending.clear();
+    m_pendingChars = 0;
+
+    if (m_onCue)
+        m_onCue(cue);
+}
+
+/*
+ * Writer
+ */
+
+CaptionWriter::CaptionWriter() {
+    m_segmenter.setOnCue([this](const Cue& cue) { write(cue); });
+}
+
+CaptionWriter::~CaptionWriter() {
+    close();
+}
+
+bool CaptionWriter::open(const string& base) {
+    m_srt.open(base + ".srt", ios::out | ios::trunc);
+    m_vtt.open(base + ".vtt", ios::out | ios::trunc);
+
+    if (!m_srt.is_open() || !m_vtt.is_open()) {
+        Log::error("failed to open caption files: " + base);
+        return false;
+    }
+
+    m_vtt << "WEBVTT\n\n" << flush;
+    return true;
+}
+
+bool CaptionWriter::isOpen() const {
+    return m_srt.is_open();
+}
+
+void CaptionWriter::push(const vector<CaptionWord>& words, uint64_t settledMs) {
+    lock_guard<mutex> lock(m_lock);
+
+    for (const auto& word : words)
+        m_segmenter.push(word);
+
+    m_segmenter.advance(settledMs, settledMs);
+}
+
+void CaptionWriter::advance(uint64_t nowMs) {
+    lock_guard<mutex> lock(m_lock);
+    m_segmenter.advance(0, nowMs);
+}
+
+void CaptionWriter::close() {
+    lock_guard<mutex> lock(m_lock);
+    if (!m_srt.is_open())
+        return;
+
+    m_segmenter.finish();
+    m_srt.close();
+    m_vtt.close();
+}
+
+void CaptionWriter::write(const Cue& cue) {
+    if (!m_srt.is_open())
+        return;
+
+    // each cue is flushed whole so a reader tailing the file never sees half of one
+    m_srt << srt(cue, ++m_index) << flush;
+    m_vtt << vtt(cue) << flush;
+}
+
+string CaptionWriter::srt(const Cue& cue, size_t index) {
+    string out = to_string(index) + "\n"
+               + TranscriptExport::timecode(cue.startMs, ',') + " --> " + TranscriptExport::timecode(cue.endMs, ',') + "\n";
+
+    for (size_t i = 0; i < cue.lines.size(); ++i) {
+        if (i == 0 && !cue.speaker.empty())
+            out += cue.speaker + ": ";
+        out += cue.lines[i] + "\n";
+    }
+
+    return out + "\n";
+}
+
+string CaptionWriter::vtt(const Cue& cue) {
+    string out = TranscriptExport::timecode(cue.startMs, '.') + " --> " + TranscriptExport::timecode(cue.endMs, '.') + "\n";
+
+    for (size_t i = 0; i < cue.lines.size(); ++i) {
+        if (i == 0 && !cue.speaker.empty())
+            out += "<v " + cue.speaker + ">";
+        out += cue.lines[i] + "\n";
+    }
+
+    return out + "\n";
+}
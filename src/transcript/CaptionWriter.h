@@ -0,0 +1,116 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_CAPTIONWRITER_H
+#define MEETING_SDK_LINUX_SAMPLE_CAPTIONWRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+using namespace std;
+
+struct CaptionWord {
+    string text;
+    string speaker;
+    uint64_t startMs;
+    uint64_t endMs;
+};
+
+struct Cue {
+    uint64_t startMs;
+    uint64_t endMs;
+    string speaker;
+    vector<string> lines;
+};
+
+/**
+ * Turns a stream of timed words into caption cues.
+ *
+ * A cue is closed on a speaker change, a long pause, when its text no longer
+ * fits the line budget, when it runs too long, or at the end of a sentence
+ * once it is reasonably full. Its end time is stretched to respect the maximum
+ * reading rate but never into the next cue. Cues are emitted exactly once, at
+ * the latest maxLagMs after their last word, and are never revised afterwards.
+ */
+class CaptionSegmenter {
+public:
+    struct Options {
+        size_t maxLineChars = 42;
+        size_t maxLines = 2;
+        uint64_t maxCueMs = 7000;
+        uint64_t minCueMs = 1000;
+        uint64_t minGapMs = 80;
+        uint64_t pauseMs = 1500;
+        double maxCharsPerSecond = 17.0;
+        uint64_t maxLagMs = 3000;
+    };
+
+private:
+    Options m_options;
+    function<void(const Cue&)> m_onCue;
+
+    vector<CaptionWord> m_pending;
+    size_t m_pendingChars = 0;
+    uint64_t m_lastEnd = 0;
+    uint64_t m_settled = 0;
+
+    void emit(uint64_t nextStartMs);
+    vector<string> breakLines() const;
+
+public:
+    CaptionSegmenter();
+    explicit CaptionSegmenter(const Options& options);
+
+    void setOnCue(const function<void(const Cue&)>& callback);
+
+    /**
+     * Add the next finalized word; words must arrive in time order
+     */
+    void push(const CaptionWord& word);
+
+    /**
+     * Mark stream time up to which no further words can arrive and flush any
+     * cue that has waited longer than maxLagMs
+     * @param settledMs end of the latest final result
+     * @param nowMs latest stream time seen, including interim results
+     */
+    void advance(uint64_t settledMs, uint64_t nowMs);
+
+    void finish();
+};
+
+/**
+ * Appends cues to SRT and WebVTT files as they are produced, so both can be
+ * tailed while the meeting is live
+ */
+class CaptionWriter {
+
+    CaptionSegmenter m_segmenter;
+    ofstream m_srt;
+    ofstream m_vtt;
+    size_t m_index = 0;
+    mutex m_lock;
+
+    void write(const Cue& cue);
+
+public:
+    CaptionWriter();
+    ~CaptionWriter();
+
+    /**
+     * Open <base>.srt and <base>.vtt for writing
+     * @param base output path without extension
+     */
+    bool open(const string& base);
+    bool isOpen() const;
+
+    void push(const vector<CaptionWord>& words, uint64_t settledMs);
+    void advance(uint64_t nowMs);
+    void close();
+
+    static string srt(const Cue& cue, size_t index);
+    static string vtt(const Cue& cue);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_CAPTIONWRITER_H
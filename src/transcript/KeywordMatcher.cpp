@@ -0,0 +1,223 @@
+#include "KeywordMatcher.h"
+
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+
+#include "../util/Log.h"
+
+bool KeywordMatcher::load(const string& path) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        Log::error("failed to open keyword file: " + path);
+        return false;
+    }
+
+    string line;
+    while (getline(file, line)) {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#')
+            continue;
+
+        add(line);
+    }
+
+    return true;
+}
+
+void KeywordMatcher::add(const string& term) {
+    auto normalized = normalize(term);
+    if (normalized.empty())
+        return;
+
+    m_terms.push_back(move(normalized));
+    m_built = false;
+}
+
+string KeywordMatcher::normalize(const string& text) {
+    string out;
+    out.reserve(text.size());
+
+    bool pendingSpace = false;
+    for (unsigned char c : text) {
+        if (c == '\'')
+            continue;
+
+        bool keep = c >= 0x80 || isalnum(c);
+        if (!keep) {
+            pendingSpace = !out.empty();
+            continue;
+        }
+
+        if (pendingSpace) {
+            out.push_back(' ');
+            pendingSpace = false;
+        }
+
+        out.push_back(c < 0x80 ? static_cast<char>(tolower(c)) : static_cast<char>(c));
+    }
+
+    return out;
+}
+
+int32_t& KeywordMatcher::next(int32_t state, uint8_t c) {
+    return m_transitions[static_cast<size_t>(state) * m_classCount + m_classes[c]];
+}
+
+int32_t KeywordMatcher::addNode(int32_t depth) {
+    m_transitions.resize(m_transitions.size() + m_classCount, -1);
+    m_outputs.push_back(-1);
+    m_outputLinks.push_back(-1);
+    m_depth.push_back(depth);
+
+    return static_cast<int32_t>(m_depth.size() - 1);
+}
+
+void KeywordMatcher::build() {
+    m_transitions.clear();
+    m_outputs.clear();
+    m_outputLinks.clear();
+    m_depth.clear();
+
+    // class 0 is every byte that never appears in a term
+    m_classes.fill(0);
+    m_classCount = 1;
+    for (const auto& term : m_terms)
+        for (unsigned char c : term)
+            if (!m_classes[c])
+                m_classes[c] = m_classCount++;
+
+    addNode(0);
+
+    for (size_t i = 0; i < m_terms.size(); ++i) {
+        int32_t state = c_root;
+        for (unsigned char c : m_terms[i]) {
+            if (next(state, c) < 0) {
+                auto child = addNode(m_depth[state] + 1);
+                next(state, c) = child;
+            }
+            state = next(state, c);
+        }
+
+        // duplicate terms after normalization keep the first index
+        if (m_outputs[state] < 0)
+            m_outputs[state] = static_cast<int32_t>(i);
+    }
+
+    // breadth-first pass turns the trie into a complete DFA
+    vector<int32_t> fail(m_depth.size(), c_root);
+    queue<int32_t> pending;
+
+    for (int k = 0; k < m_classCount; ++k) {
+        auto& t = m_transitions[k];
+        if (t < 0) {
+            t = c_root;
+        } else {
+            fail[t] = c_root;
+            pending.push(t);
+        }
+    }
+
+    while (!pending.empty()) {
+        auto state = pending.front();
+        pending.pop();
+
+        auto f = fail[state];
+        m_outputLinks[state] = m_outputs[f] >= 0 ? f : m_outputLinks[f];
+
+        for (int k = 0; k < m_classCount; ++k) {
+            auto& t = m_transitions[static_cast<size_t>(state) * m_classCount + k];
+            auto viaFail = m_transitions[static_cast<size_t>(f) * m_classCount + k];
+            if (t < 0) {
+                t = viaFail;
+            } else {
+                fail[t] = viaFail;
+                pending.push(t);
+            }
+        }
+    }
+
+    m_built = true;
+}
+
+size_t KeywordMatcher::size() const {
+    return m_terms.size();
+}
+
+bool KeywordMatcher::empty() const {
+    return m_terms.empty();
+}
+
+vector<Search> KeywordMatcher::match(const Alternative& alternative) const {
+    vector<Search> results;
+    if (!m_built || m_terms.empty() || alternative.words.empty())
+        return results;
+
+    const auto& words = alternative.words;
+
+    string text;
+    vector<int32_t> wordAt;
+    text.reserve(alternative.transcript.size() + words.size());
+    wordAt.reserve(text.capacity());
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        auto token = normalize(words[i].word);
+        if (token.empty())
+            continue;
+
+        if (!text.empty()) {
+            text.push_back(' ');
+            wordAt.push_back(static_cast<int32_t>(i));
+        }
+
+        text += token;
+        wordAt.insert(wordAt.end(), token.size(), static_cast<int32_t>(i));
+    }
+
+    unordered_map<int32_t, size_t> searchIndex;
+    int32_t state = c_root;
+    const auto n = text.size();
+
+    for (size_t pos = 0; pos < n; ++pos) {
+        state = m_transitions[static_cast<size_t>(state) * m_classCount + m_classes[static_cast<uint8_t>(text[pos])]];
+
+        if (pos + 1 < n && text[pos + 1] != ' ')
+            continue;
+
+        for (auto s = m_outputs[state] >= 0 ? state : m_outputLinks[state]; s >= 0; s = m_outputLinks[s]) {
+            auto begin = pos + 1 - m_depth[s];
+            if (begin > 0 && text[begin - 1] != ' ')
+                continue;
+
+            auto term = m_outputs[s];
+            auto first = wordAt[begin];
+            auto last = wordAt[pos];
+
+            Hit hit;
+            hit.start = words[first].start;
+            hit.end = words[last].end;
+            hit.speaker = words[first].speaker;
+            hit.confidence = 1.0;
+
+            for (auto w = first; w <= last; ++w) {
+                const auto& word = words[w];
+                hit.confidence = min(hit.confidence, word.confidence);
+
+                if (!hit.snippet.empty())
+                    hit.snippet.push_back(' ');
+                hit.snippet += word.punctuated_word.empty() ? word.word : word.punctuated_word;
+            }
+
+            auto it = searchIndex.find(term);
+            if (it == searchIndex.end()) {
+                it = searchIndex.emplace(term, results.size()).first;
+                results.push_back(Search{m_terms[term], {}});
+            }
+
+            results[it->second].hits.push_back(move(hit));
+        }
+    }
+
+    return results;
+}
@@ -0,0 +1,65 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_KEYWORDMATCHER_H
+#define MEETING_SDK_LINUX_SAMPLE_KEYWORDMATCHER_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include "../raw-stream/DeepgramJsonParser.h"
+
+using namespace std;
+
+/**
+ * Aho-Corasick automaton over a watch-list of terms.
+ *
+ * Terms and transcripts are normalized the same way (lower case, punctuation
+ * dropped, whitespace collapsed) and matches must start and end on a word
+ * boundary. The automaton is built once at startup into a dense DFA over a
+ * compressed byte alphabet so that matching is a single table lookup per byte.
+ */
+class KeywordMatcher {
+
+    static constexpr int32_t c_root = 0;
+
+    vector<string> m_terms;
+    vector<int32_t> m_transitions;
+    vector<int32_t> m_outputs;
+    vector<int32_t> m_outputLinks;
+    vector<int32_t> m_depth;
+    array<uint8_t, 256> m_classes{};
+    int m_classCount = 1;
+    bool m_built = false;
+
+    int32_t& next(int32_t state, uint8_t c);
+    int32_t addNode(int32_t depth);
+
+public:
+    /**
+     * Read one term per line; empty lines and lines starting with # are skipped
+     * @param path term file
+     * @return false if the file could not be read
+     */
+    bool load(const string& path);
+
+    void add(const string& term);
+
+    /**
+     * Build the automaton from the added terms; must be called before match()
+     */
+    void build();
+
+    size_t size() const;
+    bool empty() const;
+
+    /**
+     * Find every watch-list term in a finalized transcript
+     * @param alternative transcript alternative with word timings
+     * @return one Search per matched term with a Hit per occurrence
+     */
+    vector<Search> match(const Alternative& alternative) const;
+
+    static string normalize(const string& text);
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_KEYWORDMATCHER_H
@@ -0,0 +1,122 @@
+#include "TranscriptExport.h"
+
+#include <cstdio>
+#include <algorithm>
+
+#include "CaptionWriter.h"
+
+string TranscriptExport::timecode(uint64_t ms, char separator) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%02llu:%02llu:%02llu%c%03llu",
+             static_cast<unsigned long long>(ms / 3600000),
+             static_cast<unsigned long long>(ms / 60000 % 60),
+             static_cast<unsigned long long>(ms / 1000 % 60),
+             separator,
+             static_cast<unsigned long long>(ms % 1000));
+    return buf;
+}
+
+string TranscriptExport::jsonEscape(string_view text) {
+    string out;
+    out.reserve(text.size() + 2);
+
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+
+    return out;
+}
+
+vector<string> TranscriptExport::audioIssues(uint8_t flags) {
+    static const pair<uint8_t, const char*> names[] = {
+        {TranscriptLog::CLIPPING, "clipping"},
+        {TranscriptLog::DC_OFFSET, "dc_offset"},
+        {TranscriptLog::GAP, "gap"},
+        {TranscriptLog::STALL, "stall"},
+        {TranscriptLog::JITTER, "jitter"},
+    };
+
+    vector<string> out;
+    for (const auto& name : names)
+        if (flags & name.first)
+            out.emplace_back(name.second);
+    return out;
+}
+
+void TranscriptExport::toJsonl(const TranscriptLogReader& reader, ostream& out, uint64_t fromMs) {
+    for (auto it = reader.seek(fromMs), last = reader.end(); it != last; ++it) {
+        const auto& record = *it;
+
+        char times[96];
+        snprintf(times, sizeof(times), "{\"start\":%.3f,\"end\":%.3f,\"confidence\":%.3f",
+                 record.startMs / 1000.0, (record.startMs + record.durationMs) / 1000.0, record.confidence / 1000.0);
+
+        out << times
+            << ",\"speaker\":\"" << jsonEscape(record.speaker)
+            << "\",\"transcript\":\"" << jsonEscape(record.text) << "\"";
+
+        // only segments whose audio was degraded carry the tag
+        if (record.flags) {
+            out << ",\"audio_issues\":[";
+            auto issues = audioIssues(record.flags);
+            for (size_t i = 0; i < issues.size(); ++i)
+                out << (i ? ",\"" : "\"") << issues[i] << "\"";
+            out << "]";
+        }
+
+        out << "}\n";
+    }
+}
+
+static void writeCues(const TranscriptLogReader& reader, uint64_t fromMs, const function<void(const Cue&)>& onCue) {
+    CaptionSegmenter segmenter;
+    segmenter.setOnCue(onCue);
+
+    for (auto it = reader.seek(fromMs), last = reader.end(); it != last; ++it) {
+        const auto& record = *it;
+
+        // the log keeps text per speaker run, so spread its words over the run by length
+        string_view text = record.text;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            auto begin = text.find_first_not_of(' ', pos);
+            if (begin == string_view::npos) break;
+            auto end = min(text.find(' ', begin), text.size());
+
+            CaptionWord word;
+            word.text = string(text.substr(begin, end - begin));
+            word.speaker = string(record.speaker);
+            word.startMs = record.startMs + record.durationMs * begin / text.size();
+            word.endMs = record.startMs + record.durationMs * end / text.size();
+            segmenter.push(word);
+
+            pos = end;
+        }
+    }
+
+    segmenter.finish();
+}
+
+void TranscriptExport::toSrt(const TranscriptLogReader& reader, ostream& out, uint64_t fromMs) {
+    size_t index = 0;
+    writeCues(reader, fromMs, [&](const Cue& cue) { out << CaptionWriter::srt(cue, ++index); });
+}
+
+void TranscriptExport::toVtt(const TranscriptLogReader& reader, ostream& out, uint64_t fromMs) {
+    out << "WEBVTT\n\n";
+    writeCues(reader, fromMs, [&](const Cue& cue) { out << CaptionWriter::vtt(cue); });
+}
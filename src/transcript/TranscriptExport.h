@@ -0,0 +1,36 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTEXPORT_H
+#define MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTEXPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "TranscriptLog.h"
+
+using namespace std;
+
+/**
+ * Converters from a binary transcript log to text formats, optionally starting
+ * from a point in the meeting found by seeking the log
+ */
+namespace TranscriptExport {
+    void toJsonl(const TranscriptLogReader& reader, ostream& out, uint64_t fromMs = 0);
+    void toSrt(const TranscriptLogReader& reader, ostream& out, uint64_t fromMs = 0);
+    void toVtt(const TranscriptLogReader& reader, ostream& out, uint64_t fromMs = 0);
+
+    /**
+     * Format milliseconds as HH:MM:SS followed by the separator and milliseconds
+     * @param ms time in milliseconds
+     * @param separator ',' for SRT or '.' for WebVTT
+     */
+    string timecode(uint64_t ms, char separator);
+
+    string jsonEscape(string_view text);
+
+    /**
+     * Names of the TranscriptLog::AudioIssue bits set in flags
+     */
+    vector<string> audioIssues(uint8_t flags);
+}
+
+#endif //MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTEXPORT_H
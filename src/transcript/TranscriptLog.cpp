@@ -0,0 +1,418 @@
+#include "TranscriptLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../util/Log.h"
+
+namespace {
+    void putVarint(vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            auto byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    template <typename T>
+    void putFixed(uint8_t* out, T value) {
+        memcpy(out, &value, sizeof(T));
+    }
+
+    template <typename T>
+    T getFixed(const uint8_t* in) {
+        T value;
+        memcpy(&value, in, sizeof(T));
+        return value;
+    }
+
+    bool writeAll(int fd, const uint8_t* data, size_t len) {
+        while (len > 0) {
+            auto n = ::write(fd, data, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+}
+
+uint32_t TranscriptLog::checksum(const uint8_t* data, size_t len) {
+    // FNV-1a is plenty to spot a torn tail and costs nothing to compute
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Writer
+ */
+
+TranscriptLogWriter::~TranscriptLogWriter() {
+    close();
+}
+
+bool TranscriptLogWriter::open(const string& path) {
+    m_path = path;
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        Log::error("failed to open transcript log: " + path);
+        return false;
+    }
+
+    if (!recover()) {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_stop = false;
+    m_committer = Thread("transcript-log", [this]() { commitLoop(); });
+
+    return true;
+}
+
+bool TranscriptLogWriter::recover() {
+    struct stat st{};
+    fstat(m_fd, &st);
+
+    if (st.st_size == 0) {
+        uint8_t header[TranscriptLog::c_fileHeaderSize] = {};
+        memcpy(header, TranscriptLog::c_magic, sizeof(TranscriptLog::c_magic));
+        putFixed<uint16_t>(header + 4, TranscriptLog::c_version);
+        putFixed<uint64_t>(header + 8, static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(
+                chrono::system_clock::now().time_since_epoch()).count()));
+
+        return writeAll(m_fd, header, sizeof(header));
+    }
+
+    TranscriptLogReader reader;
+    if (!reader.open(m_path)) {
+        Log::error("refusing to append to unreadable transcript log: " + m_path);
+        return false;
+    }
+
+    const auto& speakers = reader.speakers();
+    for (size_t id = 0; id < speakers.size(); ++id)
+        m_speakers.emplace(string(speakers[id]), static_cast<uint32_t>(id));
+
+    auto validEnd = reader.validEnd();
+    if (validEnd < static_cast<size_t>(st.st_size)) {
+        stringstream ss;
+        ss << "truncating " << st.st_size - validEnd << "b torn tail from " << m_path;
+        Log::info(ss.str());
+
+        if (ftruncate(m_fd, static_cast<off_t>(validEnd)) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t TranscriptLogWriter::internSpeaker(const string& label) {
+    auto it = m_speakers.find(label);
+    if (it != m_speakers.end())
+        return it->second;
+
+    auto id = static_cast<uint32_t>(m_speakers.size());
+    m_speakers.emplace(label, id);
+
+    vector<uint8_t> payload;
+    putVarint(payload, id);
+    payload.insert(payload.end(), label.begin(), label.end());
+    appendRecord(TranscriptLog::SPEAKER, payload);
+
+    return id;
+}
+
+void TranscriptLogWriter::appendRecord(TranscriptLog::RecordType type, const vector<uint8_t>& payload, uint8_t flags) {
+    auto offset = m_pending.size();
+    m_pending.resize(offset + TranscriptLog::c_recordHeaderSize + payload.size());
+
+    auto* header = m_pending.data() + offset;
+    putFixed<uint32_t>(header, static_cast<uint32_t>(payload.size()));
+    putFixed<uint32_t>(header + 4, TranscriptLog::checksum(payload.data(), payload.size()));
+    header[8] = type;
+    header[9] = flags;
+    putFixed<uint16_t>(header + 10, 0);
+
+    memcpy(header + TranscriptLog::c_recordHeaderSize, payload.data(), payload.size());
+}
+
+void TranscriptLogWriter::append(uint64_t startMs, uint32_t durationMs, const string& speaker, const string& text, double confidence, uint8_t flags) {
+    if (m_fd < 0)
+        return;
+
+    vector<uint8_t> payload;
+    payload.reserve(16 + text.size());
+
+    bool wake;
+    {
+        lock_guard<mutex> lock(m_lock);
+
+        uint64_t speakerId = speaker.empty() ? 0 : internSpeaker(speaker) + 1;
+
+        putVarint(payload, startMs);
+        putVarint(payload, durationMs);
+        putVarint(payload, speakerId);
+        putVarint(payload, static_cast<uint64_t>(max(0.0, confidence) * 1000 + 0.5));
+        payload.insert(payload.end(), text.begin(), text.end());
+
+        appendRecord(TranscriptLog::RESULT, payload, flags);
+        wake = m_pending.size() >= m_commitBytes;
+    }
+
+    m_records++;
+    if (wake)
+        m_wake.notify_one();
+}
+
+void TranscriptLogWriter::commit() {
+    lock_guard<mutex> writeLock(m_writeLock);
+
+    {
+        lock_guard<mutex> lock(m_lock);
+        swap(m_pending, m_flushing);
+    }
+
+    if (m_flushing.empty())
+        return;
+
+    if (!writeAll(m_fd, m_flushing.data(), m_flushing.size()))
+        Log::error("failed to write transcript log: " + m_path);
+
+    fdatasync(m_fd);
+    m_flushing.clear();
+    m_commits++;
+}
+
+void TranscriptLogWriter::commitLoop() {
+    unique_lock<mutex> lock(m_lock);
+
+    while (!m_stop) {
+        m_wake.wait_for(lock, m_commitInterval, [&]() { return m_stop || m_pending.size() >= m_commitBytes; });
+
+        lock.unlock();
+        commit();
+        lock.lock();
+    }
+}
+
+void TranscriptLogWriter::flush() {
+    if (m_fd >= 0)
+        commit();
+}
+
+void TranscriptLogWriter::close() {
+    if (m_fd < 0)
+        return;
+
+    {
+        lock_guard<mutex> lock(m_lock);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+
+    if (m_committer.joinable())
+        m_committer.join();
+
+    commit();
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+uint64_t TranscriptLogWriter::records() const {
+    return m_records;
+}
+
+uint64_t TranscriptLogWriter::commits() const {
+    return m_commits;
+}
+
+size_t TranscriptLogWriter::pendingBytes() {
+    lock_guard<mutex> lock(m_lock);
+    return m_pending.size();
+}
+
+/*
+ * Reader
+ */
+
+TranscriptLogReader::~TranscriptLogReader() {
+    close();
+}
+
+bool TranscriptLogReader::open(const string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st{};
+    fstat(fd, &st);
+    m_size = static_cast<size_t>(st.st_size);
+
+    if (m_size < TranscriptLog::c_fileHeaderSize) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        m_size = 0;
+        return false;
+    }
+
+    m_data = static_cast<const uint8_t*>(data);
+    madvise(data, m_size, MADV_SEQUENTIAL);
+
+    if (memcmp(m_data, TranscriptLog::c_magic, sizeof(TranscriptLog::c_magic)) != 0 ||
+        getFixed<uint16_t>(m_data + 4) != TranscriptLog::c_version) {
+        close();
+        return false;
+    }
+
+    return scan();
+}
+
+void TranscriptLogReader::close() {
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+
+    m_data = nullptr;
+    m_size = 0;
+    m_validEnd = 0;
+    m_speakers.clear();
+    m_index.clear();
+}
+
+bool TranscriptLogReader::scan() {
+    size_t offset = TranscriptLog::c_fileHeaderSize;
+    size_t results = 0;
+
+    while (offset + TranscriptLog::c_recordHeaderSize <= m_size) {
+        const auto* header = m_data + offset;
+        auto length = getFixed<uint32_t>(header);
+        auto sum = getFixed<uint32_t>(header + 4);
+        auto type = header[8];
+
+        const auto* payload = header + TranscriptLog::c_recordHeaderSize;
+        const auto* payloadEnd = payload + length;
+        if (payloadEnd > m_data + m_size || TranscriptLog::checksum(payload, length) != sum)
+            break;
+
+        uint64_t value;
+        const auto* p = payload;
+
+        if (type == TranscriptLog::SPEAKER && getVarint(p, payloadEnd, value)) {
+            if (m_speakers.size() <= value)
+                m_speakers.resize(value + 1);
+            m_speakers[value] = string_view(reinterpret_cast<const char*>(p), payloadEnd - p);
+        } else if (type == TranscriptLog::RESULT && getVarint(p, payloadEnd, value)) {
+            if (results++ % c_indexStride == 0)
+                m_index.push_back({value, offset});
+        }
+
+        offset = payloadEnd - m_data;
+    }
+
+    m_validEnd = offset;
+    return true;
+}
+
+TranscriptLogReader::Iterator TranscriptLogReader::begin() const {
+    return Iterator(this, TranscriptLog::c_fileHeaderSize);
+}
+
+TranscriptLogReader::Iterator TranscriptLogReader::end() const {
+    return Iterator(this, m_validEnd);
+}
+
+TranscriptLogReader::Iterator TranscriptLogReader::seek(uint64_t startMs) const {
+    auto it = lower_bound(m_index.begin(), m_index.end(), startMs,
+                          [](const IndexEntry& e, uint64_t ms) { return e.startMs < ms; });
+
+    auto from = it == m_index.begin() ? TranscriptLog::c_fileHeaderSize : prev(it)->offset;
+
+    Iterator cursor(this, from);
+    auto last = end();
+    while (cursor != last && cursor->startMs < startMs)
+        ++cursor;
+
+    return cursor;
+}
+
+size_t TranscriptLogReader::validEnd() const {
+    return m_validEnd;
+}
+
+const vector<string_view>& TranscriptLogReader::speakers() const {
+    return m_speakers;
+}
+
+TranscriptLogReader::Iterator::Iterator(const TranscriptLogReader* reader, size_t offset)
+    : m_reader(reader), m_offset(offset) {
+    settle();
+}
+
+TranscriptLogReader::Iterator& TranscriptLogReader::Iterator::operator++() {
+    m_offset += TranscriptLog::c_recordHeaderSize + getFixed<uint32_t>(m_reader->m_data + m_offset);
+    settle();
+    return *this;
+}
+
+void TranscriptLogReader::Iterator::settle() {
+    const auto* data = m_reader->m_data;
+
+    // skip to the next RESULT record, decoding it in place
+    while (m_offset < m_reader->m_validEnd) {
+        const auto* header = data + m_offset;
+        auto length = getFixed<uint32_t>(header);
+
+        if (header[8] == TranscriptLog::RESULT) {
+            const auto* p = header + TranscriptLog::c_recordHeaderSize;
+            const auto* payloadEnd = p + length;
+            uint64_t start = 0, duration = 0, speaker = 0, confidence = 0;
+
+            if (getVarint(p, payloadEnd, start) && getVarint(p, payloadEnd, duration) &&
+                getVarint(p, payloadEnd, speaker) && getVarint(p, payloadEnd, confidence)) {
+                m_record.startMs = start;
+                m_record.durationMs = static_cast<uint32_t>(duration);
+                m_record.confidence = static_cast<uint32_t>(confidence);
+                m_record.flags = header[9];
+                m_record.speaker = speaker > 0 && speaker <= m_reader->m_speakers.size()
+                                   ? m_reader->m_speakers[speaker - 1] : string_view();
+                m_record.text = string_view(reinterpret_cast<const char*>(p), payloadEnd - p);
+                return;
+            }
+        }
+
+        m_offset += TranscriptLog::c_recordHeaderSize + length;
+    }
+}
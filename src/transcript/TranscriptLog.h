@@ -0,0 +1,181 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTLOG_H
+#define MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTLOG_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "../util/Threads.h"
+
+using namespace std;
+
+/**
+ * On-disk layout (little endian)
+ *
+ *   file header   "ZDGT" | u16 version | u16 flags | u64 created (unix ms)
+ *   record        u32 length | u32 checksum | u8 type | u8 flags | u16 reserved | payload[length]
+ *
+ *   RESULT flags      AudioIssue bits seen in the audio behind the segment
+ *
+ *   SPEAKER payload   varint id | utf-8 label
+ *   RESULT payload    varint start ms | varint duration ms | varint speaker id + 1 | varint confidence x1000 | utf-8 text
+ *
+ * Records are only ever appended. A torn record at the tail fails its checksum
+ * and is truncated away when the file is reopened for writing.
+ */
+namespace TranscriptLog {
+    constexpr char c_magic[4] = {'Z', 'D', 'G', 'T'};
+    constexpr uint16_t c_version = 1;
+    constexpr size_t c_fileHeaderSize = 16;
+    constexpr size_t c_recordHeaderSize = 12;
+
+    enum RecordType : uint8_t {
+        SPEAKER = 1,
+        RESULT = 2,
+    };
+
+    enum AudioIssue : uint8_t {
+        CLIPPING = 1,
+        DC_OFFSET = 2,
+        GAP = 4,
+        STALL = 8,
+        JITTER = 16,
+    };
+
+    struct Record {
+        uint64_t startMs = 0;
+        uint32_t durationMs = 0;
+        uint32_t confidence = 0;
+        uint8_t flags = 0;
+        string_view speaker;
+        string_view text;
+    };
+
+    uint32_t checksum(const uint8_t* data, size_t len);
+}
+
+class TranscriptLogWriter {
+
+    int m_fd = -1;
+    string m_path;
+
+    unordered_map<string, uint32_t> m_speakers;
+
+    mutex m_lock;
+    mutex m_writeLock;
+    condition_variable m_wake;
+    vector<uint8_t> m_pending;
+    vector<uint8_t> m_flushing;
+    bool m_stop = false;
+    Thread m_committer;
+
+    chrono::milliseconds m_commitInterval{50};
+    size_t m_commitBytes = 64 * 1024;
+
+    atomic<uint64_t> m_records{0};
+    atomic<uint64_t> m_commits{0};
+
+    void appendRecord(TranscriptLog::RecordType type, const vector<uint8_t>& payload, uint8_t flags = 0);
+    uint32_t internSpeaker(const string& label);
+    bool recover();
+    void commit();
+    void commitLoop();
+
+public:
+    ~TranscriptLogWriter();
+
+    /**
+     * Open or create the log, truncating any torn tail left by a crash
+     * @param path log file path
+     * @return false if the file could not be opened or is not a transcript log
+     */
+    bool open(const string& path);
+
+    /**
+     * Queue a finalized segment; it reaches disk with the next group commit
+     * @param flags TranscriptLog::AudioIssue bits for the segment's audio
+     */
+    void append(uint64_t startMs, uint32_t durationMs, const string& speaker, const string& text, double confidence, uint8_t flags = 0);
+
+    /**
+     * Commit everything queued so far and wait for it to hit disk
+     */
+    void flush();
+    void close();
+
+    uint64_t records() const;
+    uint64_t commits() const;
+    size_t pendingBytes();
+};
+
+class TranscriptLogReader {
+
+    struct IndexEntry {
+        uint64_t startMs;
+        size_t offset;
+    };
+
+    static constexpr size_t c_indexStride = 64;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_validEnd = 0;
+
+    vector<string_view> m_speakers;
+    vector<IndexEntry> m_index;
+
+    bool scan();
+
+public:
+    class Iterator {
+        const TranscriptLogReader* m_reader;
+        size_t m_offset;
+        TranscriptLog::Record m_record;
+
+        void settle();
+
+    public:
+        Iterator(const TranscriptLogReader* reader, size_t offset);
+
+        const TranscriptLog::Record& operator*() const { return m_record; }
+        const TranscriptLog::Record* operator->() const { return &m_record; }
+        Iterator& operator++();
+        bool operator!=(const Iterator& other) const { return m_offset != other.m_offset; }
+    };
+
+    TranscriptLogReader() = default;
+    TranscriptLogReader(const TranscriptLogReader&) = delete;
+    TranscriptLogReader& operator=(const TranscriptLogReader&) = delete;
+    ~TranscriptLogReader();
+
+    /**
+     * Map the log read-only and index it by walking the record headers
+     * @param path log file path
+     * @return false if the file is missing or not a transcript log
+     */
+    bool open(const string& path);
+    void close();
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    /**
+     * First result whose start time is at or after the given time
+     */
+    Iterator seek(uint64_t startMs) const;
+
+    /**
+     * Offset of the last intact record; anything past it is a torn write
+     */
+    size_t validEnd() const;
+
+    const vector<string_view>& speakers() const;
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTLOG_H
@@ -0,0 +1,143 @@
+#include "TranscriptSinks.h"
+
+#include <cmath>
+#include <sstream>
+
+#include "../util/Log.h"
+#include "../util/Metrics.h"
+#include "../util/Trace.h"
+
+namespace {
+    string speakerLabel(const DeepgramResults& results, int speaker) {
+        // separate participant streams name the participant rather than a diarized voice
+        if (results.node)
+            return "participant " + to_string(results.node);
+
+        return speaker >= 0 ? "speaker " + to_string(speaker) : "";
+    }
+}
+
+bool TranscriptSinks::open(const string& keywordFile, const string& transcriptLog, const string& captions, const string& meeting) {
+    m_meeting = meeting;
+
+    if (!keywordFile.empty()) {
+        if (!m_keywords.load(keywordFile))
+            return false;
+
+        m_keywords.build();
+        Log::info("loaded " + to_string(m_keywords.size()) + " keywords");
+    }
+
+    if (!transcriptLog.empty() && !m_log.open(transcriptLog))
+        return false;
+
+    if (!captions.empty() && !m_captions.open(captions))
+        return false;
+
+    return true;
+}
+
+void TranscriptSinks::onResult(DeepgramResults& results) {
+    auto streamMs = static_cast<uint64_t>(llround((results.start + results.duration) * 1000));
+
+    if (!results.is_final) {
+        if (m_captions.isOpen())
+            m_captions.advance(streamMs);
+        return;
+    }
+
+    if (results.channel.alternatives.empty())
+        return;
+
+    auto& registry = MetricsRegistry::getInstance();
+    static auto& keywordTime = registry.histogram("zoomsdk_sink_seconds", "Time spent in each transcript sink", "sink=\"keywords\"");
+    static auto& logTime = registry.histogram("zoomsdk_sink_seconds", "Time spent in each transcript sink", "sink=\"transcript_log\"");
+    static auto& captionTime = registry.histogram("zoomsdk_sink_seconds", "Time spent in each transcript sink", "sink=\"captions\"");
+
+    if (!m_keywords.empty()) {
+        ScopedTimer timer(keywordTime);
+        Trace::Span span("sink:keywords", "sink");
+        alertKeywords(results);
+    }
+
+    {
+        ScopedTimer timer(logTime);
+        Trace::Span span("sink:transcript_log", "sink");
+        logTranscript(results);
+    }
+
+    if (m_captions.isOpen()) {
+        ScopedTimer timer(captionTime);
+        Trace::Span span("sink:captions", "sink");
+        vector<CaptionWord> words;
+        for (const auto& word : results.channel.alternatives[0].words) {
+            words.push_back({word.punctuated_word.empty() ? word.word : word.punctuated_word,
+                             speakerLabel(results, word.speaker),
+                             static_cast<uint64_t>(llround(word.start * 1000)),
+                             static_cast<uint64_t>(llround(word.end * 1000))});
+        }
+
+        m_captions.push(words, streamMs);
+    }
+}
+
+void TranscriptSinks::alertKeywords(DeepgramResults& results) {
+    static auto& hits = MetricsRegistry::getInstance().counter("zoomsdk_keyword_hits_total", "Watch-list terms found in final transcripts");
+
+    auto searches = m_keywords.match(results.channel.alternatives[0]);
+    for (auto& search : searches) {
+        hits.inc(search.hits.size());
+        for (const auto& hit : search.hits) {
+            stringstream ss;
+            ss << "keyword alert: \"" << search.query << "\" at " << hit.start << "s";
+            if (!m_meeting.empty())
+                ss << " in meeting " << m_meeting;
+            if (results.node)
+                ss << " by participant " << results.node;
+            else if (hit.speaker >= 0)
+                ss << " by speaker " << hit.speaker;
+            ss << ": " << hit.snippet;
+            Log::info(ss.str());
+        }
+
+        results.channel.search.push_back(move(search));
+    }
+}
+
+void TranscriptSinks::logTranscript(const DeepgramResults& results) {
+    const auto& alternative = results.channel.alternatives[0];
+    if (alternative.transcript.empty())
+        return;
+
+    const auto& words = alternative.words;
+    if (words.empty()) {
+        m_log.append(llround(results.start * 1000), llround(results.duration * 1000), speakerLabel(results, -1), alternative.transcript, alternative.confidence, results.audioIssues);
+        return;
+    }
+
+    // one record per run of words from the same diarized speaker
+    for (size_t first = 0, last; first < words.size(); first = last) {
+        string text;
+        double confidence = 0;
+
+        for (last = first; last < words.size() && words[last].speaker == words[first].speaker; ++last) {
+            if (!text.empty()) text.push_back(' ');
+            text += words[last].punctuated_word.empty() ? words[last].word : words[last].punctuated_word;
+            confidence += words[last].confidence;
+        }
+
+        auto startMs = llround(words[first].start * 1000);
+        auto endMs = llround(words[last - 1].end * 1000);
+
+        m_log.append(startMs, endMs - startMs, speakerLabel(results, words[first].speaker), text, confidence / (last - first), results.audioIssues);
+    }
+}
+
+void TranscriptSinks::close() {
+    m_captions.close();
+    m_log.close();
+}
+
+TranscriptLogWriter& TranscriptSinks::log() {
+    return m_log;
+}
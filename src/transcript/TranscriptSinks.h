@@ -0,0 +1,45 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTSINKS_H
+#define MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTSINKS_H
+
+#include <string>
+
+#include "../raw-stream/DeepgramJsonParser.h"
+#include "CaptionWriter.h"
+#include "KeywordMatcher.h"
+#include "TranscriptLog.h"
+
+using namespace std;
+
+/**
+ * Everything one meeting's transcript is written to: keyword alerts, the
+ * transcript log and live captions. Interim results only move the captions
+ * along; final results go to every sink that is open.
+ */
+class TranscriptSinks {
+
+    string m_meeting;
+    KeywordMatcher m_keywords;
+    TranscriptLogWriter m_log;
+    CaptionWriter m_captions;
+
+    void alertKeywords(DeepgramResults& results);
+    void logTranscript(const DeepgramResults& results);
+
+public:
+    /**
+     * Open the sinks that have a path, empty paths are skipped
+     * @param meeting named in keyword alerts when several meetings share a log, empty for none
+     */
+    bool open(const string& keywordFile, const string& transcriptLog, const string& captions, const string& meeting = "");
+
+    void onResult(DeepgramResults& results);
+
+    /**
+     * Flush and close every sink
+     */
+    void close();
+
+    TranscriptLogWriter& log();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_TRANSCRIPTSINKS_H
@@ -0,0 +1,122 @@
+#include "IoLoop.h"
+
+#include <future>
+
+#include <glib-unix.h>
+
+#include "Metrics.h"
+
+IoLoop& IoLoop::getInstance() {
+    // never destroyed: sockets may still be closed from atexit handlers
+    static auto* loop = new IoLoop();
+    return *loop;
+}
+
+IoLoop::IoLoop() : m_context(g_main_context_new()), m_loop(g_main_loop_new(m_context, FALSE)) {
+    promise<thread::id> started;
+    auto id = started.get_future();
+
+    m_thread = Thread("io", [this, &started]() {
+        g_main_context_push_thread_default(m_context);
+        started.set_value(this_thread::get_id());
+        g_main_loop_run(m_loop);
+    });
+
+    m_threadId = id.get();
+
+    MetricsRegistry::getInstance().gauge("zoomsdk_io_sources", "File descriptors watched by the I/O loop", [this]() {
+        lock_guard<mutex> lock(m_lock);
+        return static_cast<double>(m_sources.size());
+    });
+}
+
+gboolean IoLoop::dispatch(gint fd, GIOCondition condition, gpointer data) {
+    static auto& dispatches = MetricsRegistry::getInstance().counter("zoomsdk_io_dispatches_total", "Ready file descriptors handled by the I/O loop");
+    (void) fd;
+
+    dispatches.inc();
+    auto* watch = static_cast<Watch*>(data);
+    if (watch->handler(condition))
+        return G_SOURCE_CONTINUE;
+
+    watch->loop->forget(watch->id);
+    return G_SOURCE_REMOVE;
+}
+
+unsigned IoLoop::watch(int fd, GIOCondition condition, const Handler& handler) {
+    auto* source = g_unix_fd_source_new(fd, static_cast<GIOCondition>(condition | G_IO_HUP | G_IO_ERR));
+    auto* watch = new Watch{this, 0, handler};
+
+    g_source_set_callback(source, reinterpret_cast<GSourceFunc>(reinterpret_cast<void (*)()>(dispatch)), watch,
+                          [](gpointer data) { delete static_cast<Watch*>(data); });
+
+    // the id is set before the source can dispatch, since this holds the lock dispatch needs to forget it
+    lock_guard<mutex> lock(m_lock);
+    watch->id = g_source_attach(source, m_context);
+    m_sources[watch->id] = source;
+    return watch->id;
+}
+
+void IoLoop::forget(unsigned id) {
+    GSource* source = nullptr;
+    {
+        lock_guard<mutex> lock(m_lock);
+        auto it = m_sources.find(id);
+        if (it == m_sources.end())
+            return;
+        source = it->second;
+        m_sources.erase(it);
+    }
+
+    g_source_unref(source);
+}
+
+void IoLoop::remove(unsigned id) {
+    if (!id)
+        return;
+
+    GSource* source = nullptr;
+    {
+        lock_guard<mutex> lock(m_lock);
+        auto it = m_sources.find(id);
+        if (it != m_sources.end()) {
+            source = it->second;
+            m_sources.erase(it);
+        }
+    }
+
+    if (source) {
+        g_source_destroy(source);
+        g_source_unref(source);
+    }
+
+    // a handler may be running right now; once the loop takes the next job it is done
+    if (!onLoopThread())
+        run([]() {});
+}
+
+void IoLoop::run(const function<void()>& work) {
+    if (onLoopThread())
+        return work();
+
+    struct Call {
+        function<void()> work;
+        promise<void> done;
+    };
+
+    Call call{work, {}};
+    auto done = call.done.get_future();
+
+    g_main_context_invoke(m_context, [](gpointer data) -> gboolean {
+        auto* call = static_cast<Call*>(data);
+        call->work();
+        call->done.set_value();
+        return G_SOURCE_REMOVE;
+    }, &call);
+
+    done.wait();
+}
+
+bool IoLoop::onLoopThread() const {
+    return this_thread::get_id() == m_threadId;
+}
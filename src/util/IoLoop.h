@@ -0,0 +1,76 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_IOLOOP_H
+#define MEETING_SDK_LINUX_SAMPLE_IOLOOP_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <glib.h>
+
+#include "Threads.h"
+
+using namespace std;
+
+/**
+ * One GLib main context on one thread that dispatches every socket and
+ * eventfd the bot watches, in place of a thread blocked in poll() per socket.
+ *
+ * Sources are GLib fd sources, so the thread sleeps until one of them is
+ * ready and has no timers of its own. Handlers run on the loop thread and
+ * must not block. The loop lives for the whole process.
+ */
+class IoLoop {
+public:
+    /**
+     * @param condition what the fd is ready for, including G_IO_HUP and G_IO_ERR
+     * @return false to stop watching
+     */
+    using Handler = function<bool(GIOCondition condition)>;
+
+private:
+    struct Watch {
+        IoLoop* loop;
+        unsigned id;
+        Handler handler;
+    };
+
+    GMainContext* m_context;
+    GMainLoop* m_loop;
+    Thread m_thread;
+    thread::id m_threadId;
+
+    mutex m_lock;
+    map<unsigned, GSource*> m_sources;
+
+    IoLoop();
+
+    static gboolean dispatch(gint fd, GIOCondition condition, gpointer data);
+    void forget(unsigned id);
+
+public:
+    static IoLoop& getInstance();
+
+    /**
+     * Call the handler on the loop thread whenever the fd is ready
+     * @param condition G_IO_IN, G_IO_OUT or both
+     * @return id for remove()
+     */
+    unsigned watch(int fd, GIOCondition condition, const Handler& handler);
+
+    /**
+     * Stop watching. Off the loop thread this waits for a handler already
+     * running, so whatever it uses may be freed once this returns.
+     * @param id from watch(), 0 is ignored
+     */
+    void remove(unsigned id);
+
+    /**
+     * Run on the loop thread and wait for it to finish
+     */
+    void run(const function<void()>& work);
+
+    bool onLoopThread() const;
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_IOLOOP_H
@@ -0,0 +1,379 @@
+#include "Log.h"
+#include "Threads.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+atomic<int> Log::s_level{Log::INFO};
+
+namespace {
+
+    struct EntryHeader {
+        uint32_t length;
+        uint16_t level;
+        uint16_t padding;
+        uint32_t tid;
+        uint32_t reserved;
+        int64_t timestamp;
+    };
+
+    constexpr uint32_t c_wrap = UINT32_MAX;
+    constexpr size_t c_ringSize = 64 * 1024;
+    constexpr size_t c_maxMessage = c_ringSize / 4;
+
+    size_t align8(size_t n) {
+        return (n + 7) & ~static_cast<size_t>(7);
+    }
+
+    /**
+     * Single-producer single-consumer byte ring owned by one logging thread
+     */
+    struct ThreadBuffer {
+        alignas(64) atomic<size_t> head{0};
+        alignas(64) atomic<size_t> tail{0};
+        atomic<bool> active{true};
+        ThreadBuffer* next = nullptr;
+        alignas(8) char data[c_ringSize];
+
+        bool push(const EntryHeader& header, const char* message) {
+            auto need = align8(sizeof(EntryHeader) + header.length);
+            auto t = tail.load(memory_order_relaxed);
+            auto free = c_ringSize - (t - head.load(memory_order_acquire));
+
+            auto pos = t % c_ringSize;
+            auto contiguous = c_ringSize - pos;
+            auto padding = contiguous < need ? contiguous : 0;
+
+            if (free < need + padding)
+                return false;
+
+            if (padding) {
+                memcpy(data + pos, &c_wrap, sizeof(c_wrap));
+                t += padding;
+                pos = 0;
+            }
+
+            memcpy(data + pos, &header, sizeof(header));
+            memcpy(data + pos + sizeof(header), message, header.length);
+            tail.store(t + need, memory_order_release);
+
+            return true;
+        }
+
+        template <typename F>
+        bool drain(F&& consume) {
+            auto h = head.load(memory_order_relaxed);
+            auto t = tail.load(memory_order_acquire);
+            if (h == t)
+                return false;
+
+            while (h < t) {
+                auto pos = h % c_ringSize;
+
+                uint32_t length;
+                memcpy(&length, data + pos, sizeof(length));
+                if (length == c_wrap) {
+                    h += c_ringSize - pos;
+                    continue;
+                }
+
+                EntryHeader header;
+                memcpy(&header, data + pos, sizeof(header));
+                consume(header, data + pos + sizeof(header));
+                h += align8(sizeof(EntryHeader) + header.length);
+            }
+
+            head.store(h, memory_order_release);
+            return true;
+        }
+    };
+
+    struct Record {
+        EntryHeader header;
+        string message;
+    };
+
+    class Logger {
+        atomic<ThreadBuffer*> m_buffers{nullptr};
+        atomic<uint64_t> m_dropped{0};
+        atomic<int> m_format{Log::TEXT};
+        atomic<bool> m_sleeping{false};
+        atomic<uint64_t> m_written{0};
+        atomic<uint64_t> m_pushed{0};
+
+        mutex m_lock;
+        condition_variable m_wake;
+        condition_variable m_flushed;
+        Thread m_flusher;
+        chrono::steady_clock::time_point m_epoch = chrono::steady_clock::now();
+
+        vector<Record> m_batch;
+        string m_out;
+        string m_err;
+
+        ThreadBuffer* claim() {
+            for (auto* b = m_buffers.load(memory_order_acquire); b; b = b->next) {
+                bool inactive = false;
+                if (b->active.compare_exchange_strong(inactive, true))
+                    return b;
+            }
+
+            auto* b = new ThreadBuffer();
+            auto* head = m_buffers.load(memory_order_relaxed);
+            do {
+                b->next = head;
+            } while (!m_buffers.compare_exchange_weak(head, b, memory_order_release, memory_order_relaxed));
+
+            return b;
+        }
+
+        void format(const Record& r) {
+            auto level = static_cast<Log::Level>(r.header.level);
+
+            if (m_format.load(memory_order_relaxed) == Log::JSON) {
+                static const char* names[] = {"debug", "info", "success", "warn", "error"};
+
+                char prefix[128];
+                snprintf(prefix, sizeof(prefix), "{\"ts\":%.6f,\"level\":\"%s\",\"tid\":%u,\"msg\":\"",
+                         r.header.timestamp / 1e9, names[min<int>(level, Log::ERROR)], r.header.tid);
+                m_out += prefix;
+
+                for (char c : r.message) {
+                    switch (c) {
+                        case '"': m_out += "\\\""; break;
+                        case '\\': m_out += "\\\\"; break;
+                        case '\n': m_out += "\\n"; break;
+                        case '\r': m_out += "\\r"; break;
+                        case '\t': m_out += "\\t"; break;
+                        default:
+                            if (static_cast<unsigned char>(c) < 0x20) {
+                                char esc[8];
+                                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                                m_out += esc;
+                            } else {
+                                m_out.push_back(c);
+                            }
+                    }
+                }
+
+                m_out += "\"}\n";
+                return;
+            }
+
+            auto& out = level >= Log::ERROR ? m_err : m_out;
+            switch (level) {
+                case Log::SUCCESS: out += Emoji::checkMark; break;
+                case Log::ERROR: out += Emoji::crossMark; break;
+                case Log::WARN: out += "⚠️"; break;
+                case Log::DEBUG: out += "·"; break;
+                default: out += Emoji::hourglass;
+            }
+            out.push_back(' ');
+            out += r.message;
+            out.push_back('\n');
+        }
+
+        bool drainAll() {
+            m_batch.clear();
+
+            for (auto* b = m_buffers.load(memory_order_acquire); b; b = b->next) {
+                b->drain([&](const EntryHeader& header, const char* message) {
+                    m_batch.push_back({header, string(message, header.length)});
+                });
+            }
+
+            if (m_batch.empty())
+                return false;
+
+            stable_sort(m_batch.begin(), m_batch.end(), [](const Record& a, const Record& b) {
+                return a.header.timestamp < b.header.timestamp;
+            });
+
+            for (const auto& r : m_batch)
+                format(r);
+
+            if (!m_out.empty()) {
+                fwrite(m_out.data(), 1, m_out.size(), stdout);
+                fflush(stdout);
+                m_out.clear();
+            }
+
+            if (!m_err.empty()) {
+                fwrite(m_err.data(), 1, m_err.size(), stderr);
+                fflush(stderr);
+                m_err.clear();
+            }
+
+            m_written += m_batch.size();
+            return true;
+        }
+
+        void run() {
+            while (true) {
+                if (drainAll()) {
+                    m_flushed.notify_all();
+                    continue;
+                }
+
+                // announce that we are going to sleep, then look once more so a
+                // producer that missed the flag cannot strand its message
+                m_sleeping.store(true, memory_order_seq_cst);
+                if (drainAll()) {
+                    m_sleeping.store(false, memory_order_relaxed);
+                    m_flushed.notify_all();
+                    continue;
+                }
+
+                unique_lock<mutex> lock(m_lock);
+                m_flushed.notify_all();
+                m_wake.wait_for(lock, chrono::milliseconds(200), [&]() { return !m_sleeping.load(); });
+                m_sleeping.store(false, memory_order_relaxed);
+            }
+        }
+
+    public:
+        Logger() {
+            m_flusher = Thread("log", [this]() { run(); });
+            m_flusher.detach();
+        }
+
+        void write(Log::Level level, const string& message) {
+            thread_local ThreadBuffer* t_buffer = nullptr;
+            thread_local uint32_t t_tid = 0;
+            thread_local struct Release {
+                ThreadBuffer** buffer;
+                ~Release() { if (*buffer) (*buffer)->active.store(false, memory_order_release); }
+            } t_release{&t_buffer};
+
+            if (!t_buffer) {
+                t_buffer = claim();
+                t_tid = static_cast<uint32_t>(syscall(SYS_gettid));
+            }
+
+            EntryHeader header{};
+            header.length = static_cast<uint32_t>(min(message.size(), c_maxMessage));
+            header.level = static_cast<uint16_t>(level);
+            header.tid = t_tid;
+            header.timestamp = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - m_epoch).count();
+
+            if (!t_buffer->push(header, message.data())) {
+                m_dropped.fetch_add(1, memory_order_relaxed);
+                return;
+            }
+
+            m_pushed.fetch_add(1, memory_order_relaxed);
+
+            // the flag is cleared under the lock the flusher checks it with, so the
+            // wakeup cannot land between its check and its wait
+            if (m_sleeping.load(memory_order_seq_cst)) {
+                lock_guard<mutex> lock(m_lock);
+                if (m_sleeping.exchange(false))
+                    m_wake.notify_one();
+            }
+        }
+
+        void flush() {
+            auto target = m_pushed.load();
+            unique_lock<mutex> lock(m_lock);
+            m_sleeping.store(false);
+            m_wake.notify_one();
+            m_flushed.wait_for(lock, chrono::seconds(2), [&]() { return m_written.load() >= target; });
+        }
+
+        void setFormat(Log::Format format) {
+            m_format = format;
+        }
+
+        uint64_t dropped() const {
+            return m_dropped.load(memory_order_relaxed);
+        }
+    };
+
+    Logger& logger() {
+        // never destroyed so threads may keep logging during static teardown
+        static auto* instance = new Logger();
+        return *instance;
+    }
+}
+
+bool LogRateLimit::allow() {
+    auto now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    auto next = m_next.load(memory_order_relaxed);
+
+    if (now < next || !m_next.compare_exchange_strong(next, now + m_intervalNs, memory_order_relaxed)) {
+        m_suppressed.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t LogRateLimit::takeSuppressed() {
+    return m_suppressed.exchange(0, memory_order_relaxed);
+}
+
+void Log::throttled(LogRateLimit& limit, Level level, const string& message) {
+    if (!enabled(level) || !limit.allow())
+        return;
+
+    auto suppressed = limit.takeSuppressed();
+    if (suppressed)
+        write(level, message + " (" + to_string(suppressed) + " similar suppressed)");
+    else
+        write(level, message);
+}
+
+void Log::write(Level level, const string& message) {
+    if (!enabled(level))
+        return;
+
+    logger().write(level, message);
+}
+
+void Log::setLevel(Level level) {
+    s_level = level;
+}
+
+bool Log::setLevel(const string& level) {
+    static const pair<const char*, Level> names[] = {
+        {"debug", DEBUG}, {"info", INFO}, {"warn", WARN}, {"error", ERROR}, {"off", OFF}
+    };
+
+    for (const auto& name : names) {
+        if (level == name.first) {
+            setLevel(name.second);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Log::setFormat(Format format) {
+    logger().setFormat(format);
+}
+
+bool Log::setFormat(const string& format) {
+    if (format == "text")
+        setFormat(TEXT);
+    else if (format == "json")
+        setFormat(JSON);
+    else
+        return false;
+
+    return true;
+}
+
+void Log::flush() {
+    logger().flush();
+}
+
+uint64_t Log::dropped() {
+    return logger().dropped();
+}
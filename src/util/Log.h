@@ -3,6 +3,9 @@
 
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 using namespace std;
 
@@ -12,20 +15,101 @@ namespace Emoji {
     const string hourglass = "⏳";
 }
 
+/**
+ * Lets one message through per interval and counts the ones it holds back.
+ * Keep one static instance per call site on per-frame paths.
+ */
+class LogRateLimit {
+    atomic<int64_t> m_next{0};
+    atomic<uint64_t> m_suppressed{0};
+    int64_t m_intervalNs;
+
+public:
+    explicit LogRateLimit(chrono::nanoseconds interval) : m_intervalNs(interval.count()) {}
+
+    /**
+     * @return true if a message may be logged now
+     */
+    bool allow();
+
+    /**
+     * @return messages suppressed since the last allowed one, resetting the count
+     */
+    uint64_t takeSuppressed();
+};
+
+/**
+ * Asynchronous logger.
+ *
+ * Each thread appends to its own single-producer ring without taking a lock;
+ * a background thread drains every ring, orders the batch by timestamp and
+ * writes it with one call. When a ring is full the message is dropped and
+ * counted rather than blocking the caller.
+ */
 class Log {
-    public:
-        static void success(const string& message) {
-            cout << Emoji::checkMark << " " << message << endl;
-        }
+public:
+    enum Level {
+        DEBUG = 0,
+        INFO = 1,
+        SUCCESS = 2,
+        WARN = 3,
+        ERROR = 4,
+        OFF = 5
+    };
+
+    enum Format {
+        TEXT,
+        JSON
+    };
+
+    static void success(const string& message) {
+        write(SUCCESS, message);
+    }
+
+    static void info(const std::string& message) {
+        write(INFO, message);
+    }
+
+    static void error(const string& message) {
+        write(ERROR, message);
+    }
+
+    static void debug(const string& message) {
+        write(DEBUG, message);
+    }
+
+    static void warn(const string& message) {
+        write(WARN, message);
+    }
+
+    /**
+     * Log through a rate limit, noting how many messages were suppressed
+     * @param limit per call site limiter
+     * @param level log level
+     * @param message text to log
+     */
+    static void throttled(LogRateLimit& limit, Level level, const string& message);
+
+    static bool enabled(Level level) {
+        return level >= s_level.load(memory_order_relaxed);
+    }
+
+    static void write(Level level, const string& message);
+
+    static void setLevel(Level level);
+    static bool setLevel(const string& level);
+    static void setFormat(Format format);
+    static bool setFormat(const string& format);
 
-        static void info(const std::string& message) {
-            cout << Emoji::hourglass << " " << message << endl;
+    /**
+     * Block until everything logged so far has been written
+     */
+    static void flush();
 
-        }
+    static uint64_t dropped();
 
-        static void error(const string& message) {
-            cerr << Emoji::crossMark << " " << message << endl;
-        }
+private:
+    static atomic<int> s_level;
 };
 
 
@@ -0,0 +1,207 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+
+size_t Metrics::shard() {
+    static atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, memory_order_relaxed) % c_shards;
+    return index;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : m_shards)
+        total += shard.value.load(memory_order_relaxed);
+    return total;
+}
+
+uint64_t Histogram::upperBound(int bucket) {
+    if (bucket < c_subBuckets)
+        return static_cast<uint64_t>(bucket) + 1;
+
+    int shift = bucket / c_subBuckets - 1;
+    uint64_t sub = static_cast<uint64_t>(c_subBuckets + bucket % c_subBuckets + 1);
+
+    if (shift + c_subBits + 1 >= 64 && sub >= c_subBuckets * 2)
+        return UINT64_MAX;
+
+    return sub << shift;
+}
+
+uint64_t Histogram::count() const {
+    uint64_t total = 0;
+    for (const auto& bucket : m_buckets)
+        total += bucket.load(memory_order_relaxed);
+    return total;
+}
+
+uint64_t Histogram::quantile(double q) const {
+    auto counts = snapshot();
+    auto total = accumulate(counts.begin(), counts.end(), uint64_t{0});
+    if (total == 0)
+        return 0;
+
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(total) + 0.5);
+    rank = max<uint64_t>(1, min(rank, total));
+
+    uint64_t seen = 0;
+    for (int b = 0; b < c_buckets; ++b) {
+        seen += counts[b];
+        if (seen >= rank)
+            return upperBound(b);
+    }
+
+    return UINT64_MAX;
+}
+
+vector<uint64_t> Histogram::snapshot() const {
+    vector<uint64_t> counts(c_buckets);
+    for (int b = 0; b < c_buckets; ++b)
+        counts[b] = m_buckets[b].load(memory_order_relaxed);
+    return counts;
+}
+
+MetricsRegistry::Entry* MetricsRegistry::find(const string& name, const string& labels) {
+    for (auto& entry : m_entries)
+        if (entry.name == name && entry.labels == labels)
+            return &entry;
+    return nullptr;
+}
+
+Counter& MetricsRegistry::counter(const string& name, const string& help, const string& labels) {
+    lock_guard<mutex> lock(m_lock);
+    if (auto* entry = find(name, labels))
+        return *static_cast<Counter*>(entry->metric);
+
+    auto& metric = m_counters.emplace_back();
+    m_entries.push_back({name, labels, help, COUNTER, &metric, nullptr});
+    return metric;
+}
+
+Gauge& MetricsRegistry::gauge(const string& name, const string& help, const string& labels) {
+    lock_guard<mutex> lock(m_lock);
+    if (auto* entry = find(name, labels))
+        return *static_cast<Gauge*>(entry->metric);
+
+    auto& metric = m_gauges.emplace_back();
+    m_entries.push_back({name, labels, help, GAUGE, &metric, nullptr});
+    return metric;
+}
+
+Histogram& MetricsRegistry::histogram(const string& name, const string& help, const string& labels) {
+    lock_guard<mutex> lock(m_lock);
+    if (auto* entry = find(name, labels))
+        return *static_cast<Histogram*>(entry->metric);
+
+    auto& metric = m_histograms.emplace_back();
+    m_entries.push_back({name, labels, help, HISTOGRAM, &metric, nullptr});
+    return metric;
+}
+
+void MetricsRegistry::gauge(const string& name, const string& help, const function<double()>& sample, const string& labels) {
+    lock_guard<mutex> lock(m_lock);
+    if (auto* entry = find(name, labels)) {
+        entry->sample = sample;
+        return;
+    }
+
+    m_entries.push_back({name, labels, help, GAUGE, nullptr, sample});
+}
+
+void MetricsRegistry::counter(const string& name, const string& help, const function<double()>& sample, const string& labels) {
+    lock_guard<mutex> lock(m_lock);
+    if (auto* entry = find(name, labels)) {
+        entry->sample = sample;
+        return;
+    }
+
+    m_entries.push_back({name, labels, help, COUNTER, nullptr, sample});
+}
+
+namespace {
+    string series(const string& name, const string& labels, const string& extra = "") {
+        if (labels.empty() && extra.empty())
+            return name;
+
+        string out = name + "{" + labels;
+        if (!labels.empty() && !extra.empty())
+            out += ",";
+        return out + extra + "}";
+    }
+
+    string number(double v) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.9g", v);
+        return buf;
+    }
+}
+
+string MetricsRegistry::render() {
+    static const char* types[] = {"counter", "gauge", "histogram"};
+
+    // Prometheus wants the series of one family together
+    vector<Entry> entries;
+    {
+        lock_guard<mutex> lock(m_lock);
+        entries = m_entries;
+    }
+    stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+    // bucket bounds of 1, 2.5 and 5 per decade from 1us to 100s
+    static const vector<double> bounds = [] {
+        vector<double> b;
+        for (double decade = 1e-6; decade < 1e3; decade *= 10)
+            for (double m : {1.0, 2.5, 5.0})
+                b.push_back(decade * m);
+        return b;
+    }();
+
+    string out;
+    const string* family = nullptr;
+
+    for (const auto& entry : entries) {
+        if (!family || *family != entry.name) {
+            out += "# HELP " + entry.name + " " + entry.help + "\n";
+            out += "# TYPE " + entry.name + " " + types[entry.type] + "\n";
+            family = &entry.name;
+        }
+
+        switch (entry.type) {
+            case COUNTER:
+                out += series(entry.name, entry.labels) + " " +
+                       (entry.sample ? number(entry.sample()) : to_string(static_cast<Counter*>(entry.metric)->value())) + "\n";
+                break;
+
+            case GAUGE: {
+                double v = entry.sample ? entry.sample() : static_cast<double>(static_cast<Gauge*>(entry.metric)->value());
+                out += series(entry.name, entry.labels) + " " + number(v) + "\n";
+                break;
+            }
+
+            case HISTOGRAM: {
+                auto* histogram = static_cast<Histogram*>(entry.metric);
+                auto counts = histogram->snapshot();
+                auto total = accumulate(counts.begin(), counts.end(), uint64_t{0});
+
+                uint64_t cumulative = 0;
+                int bucket = 0;
+                for (double bound : bounds) {
+                    auto boundNs = static_cast<uint64_t>(bound * 1e9);
+                    while (bucket < Histogram::c_buckets && Histogram::upperBound(bucket) <= boundNs + 1)
+                        cumulative += counts[bucket++];
+
+                    out += series(entry.name + "_bucket", entry.labels, "le=\"" + number(bound) + "\"") + " " + to_string(cumulative) + "\n";
+                }
+
+                out += series(entry.name + "_bucket", entry.labels, "le=\"+Inf\"") + " " + to_string(total) + "\n";
+                out += series(entry.name + "_sum", entry.labels) + " " + number(histogram->sum() / 1e9) + "\n";
+                out += series(entry.name + "_count", entry.labels) + " " + to_string(total) + "\n";
+                break;
+            }
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,174 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_METRICS_H
+#define MEETING_SDK_LINUX_SAMPLE_METRICS_H
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Singleton.h"
+
+using namespace std;
+
+namespace Metrics {
+    constexpr size_t c_shards = 16;
+
+    /**
+     * Index of the calling thread's shard, fixed for the life of the thread
+     */
+    size_t shard();
+
+    inline uint64_t now() {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+/**
+ * Monotonic counter split across cache-line sized shards so that threads
+ * incrementing it concurrently never share a line
+ */
+class Counter {
+    struct alignas(64) Shard {
+        atomic<uint64_t> value{0};
+    };
+
+    array<Shard, Metrics::c_shards> m_shards;
+
+public:
+    void inc(uint64_t n = 1) {
+        m_shards[Metrics::shard()].value.fetch_add(n, memory_order_relaxed);
+    }
+
+    uint64_t value() const;
+};
+
+class Gauge {
+    atomic<int64_t> m_value{0};
+
+public:
+    void set(int64_t v) { m_value.store(v, memory_order_relaxed); }
+    void add(int64_t v) { m_value.fetch_add(v, memory_order_relaxed); }
+    int64_t value() const { return m_value.load(memory_order_relaxed); }
+};
+
+/**
+ * Log-linear histogram in the style of HdrHistogram: every power of two is
+ * split into 8 linear sub-buckets, giving ~12% relative precision over the
+ * full uint64 range for two relaxed adds per record
+ */
+class Histogram {
+public:
+    static constexpr int c_subBits = 3;
+    static constexpr int c_subBuckets = 1 << c_subBits;
+    static constexpr int c_buckets = (64 - c_subBits + 1) * c_subBuckets;
+
+private:
+    array<atomic<uint64_t>, c_buckets> m_buckets{};
+    atomic<uint64_t> m_sum{0};
+
+public:
+    static int bucketOf(uint64_t v) {
+        if (v < c_subBuckets)
+            return static_cast<int>(v);
+
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - c_subBits;
+        return (shift + 1) * c_subBuckets + static_cast<int>((v >> shift) & (c_subBuckets - 1));
+    }
+
+    /**
+     * Smallest value that falls into the bucket after the given one
+     */
+    static uint64_t upperBound(int bucket);
+
+    void record(uint64_t v) {
+        m_buckets[bucketOf(v)].fetch_add(1, memory_order_relaxed);
+        m_sum.fetch_add(v, memory_order_relaxed);
+    }
+
+    uint64_t count() const;
+    uint64_t sum() const { return m_sum.load(memory_order_relaxed); }
+
+    /**
+     * Estimate a quantile from the bucket counts
+     * @param q quantile between 0 and 1
+     * @return upper bound of the bucket holding the quantile
+     */
+    uint64_t quantile(double q) const;
+
+    vector<uint64_t> snapshot() const;
+};
+
+/**
+ * Records the time from construction to destruction into a histogram in ns
+ */
+class ScopedTimer {
+    Histogram& m_histogram;
+    uint64_t m_start;
+
+public:
+    explicit ScopedTimer(Histogram& histogram) : m_histogram(histogram), m_start(Metrics::now()) {}
+    ~ScopedTimer() { m_histogram.record(Metrics::now() - m_start); }
+};
+
+/**
+ * Process-wide registry rendered in the Prometheus text format.
+ *
+ * Metrics are created once, usually into a function-local static reference at
+ * the call site, and live for the rest of the process. Histograms record
+ * nanoseconds and are exported in seconds.
+ */
+class MetricsRegistry : public Singleton<MetricsRegistry> {
+
+    friend class Singleton<MetricsRegistry>;
+
+    enum Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    struct Entry {
+        string name;
+        string labels;
+        string help;
+        Type type;
+        void* metric;
+        function<double()> sample;
+    };
+
+    mutex m_lock;
+    deque<Counter> m_counters;
+    deque<Gauge> m_gauges;
+    deque<Histogram> m_histograms;
+    vector<Entry> m_entries;
+
+    Entry* find(const string& name, const string& labels);
+
+public:
+    Counter& counter(const string& name, const string& help, const string& labels = "");
+    Gauge& gauge(const string& name, const string& help, const string& labels = "");
+    Histogram& histogram(const string& name, const string& help, const string& labels = "");
+
+    /**
+     * Register a gauge whose value is sampled at scrape time, e.g. a queue depth
+     */
+    void gauge(const string& name, const string& help, const function<double()>& sample, const string& labels = "");
+
+    /**
+     * Register a counter whose value is sampled at scrape time, for totals
+     * kept elsewhere such as the CPU time the kernel reports; the sample must
+     * never decrease
+     */
+    void counter(const string& name, const string& help, const function<double()>& sample, const string& labels = "");
+
+    string render();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_METRICS_H
@@ -0,0 +1,88 @@
+#include "MetricsServer.h"
+
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/URI.h>
+
+#include "Log.h"
+#include "Metrics.h"
+
+namespace {
+    class RouteHandler : public Poco::Net::HTTPRequestHandler {
+        const map<string, MetricsServer::Route>& m_routes;
+
+    public:
+        explicit RouteHandler(const map<string, MetricsServer::Route>& routes) : m_routes(routes) {}
+
+        void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override {
+            auto path = Poco::URI(request.getURI()).getPath();
+            auto it = m_routes.find(path);
+
+            if (it == m_routes.end()) {
+                response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+                response.send() << "not found\n";
+                return;
+            }
+
+            auto body = it->second.body();
+            response.setContentType(it->second.contentType);
+            response.setContentLength(static_cast<streamsize>(body.size()));
+            response.send() << body;
+        }
+    };
+
+    class RouteHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+        const map<string, MetricsServer::Route>& m_routes;
+
+    public:
+        explicit RouteHandlerFactory(const map<string, MetricsServer::Route>& routes) : m_routes(routes) {}
+
+        Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&) override {
+            return new RouteHandler(m_routes);
+        }
+    };
+}
+
+MetricsServer::MetricsServer() {
+    addRoute("/metrics", "text/plain; version=0.0.4", []() {
+        return MetricsRegistry::getInstance().render();
+    });
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::addRoute(const string& path, const string& contentType, const function<string()>& body) {
+    m_routes[path] = {contentType, body};
+}
+
+bool MetricsServer::start(unsigned short port) {
+    try {
+        Poco::Net::ServerSocket socket(Poco::Net::SocketAddress("127.0.0.1", port));
+
+        auto* params = new Poco::Net::HTTPServerParams();
+        params->setMaxThreads(2);
+        params->setKeepAlive(false);
+
+        m_server = make_unique<Poco::Net::HTTPServer>(new RouteHandlerFactory(m_routes), socket, params);
+        m_server->start();
+    } catch (const Poco::Exception& ex) {
+        Log::error("failed to start metrics server on port " + to_string(port) + ": " + ex.displayText());
+        return false;
+    }
+
+    Log::info("serving metrics on http://127.0.0.1:" + to_string(port) + "/metrics");
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (m_server) {
+        m_server->stopAll(true);
+        m_server.reset();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_METRICSSERVER_H
+#define MEETING_SDK_LINUX_SAMPLE_METRICSSERVER_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <Poco/Net/HTTPServer.h>
+
+using namespace std;
+
+/**
+ * Local HTTP endpoint serving the metrics registry at /metrics in the
+ * Prometheus text format, plus any extra routes registered before start()
+ */
+class MetricsServer {
+public:
+    struct Route {
+        string contentType;
+        function<string()> body;
+    };
+
+private:
+    map<string, Route> m_routes;
+    unique_ptr<Poco::Net::HTTPServer> m_server;
+
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    void addRoute(const string& path, const string& contentType, const function<string()>& body);
+
+    /**
+     * Listen on the loopback interface
+     * @param port TCP port
+     * @return false if the port could not be bound
+     */
+    bool start(unsigned short port);
+    void stop();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_METRICSSERVER_H
@@ -0,0 +1,123 @@
+#include "ProcessStats.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "Metrics.h"
+#include "Threads.h"
+
+namespace {
+    // utime and stime are fields 14 and 15, num_threads is 20; comm may hold spaces, so start after its ')'
+    bool readStat(const string& path, ProcessStats::Sample& sample) {
+        auto* file = fopen(path.c_str(), "re");
+        if (!file)
+            return false;
+
+        char buf[1024];
+        size_t n = fread(buf, 1, sizeof(buf) - 1, file);
+        fclose(file);
+        buf[n] = '\0';
+
+        unsigned long long utime = 0, stime = 0;
+        long threads = 0;
+        auto* rest = strrchr(buf, ')');
+        if (!rest || sscanf(rest + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %ld",
+                            &utime, &stime, &threads) != 3)
+            return false;
+
+        sample.cpuSeconds = static_cast<double>(utime + stime) / static_cast<double>(sysconf(_SC_CLK_TCK));
+        sample.threads = static_cast<size_t>(threads);
+        return true;
+    }
+
+    // adds voluntary_ctxt_switches and nonvoluntary_ctxt_switches from one status file
+    void addSwitches(const string& path, ProcessStats::Sample& sample) {
+        auto* file = fopen(path.c_str(), "re");
+        if (!file)
+            return;
+
+        char line[256];
+        unsigned long long value;
+        while (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1)
+                sample.voluntarySwitches += value;
+            else if (sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)
+                sample.involuntarySwitches += value;
+        }
+
+        fclose(file);
+    }
+}
+
+ProcessStats::Sample ProcessStats::read() {
+    Sample sample;
+
+    readStat("/proc/self/stat", sample);
+
+    // unlike summing /proc/self/task, this keeps the switches of threads that have exited, so it never goes down
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        sample.voluntarySwitches = static_cast<uint64_t>(usage.ru_nvcsw);
+        sample.involuntarySwitches = static_cast<uint64_t>(usage.ru_nivcsw);
+    }
+
+    return sample;
+}
+
+ProcessStats::Sample ProcessStats::task(pid_t tid) {
+    Sample sample;
+
+    auto dir = "/proc/self/task/" + to_string(tid);
+    if (!readStat(dir + "/stat", sample))
+        return {};
+
+    sample.threads = 1;
+    addSwitches(dir + "/status", sample);
+    return sample;
+}
+
+ProcessStats::Sample ProcessStats::role(const string& role) {
+    Sample sample;
+
+    for (auto tid : Threads::tids(role)) {
+        auto thread = task(tid);
+        sample.cpuSeconds += thread.cpuSeconds;
+        sample.threads += thread.threads;
+        sample.voluntarySwitches += thread.voluntarySwitches;
+        sample.involuntarySwitches += thread.involuntarySwitches;
+    }
+
+    auto exited = Threads::exited(role);
+    sample.cpuSeconds += exited.cpuSeconds;
+    sample.voluntarySwitches += exited.voluntarySwitches;
+    sample.involuntarySwitches += exited.involuntarySwitches;
+    return sample;
+}
+
+void ProcessStats::expose() {
+    auto& registry = MetricsRegistry::getInstance();
+    registry.counter("zoomsdk_process_cpu_seconds_total", "User and system CPU time used by the process",
+                     []() { return read().cpuSeconds; });
+    registry.gauge("zoomsdk_process_threads", "Threads in the process",
+                   []() { return static_cast<double>(read().threads); });
+    registry.counter("zoomsdk_process_context_switches_total", "Context switches of every thread, including exited ones; voluntary ones are wakeups",
+                     []() { return static_cast<double>(read().voluntarySwitches); }, "kind=\"voluntary\"");
+    registry.counter("zoomsdk_process_context_switches_total", "Context switches of every thread, including exited ones; voluntary ones are wakeups",
+                     []() { return static_cast<double>(read().involuntarySwitches); }, "kind=\"involuntary\"");
+
+    // one set per role, so a noisy writer can be told apart from the audio path
+    for (const auto& name : Threads::roles()) {
+        auto label = "thread=\"" + name + "\"";
+        registry.counter("zoomsdk_thread_cpu_seconds_total", "User and system CPU time used by the bot's threads of each role",
+                         [name]() { return role(name).cpuSeconds; }, label);
+        registry.gauge("zoomsdk_threads", "Running threads of each role",
+                       [name]() { return static_cast<double>(role(name).threads); }, label);
+        registry.counter("zoomsdk_thread_context_switches_total", "Context switches of the bot's threads of each role",
+                         [name]() { return static_cast<double>(role(name).voluntarySwitches); }, label + ",kind=\"voluntary\"");
+        registry.counter("zoomsdk_thread_context_switches_total", "Context switches of the bot's threads of each role",
+                         [name]() { return static_cast<double>(role(name).involuntarySwitches); }, label + ",kind=\"involuntary\"");
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_PROCESSSTATS_H
+#define MEETING_SDK_LINUX_SAMPLE_PROCESSSTATS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+
+using namespace std;
+
+/**
+ * What the process costs while it waits: CPU time, thread count and how
+ * often its threads went to sleep and woke up again, read from /proc and
+ * getrusage().
+ *
+ * Each voluntary context switch is a thread blocking, so its rate while the
+ * meeting is quiet is the idle wakeup rate.
+ */
+namespace ProcessStats {
+    struct Sample {
+        double cpuSeconds = 0;
+        size_t threads = 0;
+        uint64_t voluntarySwitches = 0;
+        uint64_t involuntarySwitches = 0;
+    };
+
+    /**
+     * @return counters summed over every thread of this process, including those that exited
+     */
+    Sample read();
+
+    /**
+     * @return counters of one thread of this process, zero if it has exited
+     */
+    Sample task(pid_t tid);
+
+    /**
+     * @return counters summed over the threads registered under a Threads role, including those that exited
+     */
+    Sample role(const string& role);
+
+    /**
+     * Register zoomsdk_process_* and per-role zoomsdk_thread_* metrics, sampled at scrape time
+     */
+    void expose();
+}
+
+#endif //MEETING_SDK_LINUX_SAMPLE_PROCESSSTATS_H
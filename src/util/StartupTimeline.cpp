@@ -0,0 +1,103 @@
+#include "StartupTimeline.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "Log.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+namespace {
+    string milliseconds(uint64_t ns) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.1f", ns / 1e6);
+        return buf;
+    }
+}
+
+StartupTimeline::StartupTimeline() : m_originNs(Metrics::now()) {}
+
+StartupTimeline::Scope::Scope(const char* name) : m_name(name), m_start(Metrics::now()) {}
+
+StartupTimeline::Scope::~Scope() {
+    StartupTimeline::getInstance().record(m_name, m_start, Metrics::now());
+}
+
+void StartupTimeline::record(const char* phase, uint64_t startNs, uint64_t endNs) {
+    {
+        lock_guard<mutex> lock(m_lock);
+        for (const auto& p : m_phases)
+            if (string(p.name) == phase)
+                return;
+        m_phases.push_back({phase, startNs, endNs});
+    }
+
+    double seconds = (endNs - min(endNs, startNs)) / 1e9;
+    MetricsRegistry::getInstance().gauge("zoomsdk_startup_phase_seconds", "How long each startup phase took",
+                                         [seconds]() { return seconds; }, string("phase=\"") + phase + "\"");
+}
+
+void StartupTimeline::mark(const char* milestone) {
+    auto now = Metrics::now();
+    {
+        lock_guard<mutex> lock(m_lock);
+        for (const auto& m : m_milestones)
+            if (string(m.name) == milestone)
+                return;
+        m_milestones.push_back({milestone, now});
+    }
+
+    double seconds = (now - m_originNs) / 1e9;
+    MetricsRegistry::getInstance().gauge("zoomsdk_startup_milestone_seconds", "Time from launch to each startup milestone",
+                                         [seconds]() { return seconds; }, string("milestone=\"") + milestone + "\"");
+}
+
+void StartupTimeline::finish(const char* milestone) {
+    mark(milestone);
+
+    vector<Phase> phases;
+    {
+        lock_guard<mutex> lock(m_lock);
+        if (m_finished)
+            return;
+        m_finished = true;
+        phases = m_phases;
+    }
+
+    // phases ran before tracing could be turned on, so they are written now
+    if (Trace::enabled())
+        for (const auto& phase : phases)
+            Trace::record(phase.name, "startup", phase.startNs, phase.endNs - min(phase.endNs, phase.startNs));
+
+    Log::info("startup: " + report());
+}
+
+string StartupTimeline::report() {
+    lock_guard<mutex> lock(m_lock);
+
+    struct Entry {
+        uint64_t atNs;
+        string text;
+    };
+
+    vector<Entry> entries;
+    for (const auto& phase : m_phases) {
+        auto start = phase.startNs - min(phase.startNs, m_originNs);
+        entries.push_back({start, string(phase.name) + " " + milliseconds(start) + "+" +
+                                  milliseconds(phase.endNs - min(phase.endNs, phase.startNs)) + "ms"});
+    }
+    for (const auto& milestone : m_milestones) {
+        auto at = milestone.atNs - min(milestone.atNs, m_originNs);
+        entries.push_back({at, string(milestone.name) + " @" + milliseconds(at) + "ms"});
+    }
+
+    stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.atNs < b.atNs; });
+
+    string out;
+    for (const auto& entry : entries) {
+        if (!out.empty())
+            out += ", ";
+        out += entry.text;
+    }
+    return out;
+}
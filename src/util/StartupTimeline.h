@@ -0,0 +1,81 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_STARTUPTIMELINE_H
+#define MEETING_SDK_LINUX_SAMPLE_STARTUPTIMELINE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Singleton.h"
+
+using namespace std;
+
+/**
+ * When each stage of startup ran, from launch to the first transcript.
+ *
+ * Phases have a start and an end and may run side by side; milestones are
+ * single moments such as joining the meeting. Times are kept relative to
+ * the first call to getInstance(), which main() makes before anything else.
+ * Once the first transcript arrives, finish() writes the breakdown to the
+ * log and, if tracing is on, to the trace ring, so a phase holding up the
+ * next one shows as a gap. Names must be string literals.
+ */
+class StartupTimeline : public Singleton<StartupTimeline> {
+
+    friend class Singleton<StartupTimeline>;
+
+    struct Phase {
+        const char* name;
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    struct Milestone {
+        const char* name;
+        uint64_t atNs;
+    };
+
+    mutex m_lock;
+    uint64_t m_originNs;
+    vector<Phase> m_phases;
+    vector<Milestone> m_milestones;
+    bool m_finished = false;
+
+    StartupTimeline();
+
+public:
+    /**
+     * Records the phase from construction to destruction
+     */
+    class Scope {
+        const char* m_name;
+        uint64_t m_start;
+
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+    };
+
+    /**
+     * Record a phase once; later runs of the same phase are not startup
+     * @param startNs steady clock start in ns, as from Metrics::now()
+     */
+    void record(const char* phase, uint64_t startNs, uint64_t endNs);
+
+    /**
+     * Record a milestone the first time it is reached
+     */
+    void mark(const char* milestone);
+
+    /**
+     * Mark the end of startup and report the breakdown, once
+     */
+    void finish(const char* milestone);
+
+    /**
+     * @return phases and milestones in order of their start, as offsets from launch
+     */
+    string report();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_STARTUPTIMELINE_H
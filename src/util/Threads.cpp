@@ -0,0 +1,337 @@
+#include "Threads.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sched.h>
+#include <sstream>
+#include <system_error>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "Log.h"
+
+namespace {
+    const vector<string> c_roles = {
+        "sdk-audio", "io", "log", "transcript-log", "video-writer", "uplink-connect", "hedge-connect", "gateway-connect"
+    };
+
+    struct Policy {
+        bool hasCpus = false;
+        cpu_set_t cpus{};
+        // SCHED_FIFO priority, 0 to keep the default policy
+        int fifo = 0;
+        bool hasNice = false;
+        int nice = 0;
+        size_t stack = 0;
+        // a missing capability is reported once per role, not once per thread
+        bool warned = false;
+    };
+
+    struct Registry {
+        mutex lock;
+        map<string, Policy> policies;
+        map<pid_t, string> threads;
+        map<string, Threads::Usage> exited;
+    };
+
+    Registry& registry() {
+        // never destroyed: detached threads may still leave during exit
+        static auto* registry = new Registry();
+        return *registry;
+    }
+
+    thread_local const char* t_role = nullptr;
+
+    struct Start {
+        const char* role;
+        function<void()> body;
+    };
+
+    pid_t currentTid() {
+        return static_cast<pid_t>(syscall(SYS_gettid));
+    }
+
+    bool parseCpus(Policy& policy, const string& value) {
+        CPU_ZERO(&policy.cpus);
+
+        stringstream ranges(value);
+        for (string range; getline(ranges, range, ',');) {
+            unsigned first, last;
+            int end = 0;
+            if (sscanf(range.c_str(), "%u-%u%n", &first, &last, &end) != 2 || end != static_cast<int>(range.size())) {
+                end = 0;
+                if (sscanf(range.c_str(), "%u%n", &first, &end) != 1 || end != static_cast<int>(range.size()))
+                    return false;
+                last = first;
+            }
+
+            if (first > last || last >= CPU_SETSIZE)
+                return false;
+
+            for (auto cpu = first; cpu <= last; ++cpu)
+                CPU_SET(cpu, &policy.cpus);
+        }
+
+        policy.hasCpus = CPU_COUNT(&policy.cpus) > 0;
+        return policy.hasCpus;
+    }
+
+    bool parsePriority(Policy& policy, const string& value) {
+        int level, end = 0;
+        auto whole = [&]() { return end == static_cast<int>(value.size()); };
+
+        if (sscanf(value.c_str(), "fifo:%d%n", &level, &end) == 1 && whole() && level >= 1 && level <= 99) {
+            policy.fifo = level;
+            return true;
+        }
+
+        end = 0;
+        if (sscanf(value.c_str(), "nice:%d%n", &level, &end) == 1 && whole() && level >= -20 && level <= 19) {
+            policy.hasNice = true;
+            policy.nice = level;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool parseStack(Policy& policy, const string& value) {
+        char* end;
+        auto size = strtoull(value.c_str(), &end, 10);
+        if (end == value.c_str())
+            return false;
+
+        if (*end == 'k' || *end == 'K') {
+            size <<= 10;
+            ++end;
+        } else if (*end == 'm' || *end == 'M') {
+            size <<= 20;
+            ++end;
+        }
+
+        if (*end || size < static_cast<unsigned long long>(PTHREAD_STACK_MIN))
+            return false;
+
+        auto page = static_cast<unsigned long long>(sysconf(_SC_PAGESIZE));
+        policy.stack = static_cast<size_t>((size + page - 1) / page * page);
+        return true;
+    }
+
+    /**
+     * Apply each "role=value" entry of an option to that role's policy
+     */
+    bool parse(map<string, Policy>& policies, const string& option, const char* name, bool (*apply)(Policy&, const string&)) {
+        istringstream entries(option);
+        for (string entry; entries >> entry;) {
+            auto eq = entry.find('=');
+            auto role = entry.substr(0, eq);
+
+            if (eq == string::npos || find(c_roles.begin(), c_roles.end(), role) == c_roles.end()) {
+                string known;
+                for (const auto& r : c_roles)
+                    known += (known.empty() ? "" : ", ") + r;
+                Log::error(string(name) + ": expected <role>=<value> in \"" + entry + "\", roles are " + known);
+                return false;
+            }
+
+            if (!apply(policies[role], entry.substr(eq + 1))) {
+                Log::error(string(name) + ": invalid value in \"" + entry + "\"");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void place(pid_t tid, const string& role, Policy& policy) {
+        string failed;
+
+        if (policy.hasCpus && sched_setaffinity(tid, sizeof(policy.cpus), &policy.cpus) != 0)
+            failed += " affinity (" + string(strerror(errno)) + ")";
+
+        if (policy.fifo) {
+            sched_param param{};
+            param.sched_priority = policy.fifo;
+            if (sched_setscheduler(tid, SCHED_FIFO, &param) != 0)
+                failed += " SCHED_FIFO (" + string(strerror(errno)) + ", needs CAP_SYS_NICE or an rtprio limit)";
+        }
+
+        if (policy.hasNice && setpriority(PRIO_PROCESS, static_cast<id_t>(tid), policy.nice) != 0)
+            failed += " nice (" + string(strerror(errno)) + ")";
+
+        if (!failed.empty() && !policy.warned) {
+            policy.warned = true;
+            Log::warn("unable to set" + failed + " for " + role + " threads");
+        }
+    }
+}
+
+bool Threads::configure(const string& cpus, const string& priority, const string& stacks) {
+    map<string, Policy> policies;
+    if (!parse(policies, cpus, "thread-cpus", parseCpus) ||
+        !parse(policies, priority, "thread-priority", parsePriority) ||
+        !parse(policies, stacks, "thread-stack", parseStack))
+        return false;
+
+    auto& r = registry();
+    lock_guard<mutex> lock(r.lock);
+    r.policies = std::move(policies);
+
+    // threads started before the config was read, such as io and log, are placed now
+    for (const auto& entry : r.threads) {
+        auto it = r.policies.find(entry.second);
+        if (it != r.policies.end())
+            place(entry.first, entry.second, it->second);
+    }
+
+    return true;
+}
+
+void Threads::adopt(const char* role) {
+    if (t_role)
+        return;
+    t_role = role;
+
+    auto tid = currentTid();
+
+    // renaming the main thread would rename the process
+    if (tid != getpid())
+        pthread_setname_np(pthread_self(), role);
+
+    auto& r = registry();
+    lock_guard<mutex> lock(r.lock);
+    r.threads[tid] = role;
+
+    auto it = r.policies.find(role);
+    if (it != r.policies.end())
+        place(tid, role, it->second);
+}
+
+void Threads::leave() {
+    if (!t_role)
+        return;
+
+    rusage usage{};
+    getrusage(RUSAGE_THREAD, &usage);
+
+    auto& r = registry();
+    lock_guard<mutex> lock(r.lock);
+
+    auto& total = r.exited[t_role];
+    total.cpuSeconds += static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+                        static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    total.voluntarySwitches += static_cast<uint64_t>(usage.ru_nvcsw);
+    total.involuntarySwitches += static_cast<uint64_t>(usage.ru_nivcsw);
+
+    r.threads.erase(currentTid());
+    t_role = nullptr;
+}
+
+size_t Threads::stackSize(const char* role) {
+    auto& r = registry();
+    lock_guard<mutex> lock(r.lock);
+
+    auto it = r.policies.find(role);
+    return it == r.policies.end() ? 0 : it->second.stack;
+}
+
+const vector<string>& Threads::roles() {
+    return c_roles;
+}
+
+vector<pid_t> Threads::tids(const string& role) {
+    auto& r = registry();
+    lock_guard<mutex> lock(r.lock);
+
+    vector<pid_t> tids;
+    for (const auto& entry : r.threads)
+        if (entry.second == role)
+            tids.push_back(entry.first);
+
+    return tids;
+}
+
+Threads::Usage Threads::exited(const string& role) {
+    auto& r = registry();
+    lock_guard<mutex> lock(r.lock);
+
+    auto it = r.exited.find(role);
+    return it == r.exited.end() ? Usage{} : it->second;
+}
+
+Thread::Thread(const char* role, function<void()> body) {
+    auto* start = new Start{role, std::move(body)};
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (auto stack = Threads::stackSize(role))
+        pthread_attr_setstacksize(&attr, stack);
+
+    auto err = pthread_create(&m_handle, &attr, entry, start);
+    pthread_attr_destroy(&attr);
+
+    if (err) {
+        delete start;
+        throw system_error(err, generic_category(), string("unable to start a ") + role + " thread");
+    }
+
+    m_joinable = true;
+}
+
+void* Thread::entry(void* arg) {
+    unique_ptr<Start> start(static_cast<Start*>(arg));
+
+    Threads::adopt(start->role);
+    start->body();
+    Threads::leave();
+
+    return nullptr;
+}
+
+Thread::Thread(Thread&& other) noexcept : m_handle(other.m_handle), m_joinable(other.m_joinable) {
+    other.m_joinable = false;
+}
+
+Thread& Thread::operator=(Thread&& other) noexcept {
+    if (m_joinable)
+        terminate();
+
+    m_handle = other.m_handle;
+    m_joinable = other.m_joinable;
+    other.m_joinable = false;
+    return *this;
+}
+
+Thread::~Thread() {
+    if (m_joinable)
+        terminate();
+}
+
+bool Thread::joinable() const {
+    return m_joinable;
+}
+
+void Thread::join() {
+    if (!m_joinable)
+        return;
+
+    pthread_join(m_handle, nullptr);
+    m_joinable = false;
+}
+
+void Thread::detach() {
+    if (!m_joinable)
+        return;
+
+    pthread_detach(m_handle);
+    m_joinable = false;
+}
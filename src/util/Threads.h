@@ -0,0 +1,100 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_THREADS_H
+#define MEETING_SDK_LINUX_SAMPLE_THREADS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
+
+using namespace std;
+
+/**
+ * Every thread the bot starts, and the SDK threads it runs on, registered
+ * under a role so each role can be placed from the config: the CPUs it may
+ * run on, SCHED_FIFO or a nice level, and the stack size of threads started
+ * after the config is read.
+ *
+ * Roles are fixed and double as thread names (15 characters at most):
+ *   sdk-audio        the SDK thread delivering raw audio
+ *   io               IoLoop
+ *   log              Log flusher
+ *   transcript-log   TranscriptLogWriter group commits
+ *   video-writer     VideoFrameWriter
+ *   uplink-connect   AdaptiveUplink reconnects
+ *   hedge-connect    HedgedSession leg connects
+ *   gateway-connect  Gateway stream connects
+ */
+namespace Threads {
+    struct Usage {
+        double cpuSeconds = 0;
+        uint64_t voluntarySwitches = 0;
+        uint64_t involuntarySwitches = 0;
+    };
+
+    /**
+     * Parse the placement options and apply them to the threads already running
+     * @param cpus e.g. "sdk-audio=2 io=3 log=0-1,4"
+     * @param priority e.g. "sdk-audio=fifo:20 log=nice:10"
+     * @param stacks e.g. "io=256k gateway-connect=128k"
+     * @return false if an option does not parse or names an unknown role
+     */
+    bool configure(const string& cpus, const string& priority, const string& stacks);
+
+    /**
+     * Register the calling thread under the role and place it; later calls
+     * from the same thread do nothing, so it is cheap to call per callback
+     */
+    void adopt(const char* role);
+
+    /**
+     * Unregister the calling thread, adding what it used to its role's total
+     */
+    void leave();
+
+    /**
+     * @return stack size for new threads of the role, 0 for the default
+     */
+    size_t stackSize(const char* role);
+
+    const vector<string>& roles();
+
+    /**
+     * @return thread ids currently registered under the role
+     */
+    vector<pid_t> tids(const string& role);
+
+    /**
+     * @return what threads of the role that have already exited used
+     */
+    Usage exited(const string& role);
+}
+
+/**
+ * std::thread with a role: named, registered and placed before the body
+ * runs, with the role's stack size. Joinable threads must be joined or
+ * detached before they are destroyed, as with std::thread.
+ */
+class Thread {
+    pthread_t m_handle{};
+    bool m_joinable = false;
+
+    static void* entry(void* arg);
+
+public:
+    Thread() = default;
+    Thread(const char* role, function<void()> body);
+    Thread(Thread&& other) noexcept;
+    Thread& operator=(Thread&& other) noexcept;
+    ~Thread();
+
+    Thread(const Thread&) = delete;
+    Thread& operator=(const Thread&) = delete;
+
+    bool joinable() const;
+    void join();
+    void detach();
+};
+
+#endif //MEETING_SDK_LINUX_SAMPLE_THREADS_H
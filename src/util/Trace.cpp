@@ -0,0 +1,94 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <memory>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace {
+    struct Slot {
+        atomic<uint64_t> sequence{0};
+        const char* name;
+        const char* category;
+        uint64_t start;
+        uint64_t duration;
+        uint32_t tid;
+    };
+
+    atomic<bool> s_enabled{false};
+    unique_ptr<Slot[]> s_slots;
+    size_t s_capacity = 0;
+    atomic<uint64_t> s_next{0};
+
+    uint32_t threadId() {
+        thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        return tid;
+    }
+}
+
+void Trace::enable(size_t capacity) {
+    if (s_enabled)
+        return;
+
+    s_slots.reset(new Slot[capacity]);
+    s_capacity = capacity;
+    s_enabled.store(true, memory_order_release);
+}
+
+bool Trace::enabled() {
+    return s_enabled.load(memory_order_relaxed);
+}
+
+void Trace::record(const char* name, const char* category, uint64_t startNs, uint64_t durationNs) {
+    if (!s_enabled.load(memory_order_acquire))
+        return;
+
+    auto index = s_next.fetch_add(1, memory_order_relaxed);
+    auto& slot = s_slots[index % s_capacity];
+
+    // odd while the slot is being written so a concurrent dump can skip it
+    slot.sequence.store(index * 2 + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.name = name;
+    slot.category = category;
+    slot.start = startNs;
+    slot.duration = durationNs;
+    slot.tid = threadId();
+    slot.sequence.store(index * 2 + 2, memory_order_release);
+}
+
+string Trace::dump() {
+    string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    if (!s_enabled)
+        return out + "]}";
+
+    auto end = s_next.load(memory_order_acquire);
+    auto begin = end > s_capacity ? end - s_capacity : 0;
+    auto pid = static_cast<int>(getpid());
+    bool first = true;
+
+    for (auto index = begin; index < end; ++index) {
+        auto& slot = s_slots[index % s_capacity];
+
+        auto before = slot.sequence.load(memory_order_acquire);
+        Slot copy;
+        copy.name = slot.name;
+        copy.category = slot.category;
+        copy.start = slot.start;
+        copy.duration = slot.duration;
+        copy.tid = slot.tid;
+        atomic_thread_fence(memory_order_acquire);
+
+        if (before != index * 2 + 2 || slot.sequence.load(memory_order_relaxed) != before)
+            continue;
+
+        char event[256];
+        snprintf(event, sizeof(event),
+                 "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+                 first ? "" : ",", copy.name, copy.category, copy.start / 1e3, copy.duration / 1e3, pid, copy.tid);
+        out += event;
+        first = false;
+    }
+
+    return out + "]}";
+}
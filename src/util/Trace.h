@@ -0,0 +1,52 @@
+#ifndef MEETING_SDK_LINUX_SAMPLE_TRACE_H
+#define MEETING_SDK_LINUX_SAMPLE_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "Metrics.h"
+
+using namespace std;
+
+/**
+ * Fixed-size ring of completed spans that can be dumped as Chrome trace-event
+ * JSON (chrome://tracing, Perfetto). Recording is off until enable() is called
+ * and then costs one atomic increment and a slot write per span. Span names
+ * must be string literals.
+ */
+namespace Trace {
+    void enable(size_t capacity = 1 << 16);
+    bool enabled();
+
+    /**
+     * Record a completed span
+     * @param name stage name
+     * @param category grouping shown by the trace viewer
+     * @param startNs steady clock start in ns, as from Metrics::now()
+     * @param durationNs span length in ns
+     */
+    void record(const char* name, const char* category, uint64_t startNs, uint64_t durationNs);
+
+    /**
+     * Render the spans currently in the ring as a trace-event JSON document
+     */
+    string dump();
+
+    class Span {
+        const char* m_name;
+        const char* m_category;
+        uint64_t m_start;
+
+    public:
+        Span(const char* name, const char* category)
+            : m_name(name), m_category(category), m_start(enabled() ? Metrics::now() : 0) {}
+
+        ~Span() {
+            if (m_start)
+                record(m_name, m_category, m_start, Metrics::now() - m_start);
+        }
+    };
+}
+
+#endif //MEETING_SDK_LINUX_SAMPLE_TRACE_H
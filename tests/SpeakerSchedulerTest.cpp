@@ -0,0 +1,184 @@
+// SpeakerSchedulerTest.cpp
+// Session assignment, preemption and keep-alive rules of SpeakerScheduler, against a fake engine
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/raw-stream/SpeakerScheduler.h"
+#include "../src/util/Metrics.h"
+
+using namespace std;
+
+namespace {
+    struct FakeBackend : TranscriptionBackend {
+        bool opened = false;
+        size_t pushes = 0;
+        size_t flushes = 0;
+        size_t keepAlives = 0;
+
+        bool open(int, int, const string&) override { return opened = true; }
+        bool push(char*, size_t) override { ++pushes; return true; }
+        bool flush() override { ++flushes; return true; }
+        bool keepAlive() override { ++keepAlives; return true; }
+        bool closeStream() override { return true; }
+        void close() override { opened = false; }
+        bool isOpen() const override { return opened; }
+        void setOnResult(const function<void(DeepgramResults&)>&) override {}
+    };
+
+    // in the order the scheduler opened them, one per session
+    vector<FakeBackend*> g_backends;
+
+    int g_failures = 0;
+
+    void check(bool ok, const string& what) {
+        if (!ok) {
+            cerr << "FAIL: " << what << endl;
+            ++g_failures;
+        }
+    }
+
+    /**
+     * Feeds 10 ms frames of 16 kHz mono, one per speaking node per step, as the SDK does
+     */
+    struct Harness {
+        SpeakerScheduler scheduler;
+        uint64_t now = 1000000000;
+        vector<int16_t> frame = vector<int16_t>(160);
+
+        explicit Harness(const SpeakerScheduler::Options& options) : scheduler(options) {
+            g_backends.clear();
+            scheduler.setBackend({});
+        }
+
+        void send(uint32_t node, int16_t amplitude) {
+            for (size_t i = 0; i < frame.size(); ++i)
+                frame[i] = i % 2 ? amplitude : static_cast<int16_t>(-amplitude);
+            scheduler.onAudio(node, reinterpret_cast<char*>(frame.data()), frame.size() * sizeof(int16_t), 16000, 1, now);
+        }
+
+        /**
+         * @param nodes each node and the amplitude it sends every step, 0 for silence
+         */
+        void run(int ms, const vector<pair<uint32_t, int16_t>>& nodes) {
+            for (int t = 0; t < ms; t += 10) {
+                for (const auto& node : nodes)
+                    send(node.first, node.second);
+                now += 10000000;
+            }
+        }
+    };
+
+    constexpr int16_t c_loud = 16000;
+    constexpr int16_t c_quiet = 400;
+
+    void assignsFreeSessionsWithPreRoll() {
+        Harness h({});
+
+        // silence fills the pre-roll, then the first voiced frame takes a session
+        h.run(500, {{1, 0}});
+        check(g_backends.empty(), "silence does not open a session");
+
+        h.send(1, c_loud);
+        check(g_backends.size() == 1, "a speaker opens a session");
+        // 300 ms of pre-roll is 30 frames, then the voiced frame itself
+        check(g_backends.size() == 1 && g_backends[0]->pushes == 31, "the pre-roll is sent before the first voiced frame");
+
+        h.now += 10000000;
+        h.send(2, c_loud);
+        check(g_backends.size() == 2, "a second speaker takes the second session");
+    }
+
+    void holdsAndHangover() {
+        Harness h({});
+
+        h.run(100, {{1, c_loud}, {2, c_loud}});
+        auto pushes = g_backends[0]->pushes + g_backends[1]->pushes;
+
+        // a third speaker waits while both are held and still speaking
+        h.run(1000, {{1, c_loud}, {2, c_loud}, {3, c_loud}});
+        check(g_backends[0]->flushes == 0 && g_backends[1]->flushes == 0, "no session is taken within the hold time");
+        check(g_backends[0]->pushes + g_backends[1]->pushes == pushes + 200, "only the assigned speakers are sent");
+
+        // once node 1 has been silent for the hangover, node 3 takes its session
+        h.run(1600, {{1, 0}, {2, c_loud}, {3, c_loud}});
+        check(g_backends[0]->flushes == 1, "the silent speaker's session is flushed and handed over");
+        check(g_backends[1]->flushes == 0, "the session of a speaker still talking is kept");
+
+        auto& speaking = MetricsRegistry::getInstance().gauge("zoomsdk_scheduler_speaking_nodes", "");
+        check(speaking.value() == 2, "a speaker silent for the hangover no longer counts as speaking");
+    }
+
+    void louderSpeakerPreempts() {
+        SpeakerScheduler::Options options;
+        options.sessions = 1;
+        Harness h(options);
+
+        h.run(2100, {{1, c_quiet}});
+        check(g_backends.size() == 1 && g_backends[0]->flushes == 0, "a quiet speaker holds the only session");
+
+        // louder by far more than the margin, past the hold time
+        h.run(100, {{1, c_quiet}, {2, c_loud}});
+        check(g_backends[0]->flushes == 1, "a much louder speaker takes the session");
+
+        // the quiet speaker cannot take it back within the hold time, nor by level
+        h.run(1000, {{1, c_quiet}, {2, c_loud}});
+        check(g_backends[0]->flushes == 1, "the new holder keeps the session");
+    }
+
+    void keepAliveOnlyWhenIdle() {
+        Harness h({});
+
+        h.run(100, {{1, c_loud}, {2, c_loud}});
+
+        // node 1 keeps talking, node 2 stays silent but keeps its session
+        h.run(12000, {{1, c_loud}, {2, 0}});
+        check(g_backends[0]->keepAlives == 0, "a session sent audio every frame gets no keep-alive");
+
+        // node 2's frames are still sent while it holds the session, so nothing is idle
+        check(g_backends[1]->keepAlives == 0, "a held session sent silence gets no keep-alive");
+    }
+
+    void keepAliveAfterInterval() {
+        SpeakerScheduler::Options options;
+        options.sessions = 2;
+        options.hangover = chrono::milliseconds(100);
+        options.hold = chrono::milliseconds(100);
+        Harness h(options);
+
+        h.run(100, {{1, c_loud}, {2, c_loud}});
+        // node 3 takes session 0 from node 1 and keeps talking; node 1 then stops sending
+        h.run(300, {{1, 0}, {2, c_loud}, {3, c_loud}});
+        check(g_backends[0]->flushes == 1, "node 3 takes the first session");
+
+        // node 2 goes away entirely, so its session gets nothing for 12 s
+        h.run(12000, {{3, c_loud}});
+        check(g_backends[0]->keepAlives == 0, "the busy session gets no keep-alive");
+        check(g_backends[1]->keepAlives == 2, "the idle session gets one keep-alive per 5 s");
+    }
+}
+
+int main() {
+    assignsFreeSessionsWithPreRoll();
+    holdsAndHangover();
+    louderSpeakerPreempts();
+    keepAliveOnlyWhenIdle();
+    keepAliveAfterInterval();
+
+    if (g_failures) {
+        cerr << g_failures << " checks failed" << endl;
+        return 1;
+    }
+
+    cout << "all checks passed" << endl;
+    return 0;
+}
+
+unique_ptr<TranscriptionBackend> TranscriptionBackend::create(const Options&) {
+    auto backend = make_unique<FakeBackend>();
+    g_backends.push_back(backend.get());
+    return backend;
+}
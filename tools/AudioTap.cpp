@@ -0,0 +1,77 @@
+// AudioTap.cpp
+// Read live PCM from the bot's shared memory ring and write one node to a file or stdout
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+#include "../src/raw-stream/SharedAudioRing.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " <socket> [output] [--node id] [--from-start]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    string socketPath = argv[1];
+    string output;
+    long node = -1;
+    bool fromStart = false;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--node" && i + 1 < argc)
+            node = atol(argv[++i]);
+        else if (arg == "--from-start")
+            fromStart = true;
+        else
+            output = arg;
+    }
+
+    SharedAudioReader reader;
+    if (!reader.connect(socketPath, fromStart)) {
+        cerr << "unable to attach to " << socketPath << endl;
+        return EXIT_FAILURE;
+    }
+
+    ofstream file;
+    if (!output.empty()) {
+        file.open(output, ios::out | ios::binary | ios::trunc);
+        if (!file.is_open()) {
+            cerr << "unable to open output: " << output << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    ostream& out = output.empty() ? cout : file;
+
+    uint64_t lost = 0;
+    SharedAudioReader::Frame frame{};
+
+    while (reader.connected()) {
+        if (!reader.wait(1000))
+            continue;
+
+        while (reader.next(frame)) {
+            if (node >= 0 && frame.node != static_cast<uint32_t>(node))
+                continue;
+
+            out.write(frame.data, static_cast<streamsize>(frame.len));
+
+            // the writer lapped us while we were copying, so what we wrote is torn
+            if (!reader.valid(frame))
+                cerr << "frame " << frame.seq << " was overwritten while being read" << endl;
+        }
+
+        out.flush();
+
+        if (reader.lost() != lost) {
+            cerr << "dropped " << reader.lost() - lost << " frames" << endl;
+            lost = reader.lost();
+        }
+    }
+
+    cerr << "writer went away" << endl;
+    return EXIT_SUCCESS;
+}
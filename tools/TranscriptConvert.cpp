@@ -0,0 +1,60 @@
+// TranscriptConvert.cpp
+// Convert a binary transcript log to JSONL, SRT or WebVTT
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+#include "../src/transcript/TranscriptLog.h"
+#include "../src/transcript/TranscriptExport.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " <transcript.dgt> <jsonl|srt|vtt> [output] [--from seconds]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    string input = argv[1];
+    string format = argv[2];
+    string output;
+    uint64_t fromMs = 0;
+
+    for (int i = 3; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--from" && i + 1 < argc)
+            fromMs = static_cast<uint64_t>(atof(argv[++i]) * 1000);
+        else
+            output = arg;
+    }
+
+    TranscriptLogReader reader;
+    if (!reader.open(input)) {
+        cerr << "unable to read transcript log: " << input << endl;
+        return EXIT_FAILURE;
+    }
+
+    ofstream file;
+    if (!output.empty()) {
+        file.open(output, ios::out | ios::trunc);
+        if (!file.is_open()) {
+            cerr << "unable to open output: " << output << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    ostream& out = output.empty() ? cout : file;
+
+    if (format == "jsonl")
+        TranscriptExport::toJsonl(reader, out, fromMs);
+    else if (format == "srt")
+        TranscriptExport::toSrt(reader, out, fromMs);
+    else if (format == "vtt")
+        TranscriptExport::toVtt(reader, out, fromMs);
+    else {
+        cerr << "unknown format: " << format << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}